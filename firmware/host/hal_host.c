@@ -0,0 +1,289 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * hal_host.c - host backend of the hardware abstraction layer on top of a virtual clock and the
+ * simulated ICM-42688
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#include <stdio.h>
+#include <time.h>
+#include "esp_log.h"
+#include "hal_host.h"
+
+#define BUS_BITS_PER_BYTE   9U  /* 8 data bits + ack */
+#define BUS_FRAME_BITS      2U  /* start + stop */
+
+struct HalBusDevice {
+    uint16_t address;
+    uint32_t speed_hz;
+    bool pending;
+    bool result;
+    int64_t done_us;    /* virtual time the queued transfer finishes */
+};
+
+static int64_t clock_us = 0;
+static HalBusDevice devices[HAL_BUS_MAX_DEVICES];
+static uint8_t device_count = 0U;
+static HalHostBusStats bus_stats = { 0 };
+static Icm42688Sim *imu_sim = NULL;
+static uint16_t imu_address = 0U;
+static uint8_t imu_int1_pin = 0U;
+static HalIsr irq_handler = NULL;
+static void *irq_arg = NULL;
+static uint8_t irq_pin = 0U;
+static uint32_t pwm_duty[HAL_PWM_MAX_CHANNELS];
+static uint8_t pwm_bits[HAL_PWM_MAX_CHANNELS];
+static HalAlarmCallback alarm_callback = NULL;
+static void *alarm_arg = NULL;
+static int64_t alarm_deadline = INT64_MAX;
+static bool cycle_counter = true;
+
+int host_log_level = ESP_LOG_WARN;
+
+void hal_host_set_log_level(int level)
+{
+    host_log_level = level;
+}
+
+void hal_host_set_cycle_counter(bool enabled)
+{
+    cycle_counter = enabled;
+}
+
+void hal_host_attach_imu(Icm42688Sim *sim, uint16_t address, uint8_t int1_pin)
+{
+    imu_sim = sim;
+    imu_address = address;
+    imu_int1_pin = int1_pin;
+}
+
+static void deliver_edges(uint32_t edges)
+{
+    if (irq_handler == NULL || irq_pin != imu_int1_pin) { return; }
+    for (uint32_t i = 0U; i < edges; i++) { irq_handler(irq_arg); }
+}
+
+static void fire_alarm(void)
+{
+    if (alarm_deadline > clock_us) { return; }
+    alarm_deadline = INT64_MAX;
+    if (alarm_callback != NULL) { alarm_callback(alarm_arg); }
+}
+
+/* step from one ODR tick (or alarm) to the next so every edge fires at its own time */
+static uint32_t run_until(int64_t target_us, bool stop_on_irq)
+{
+    uint32_t edges = 0U;
+
+    while (1)
+    {
+        int64_t next = (imu_sim != NULL) ? icm42688_sim_next_event_us(imu_sim) : INT64_MAX;
+        if (alarm_deadline < next) { next = alarm_deadline; }
+        if (next > target_us) { break; }
+
+        clock_us = (next > clock_us) ? next : clock_us;
+        uint32_t now_edges = (imu_sim != NULL) ? icm42688_sim_advance(imu_sim, clock_us) : 0U;
+        deliver_edges(now_edges);
+        edges += now_edges;
+        fire_alarm();
+        if (stop_on_irq && now_edges > 0U) { return edges; }
+    }
+
+    if (target_us > clock_us) { clock_us = target_us; }
+    if (imu_sim != NULL)
+    {
+        uint32_t now_edges = icm42688_sim_advance(imu_sim, clock_us);
+        deliver_edges(now_edges);
+        edges += now_edges;
+    }
+    return edges;
+}
+
+void hal_host_advance(int64_t us)
+{
+    run_until(clock_us + us, false);
+}
+
+void hal_host_wait_irq(int64_t max_us)
+{
+    run_until(clock_us + max_us, true);
+}
+
+uint32_t hal_host_pwm_duty(uint8_t channel)
+{
+    return (channel < HAL_PWM_MAX_CHANNELS) ? pwm_duty[channel] : 0U;
+}
+
+uint32_t hal_host_pwm_full_scale(uint8_t channel)
+{
+    return (channel < HAL_PWM_MAX_CHANNELS && pwm_bits[channel] > 0U) ? (1U << pwm_bits[channel]) - 1U : 0U;
+}
+
+const HalHostBusStats *hal_host_bus_stats(void)
+{
+    return &bus_stats;
+}
+
+bool hal_bus_init(uint8_t port, uint8_t sda_pin, uint8_t scl_pin)
+{
+    device_count = 0U;
+    return true;
+}
+
+HalBusDevice *hal_bus_add_device(uint16_t address, uint32_t speed_hz)
+{
+    if (device_count >= HAL_BUS_MAX_DEVICES) { ESP_LOGE("hal_bus_add_device", "No free device slot"); return NULL; }
+
+    HalBusDevice *device = &devices[device_count++];
+    device->address = address;
+    device->speed_hz = (speed_hz > 0U) ? speed_hz : 100000U;
+    device->pending = false;
+    device->result = true;
+    device->done_us = clock_us;
+    return device;
+}
+
+/* the transfer happens right away against the model, the bus time is paid in hal_bus_wait */
+bool hal_bus_start(HalBusDevice *device, const uint8_t *write, size_t write_length, uint8_t *read, size_t read_length)
+{
+    if (device == NULL || device->pending) { return false; }
+
+    run_until(clock_us, false); /* bring the model up to date before it answers */
+
+    bool ok = false;
+    if (imu_sim != NULL && device->address == imu_address)
+    {
+        if (read_length > 0U) { ok = (write_length == 1U) && icm42688_sim_read(imu_sim, write[0], read, read_length); }
+        else                  { ok = icm42688_sim_write(imu_sim, write, write_length); }
+    }
+
+    size_t bytes = 1U + write_length + ((read_length > 0U) ? 1U + read_length : 0U); /* address bytes included */
+    int64_t duration = (int64_t)((bytes * BUS_BITS_PER_BYTE + BUS_FRAME_BITS) * 1000000U / device->speed_hz);
+
+    device->pending = true;
+    device->result = ok;
+    device->done_us = clock_us + duration;
+    bus_stats.transfers++;
+    bus_stats.bytes += write_length + read_length;
+    bus_stats.busy_us += duration;
+    if (!ok) { bus_stats.errors++; }
+
+    return true;
+}
+
+bool hal_bus_wait(HalBusDevice *device, uint32_t timeout_ms)
+{
+    if (device == NULL || !device->pending) { return false; }
+
+    run_until(device->done_us, false);
+    device->pending = false;
+    if (!device->result) { ESP_LOGE("hal_bus_wait", "I2C transfer failed, device 0x%X did not answer", device->address); }
+    return device->result;
+}
+
+bool hal_gpio_irq_init(uint8_t pin, HalIsr isr, void *arg)
+{
+    irq_pin = pin;
+    irq_handler = isr;
+    irq_arg = arg;
+    return true;
+}
+
+bool hal_pwm_init(uint8_t channel, uint8_t pin, uint32_t frequency, uint8_t resolution_bits)
+{
+    if (channel >= HAL_PWM_MAX_CHANNELS) { return false; }
+    pwm_duty[channel] = 0U;
+    pwm_bits[channel] = resolution_bits;
+    return true;
+}
+
+bool hal_pwm_set(uint8_t channel, uint32_t duty)
+{
+    if (channel >= HAL_PWM_MAX_CHANNELS) { return false; }
+    pwm_duty[channel] = duty;
+    return true;
+}
+
+void hal_pwm_set_fast(uint8_t channel, uint32_t duty)
+{
+    if (channel < HAL_PWM_MAX_CHANNELS) { pwm_duty[channel] = duty; }
+}
+
+bool hal_alarm_init(HalAlarmCallback callback, void *arg)
+{
+    alarm_callback = callback;
+    alarm_arg = arg;
+    alarm_deadline = INT64_MAX;
+    return true;
+}
+
+void hal_alarm_arm(uint32_t timeout_us)
+{
+    alarm_deadline = clock_us + (int64_t)timeout_us;
+}
+
+void hal_alarm_cancel(void)
+{
+    alarm_deadline = INT64_MAX;
+}
+
+/* the alarm only fires from inside run_until, nothing can preempt the caller here */
+void hal_critical_enter(void)
+{
+}
+
+void hal_critical_exit(void)
+{
+}
+
+int64_t hal_clock_now_us(void)
+{
+    return clock_us;
+}
+
+void hal_delay_us(uint32_t us)
+{
+    run_until(clock_us + (int64_t)us, false);
+}
+
+void hal_delay_ms(uint32_t ms)
+{
+    run_until(clock_us + (int64_t)ms * 1000, false);
+}
+
+/* real time, not the virtual clock, so the probes measure what the host cpu actually spent */
+uint32_t hal_cycle_count(void)
+{
+    if (!cycle_counter) { return 0U; }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec);
+}
+
+uint32_t hal_cycles_per_us(void)
+{
+    return 1000U;
+}
\ No newline at end of file
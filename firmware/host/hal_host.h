@@ -0,0 +1,59 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * hal_host.h - host (linux) backend of the hardware abstraction layer. time is virtual and only moves
+ * when the firmware waits on the clock or the bus, so the drivers run as fast as the host allows while
+ * everything they see (bus transfer times, ODR ticks, INT1 edges) keeps the real timing
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _HAL_HOST_H
+#define _HAL_HOST_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal.h"
+#include "icm42688_sim.h"
+
+typedef struct {
+    uint32_t transfers;
+    uint32_t errors;      /* NACKs, transfers to unknown devices */
+    uint64_t bytes;       /* payload bytes both ways */
+    int64_t busy_us;      /* virtual time the bus was busy */
+} HalHostBusStats;
+
+/* answer transfers to address with the model and route its INT1 line to pin */
+void hal_host_attach_imu(Icm42688Sim *sim, uint16_t address, uint8_t int1_pin);
+/* move the virtual clock forward, firing the gpio isr for every INT1 edge on the way */
+void hal_host_advance(int64_t us);
+/* idle until the next INT1 edge or for at most max_us, what a task blocked on the interrupt would do */
+void hal_host_wait_irq(int64_t max_us);
+uint32_t hal_host_pwm_duty(uint8_t channel);
+/* 2^resolution - 1 the channel was set up with, 0 before hal_pwm_init */
+uint32_t hal_host_pwm_full_scale(uint8_t channel);
+const HalHostBusStats *hal_host_bus_stats(void);
+/* ESP_LOG level filter of the esp_log.h shim, ESP_LOG_WARN by default */
+void hal_host_set_log_level(int level);
+/* hal_cycle_count reads the host clock by default, off it returns 0 and the stats probes cost next to nothing */
+void hal_host_set_cycle_counter(bool enabled);
+
+#endif /* _HAL_HOST_H */
\ No newline at end of file
@@ -0,0 +1,531 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * icm42688_sim.c - register level model of the ICM-42688. only the parts the driver relies on are modeled,
+ * everything else behaves like plain read/write memory
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "icm42688_sim.h"
+
+#define ST_ACCEL_RESOLUTION   (4.0F / 32768.0F)   /* the self-test response is specified at 4 g */
+#define ST_GYRO_RESOLUTION    (250.0F / 32768.0F) /* and at 250 dps */
+#define SELF_TEST_GYRO_MASK   0x07 /* EN_GX_ST | EN_GY_ST | EN_GZ_ST */
+#define SELF_TEST_ACCEL_SHIFT 3U   /* EN_AX_ST is bit 3 */
+#define DEVICE_SOFT_RESET     0x01
+#define INT_SOURCE0_RESET     0x10 /* RESET_DONE_INT1_EN */
+#define FIFO_MODE_MASK        0xC0
+#define FIFO_HEADER_ACCEL     0x40
+#define FIFO_HEADER_GYRO      0x20
+#define FIFO_HEADER_TMST_ODR  0x08
+#define FIFO_COUNT_BIG_ENDIAN 0x20 /* INTF_CONFIG0 */
+#define SENSOR_BIG_ENDIAN     0x10 /* INTF_CONFIG0 */
+#define FIFO_EMPTY_BYTE       0xFF
+
+static void load_defaults(Icm42688Sim *sim)
+{
+    memset(sim->registers, 0, sizeof(sim->registers));
+    sim->bank = 0U;
+
+    uint8_t *bank0 = sim->registers[0];
+    bank0[ICM42688_DRIVE_CONFIG] = 0x05;
+    bank0[ICM42688_GYRO_CONFIG0] = GODR_1kHz;
+    bank0[ICM42688_ACCEL_CONFIG0] = AODR_1kHz;
+    bank0[ICM42688_GYRO_ACCEL_CONFIG0] = 0x11;
+    bank0[ICM42688_TMST_CONFIG] = 0x23;
+    bank0[ICM42688_INTF_CONFIG0] = FIFO_COUNT_BIG_ENDIAN | SENSOR_BIG_ENDIAN;
+    bank0[ICM42688_INTF_CONFIG1] = 0x91;
+    bank0[ICM42688_INT_CONFIG1] = 0x10;
+    bank0[ICM42688_INT_SOURCE0] = INT_SOURCE0_RESET;
+    bank0[ICM42688_FIFO_CONFIG1] = 0x00;
+    bank0[ICM42688_FIFO_CONFIG2] = 0x00;
+    bank0[ICM42688_FIFO_CONFIG3] = 0x00;
+    bank0[ICM42688_WHO_AM_I] = ICM42688_ID;
+    for (uint8_t i = ICM42688_TEMP_DATA1; i <= ICM42688_GYRO_DATA_Z0; i += 2U)
+    {
+        bank0[i] = 0x80; /* -32768 until the first sample */
+    }
+
+    for (uint8_t i = 0U; i < 3U; i++)
+    {
+        sim->registers[1][ICM42688_XG_ST_DATA + i] = sim->config.gyro_st_code[i];
+        sim->registers[2][ICM42688_XA_ST_DATA + i] = sim->config.accel_st_code[i];
+    }
+
+    sim->accel_ready_us = INT64_MAX;
+    sim->gyro_ready_us = INT64_MAX;
+    sim->period_ns = 0;
+    sim->fifo_head = 0U;
+    sim->fifo_count = 0U;
+    sim->fifo_lost = 0U;
+}
+
+/* xorshift32 + box-muller, reproducible for a given seed */
+static float uniform(Icm42688Sim *sim)
+{
+    sim->rng ^= sim->rng << 13U;
+    sim->rng ^= sim->rng >> 17U;
+    sim->rng ^= sim->rng << 5U;
+    return ((float)(sim->rng >> 8U) + 0.5F) / 16777216.0F;
+}
+
+/* both halves of the pair, one log and sincos per two draws */
+static float gaussian(Icm42688Sim *sim)
+{
+    if (sim->gaussian_ready) { sim->gaussian_ready = false; return sim->gaussian_spare; }
+    float u1 = uniform(sim);
+    float u2 = uniform(sim);
+    float radius = sqrtf(-2.0F * logf(u1));
+    sim->gaussian_spare = radius * sinf(2.0F * 3.14159265358979F * u2);
+    sim->gaussian_ready = true;
+    return radius * cosf(2.0F * 3.14159265358979F * u2);
+}
+
+static int64_t odr_to_period_ns(uint8_t odr)
+{
+    switch(odr & 0x0F)
+    {
+        case GODR_32kHz:  return 31250;
+        case GODR_16kHz:  return 62500;
+        case GODR_8kHz:   return 125000;
+        case GODR_4kHz:   return 250000;
+        case GODR_2kHz:   return 500000;
+        case GODR_1kHz:   return 1000000;
+        case GODR_500Hz:  return 2000000;
+        case GODR_200Hz:  return 5000000;
+        case GODR_100Hz:  return 10000000;
+        case GODR_50Hz:   return 20000000;
+        case GODR_25Hz:   return 40000000;
+        case GODR_12_5Hz: return 80000000;
+        case AODR_6_25Hz: return 160000000;
+        case AODR_3_125Hz: return 320000000;
+        case AODR_1_5625Hz: return 640000000;
+        default:          return 1000000;
+    }
+}
+
+static bool gyro_on(const Icm42688Sim *sim)
+{
+    return ((sim->registers[0][ICM42688_PWR_MGMT0] >> 2U) & 0x03) == gMode_LN;
+}
+
+static bool accel_on(const Icm42688Sim *sim)
+{
+    return (sim->registers[0][ICM42688_PWR_MGMT0] & 0x03) >= aMode_LP;
+}
+
+/* the ODR clock follows the gyro while it is on, the accel otherwise */
+static void update_timing(Icm42688Sim *sim)
+{
+    int64_t period = 0;
+
+    if (gyro_on(sim))       { period = odr_to_period_ns(sim->registers[0][ICM42688_GYRO_CONFIG0]); }
+    else if (accel_on(sim)) { period = odr_to_period_ns(sim->registers[0][ICM42688_ACCEL_CONFIG0]); }
+    period = (int64_t)((double)period * (1.0 + (double)sim->config.clock_drift_ppm * 1e-6));
+
+    if (period != sim->period_ns)
+    {
+        sim->period_ns = period;
+        sim->next_sample_ns = sim->now_us * 1000 + period;
+    }
+}
+
+static void power_changed(Icm42688Sim *sim, uint8_t previous)
+{
+    bool gyro_was_on = ((previous >> 2U) & 0x03) == gMode_LN;
+    bool accel_was_on = (previous & 0x03) >= aMode_LP;
+
+    if (gyro_on(sim) && !gyro_was_on)   { sim->gyro_ready_us = sim->now_us + SIM_GYRO_STARTUP_US; }
+    if (!gyro_on(sim))                  { sim->gyro_ready_us = INT64_MAX; }
+    if (accel_on(sim) && !accel_was_on) { sim->accel_ready_us = sim->now_us + SIM_ACCEL_STARTUP_US; }
+    if (!accel_on(sim))                 { sim->accel_ready_us = INT64_MAX; }
+    update_timing(sim);
+}
+
+static int16_t quantize(float value, float resolution)
+{
+    float counts = roundf(value / resolution);
+    if (counts >  32767.0F) { counts =  32767.0F; }
+    if (counts < -32767.0F) { counts = -32767.0F; } /* -32768 is reserved for invalid samples */
+    return (int16_t)counts;
+}
+
+static float accel_resolution(const Icm42688Sim *sim)
+{
+    return (float)(16U >> (sim->registers[0][ICM42688_ACCEL_CONFIG0] >> 5U)) / 32768.0F;
+}
+
+static float gyro_resolution(const Icm42688Sim *sim)
+{
+    return 2000.0F / (float)(1U << (sim->registers[0][ICM42688_GYRO_CONFIG0] >> 5U)) / 32768.0F;
+}
+
+static uint16_t fifo_packet_size(const Icm42688Sim *sim)
+{
+    uint8_t config = sim->registers[0][ICM42688_FIFO_CONFIG1];
+    bool accel = (config & FIFO_ACCEL_EN) != 0U;
+    bool gyro = (config & FIFO_GYRO_EN) != 0U;
+
+    if (accel && gyro) { return 16U; } /* packet 3 */
+    if (accel || gyro) { return 8U; }  /* packet 1 or 2 */
+    return 0U;
+}
+
+static uint16_t fifo_watermark_bytes(const Icm42688Sim *sim)
+{
+    const uint8_t *bank0 = sim->registers[0];
+    uint16_t watermark = (uint16_t)(((bank0[ICM42688_FIFO_CONFIG3] & 0x0F) << 8U) | bank0[ICM42688_FIFO_CONFIG2]);
+    if (bank0[ICM42688_INTF_CONFIG0] & FIFO_COUNT_REC) { watermark *= fifo_packet_size(sim); }
+    return watermark;
+}
+
+static void fifo_flush(Icm42688Sim *sim)
+{
+    sim->fifo_head = 0U;
+    sim->fifo_count = 0U;
+}
+
+/* returns the INT_STATUS bits raised by this push */
+static uint8_t fifo_push(Icm42688Sim *sim, const int16_t *values, int8_t temperature, uint16_t timestamp)
+{
+    uint8_t config = sim->registers[0][ICM42688_FIFO_CONFIG1];
+    uint16_t size = fifo_packet_size(sim);
+    uint8_t packet[16U] = { 0 };
+    uint8_t length = 0U;
+
+    if (size == 0U || (sim->registers[0][ICM42688_FIFO_CONFIG] & FIFO_MODE_MASK) == FIFO_MODE_BYPASS) { return 0U; }
+    if (sim->fifo_count + size > FIFO_SIZE)
+    {
+        sim->fifo_lost++;
+        return INT_STATUS_FIFO_FULL;
+    }
+
+    packet[length++] = (uint8_t)(((config & FIFO_ACCEL_EN) ? FIFO_HEADER_ACCEL : 0U) | ((config & FIFO_GYRO_EN) ? FIFO_HEADER_GYRO : 0U) | FIFO_HEADER_TMST_ODR);
+    for (uint8_t i = 0U; i < 6U; i++)
+    {
+        if (i < 3U && !(config & FIFO_ACCEL_EN)) { continue; }
+        if (i >= 3U && !(config & FIFO_GYRO_EN)) { continue; }
+        packet[length++] = (uint8_t)((uint16_t)values[i] >> 8U); /* fifo data is always big endian */
+        packet[length++] = (uint8_t)((uint16_t)values[i] & 0xFF);
+    }
+    packet[length++] = (uint8_t)temperature;
+    if (size == 16U)
+    {
+        packet[length++] = (uint8_t)(timestamp >> 8U);
+        packet[length++] = (uint8_t)(timestamp & 0xFF);
+    }
+
+    for (uint8_t i = 0U; i < length; i++)
+    {
+        sim->fifo[(sim->fifo_head + sim->fifo_count + i) % FIFO_SIZE] = packet[i];
+    }
+    sim->fifo_count += length;
+
+    uint8_t status = 0U;
+    uint16_t watermark = fifo_watermark_bytes(sim);
+    if (watermark > 0U && sim->fifo_count >= watermark) { status |= INT_STATUS_FIFO_THS; }
+    if (sim->fifo_count + size > FIFO_SIZE) { status |= INT_STATUS_FIFO_FULL; }
+    return status;
+}
+
+static uint8_t fifo_pop(Icm42688Sim *sim)
+{
+    if (sim->fifo_count == 0U) { return FIFO_EMPTY_BYTE; }
+
+    uint8_t data = sim->fifo[sim->fifo_head];
+    sim->fifo_head = (uint16_t)((sim->fifo_head + 1U) % FIFO_SIZE);
+    sim->fifo_count--;
+    return data;
+}
+
+/* a burst from FIFO_DATA in at most two copies, the bytes past the end read as empty like fifo_pop's */
+static void fifo_pop_burst(Icm42688Sim *sim, uint8_t *data, size_t length)
+{
+    size_t count = (length < sim->fifo_count) ? length : sim->fifo_count;
+    size_t first = FIFO_SIZE - sim->fifo_head;
+
+    if (first > count) { first = count; }
+    memcpy(data, &sim->fifo[sim->fifo_head], first);
+    memcpy(data + first, sim->fifo, count - first);
+    memset(data + count, FIFO_EMPTY_BYTE, length - count);
+    sim->fifo_head = (uint16_t)((sim->fifo_head + count) % FIFO_SIZE);
+    sim->fifo_count = (uint16_t)(sim->fifo_count - count);
+}
+
+static void store_sensor_register(uint8_t *bank0, uint8_t address, int16_t value)
+{
+    if (bank0[ICM42688_INTF_CONFIG0] & SENSOR_BIG_ENDIAN)
+    {
+        bank0[address] = (uint8_t)((uint16_t)value >> 8U);
+        bank0[address + 1U] = (uint8_t)((uint16_t)value & 0xFF);
+    }
+    else
+    {
+        bank0[address] = (uint8_t)((uint16_t)value & 0xFF);
+        bank0[address + 1U] = (uint8_t)((uint16_t)value >> 8U);
+    }
+}
+
+/* one ODR tick, returns true if INT1 pulses */
+static bool take_sample(Icm42688Sim *sim, int64_t time_ns)
+{
+    uint8_t *bank0 = sim->registers[0];
+    uint8_t self_test = bank0[ICM42688_SELF_TEST_CONFIG];
+    int64_t time_us = time_ns / 1000;
+    SimMotion motion = { { 0.0F, 0.0F, 1.0F }, { 0.0F, 0.0F, 0.0F } };
+    int16_t values[6U] = { 0 };
+    float drift = sim->config.gyro_bias_drift * (float)((double)time_ns * 1e-9 / 3600.0);
+
+    if (sim->motion != NULL) { sim->motion((double)time_ns * 1e-9, &motion, sim->motion_arg); }
+
+    for (uint8_t i = 0U; i < 3U; i++)
+    {
+        float accel = motion.accel[i] + sim->config.accel_bias[i] + sim->config.accel_noise * gaussian(sim);
+        float gyro = motion.gyro[i] + sim->config.gyro_bias[i] + drift + sim->config.gyro_noise * gaussian(sim);
+
+        /* the self-test response of a nominal part is exactly what the factory code predicts */
+        if (self_test & (1U << (SELF_TEST_ACCEL_SHIFT + i)))
+        {
+            accel += (1310.0F * powf(1.01F, (float)sim->config.accel_st_code[i] - 1.0F) + 0.5F) * ST_ACCEL_RESOLUTION;
+        }
+        if (self_test & (1U << i))
+        {
+            gyro += (2620.0F * powf(1.01F, (float)sim->config.gyro_st_code[i] - 1.0F) + 0.5F) * ST_GYRO_RESOLUTION;
+        }
+
+        values[i] = (time_us >= sim->accel_ready_us) ? quantize(accel, accel_resolution(sim)) : FIFO_INVALID_SAMPLE;
+        values[i + 3U] = (time_us >= sim->gyro_ready_us) ? quantize(gyro, gyro_resolution(sim)) : FIFO_INVALID_SAMPLE;
+    }
+
+    float temperature = sim->config.temperature - 25.0F;
+    store_sensor_register(bank0, ICM42688_TEMP_DATA1, (int16_t)roundf(temperature * 132.48F));
+    for (uint8_t i = 0U; i < 6U; i++)
+    {
+        store_sensor_register(bank0, (uint8_t)(ICM42688_ACCEL_DATA_X1 + 2U * i), values[i]);
+    }
+
+    /* the timestamp counts the sensor's own clock, 1 us or 16 us per count */
+    double sensor_us = (double)time_ns * 1e-3 / (1.0 + (double)sim->config.clock_drift_ppm * 1e-6);
+    uint32_t stamp = (uint32_t)(int64_t)sensor_us;
+    if (bank0[ICM42688_TMST_CONFIG] & TMST_RES_16US) { stamp /= 16U; }
+
+    uint8_t status = INT_STATUS_DATA_RDY;
+    status |= fifo_push(sim, values, (int8_t)roundf(temperature * 2.07F), (uint16_t)(stamp & 0xFFFF));
+    bank0[ICM42688_INT_STATUS] |= status;
+    sim->samples++;
+
+    return (status & bank0[ICM42688_INT_SOURCE0]) != 0U;
+}
+
+void icm42688_sim_default_config(Icm42688SimConfig *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->accel_bias[0] = 0.012F;
+    config->accel_bias[1] = -0.008F;
+    config->accel_bias[2] = 0.020F;
+    config->gyro_bias[0] = 0.45F;
+    config->gyro_bias[1] = -0.30F;
+    config->gyro_bias[2] = 0.15F;
+    config->accel_noise = 0.0013F;  /* 70 ug/sqrt(Hz) at 1 kHz / 40 Hz bandwidth, rounded up */
+    config->gyro_noise = 0.05F;     /* 2.8 mdps/sqrt(Hz), rounded up for vibration */
+    config->temperature = 30.0F;
+    config->clock_drift_ppm = 0.0F;
+    for (uint8_t i = 0U; i < 3U; i++)
+    {
+        config->accel_st_code[i] = 50U + i;
+        config->gyro_st_code[i] = 60U + i;
+    }
+    config->seed = 0x42688U;
+}
+
+void icm42688_sim_init(Icm42688Sim *sim, const Icm42688SimConfig *config, SimMotionSource motion, void *arg)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->config = *config;
+    sim->motion = motion;
+    sim->motion_arg = arg;
+    sim->rng = (config->seed != 0U) ? config->seed : 1U;
+    sim->gaussian_ready = false;
+    load_defaults(sim);
+    sim->registers[0][ICM42688_INT_STATUS] = INT_STATUS_RESET_DONE; /* power on reset */
+}
+
+int64_t icm42688_sim_next_event_us(const Icm42688Sim *sim)
+{
+    if (sim->period_ns == 0) { return INT64_MAX; }
+    return (sim->next_sample_ns + 999) / 1000;
+}
+
+uint32_t icm42688_sim_advance(Icm42688Sim *sim, int64_t now_us)
+{
+    uint32_t pulses = 0U;
+
+    if (now_us < sim->now_us) { return 0U; }
+
+    while (sim->period_ns > 0 && sim->next_sample_ns <= now_us * 1000)
+    {
+        sim->now_us = sim->next_sample_ns / 1000;
+        if (take_sample(sim, sim->next_sample_ns)) { pulses++; }
+        sim->next_sample_ns += sim->period_ns;
+    }
+    sim->now_us = now_us;
+
+    if (sim->reset_pending && now_us >= sim->reset_until_us)
+    {
+        sim->reset_pending = false;
+        sim->registers[0][ICM42688_INT_STATUS] |= INT_STATUS_RESET_DONE;
+        if (sim->registers[0][ICM42688_INT_SOURCE0] & INT_SOURCE0_RESET) { pulses++; }
+    }
+
+    sim->int1_pulses += pulses;
+    return pulses;
+}
+
+static void write_register(Icm42688Sim *sim, uint8_t address, uint8_t value)
+{
+    uint8_t *bank0 = sim->registers[0];
+
+    address &= 0x7F;
+    if (address == ICM42688_REG_BANK_SEL)
+    {
+        sim->bank = (uint8_t)((value & 0x07) % SIM_BANKS);
+        return;
+    }
+    if (sim->bank != 0U)
+    {
+        sim->registers[sim->bank][address] = value;
+        return;
+    }
+
+    switch(address)
+    {
+        case ICM42688_DEVICE_CONFIG:
+            if (value & DEVICE_SOFT_RESET)
+            {
+                load_defaults(sim);
+                sim->reset_until_us = sim->now_us + SIM_RESET_TIME_US;
+                sim->reset_pending = true;
+                return;
+            }
+            bank0[address] = value;
+            break;
+        case ICM42688_SIGNAL_PATH_RESET:
+            if (value & FIFO_FLUSH) { fifo_flush(sim); }
+            break; /* all bits self-clear */
+        case ICM42688_PWR_MGMT0:
+        {
+            uint8_t previous = bank0[address];
+            bank0[address] = value;
+            power_changed(sim, previous);
+            break;
+        }
+        case ICM42688_GYRO_CONFIG0:
+        case ICM42688_ACCEL_CONFIG0:
+            bank0[address] = value;
+            update_timing(sim);
+            break;
+        case ICM42688_FIFO_CONFIG:
+            if ((value & FIFO_MODE_MASK) == FIFO_MODE_BYPASS) { fifo_flush(sim); }
+            bank0[address] = value;
+            break;
+        case ICM42688_WHO_AM_I:
+        case ICM42688_INT_STATUS:
+        case ICM42688_FIFO_COUNTH:
+        case ICM42688_FIFO_COUNTL:
+        case ICM42688_FIFO_LOST_PKT0:
+        case ICM42688_FIFO_LOST_PKT1:
+            break; /* read only */
+        default:
+            if (address >= ICM42688_TEMP_DATA1 && address <= ICM42688_GYRO_DATA_Z0) { break; }
+            bank0[address] = value;
+            break;
+    }
+}
+
+static uint8_t read_register(Icm42688Sim *sim, uint8_t address)
+{
+    uint8_t *bank0 = sim->registers[0];
+
+    address &= 0x7F;
+    if (address == ICM42688_REG_BANK_SEL) { return sim->bank; }
+    if (sim->bank != 0U) { return sim->registers[sim->bank][address]; }
+
+    switch(address)
+    {
+        case ICM42688_INT_STATUS:
+        {
+            uint8_t status = bank0[address];
+            bank0[address] = 0x00; /* clear on read */
+            return status;
+        }
+        case ICM42688_FIFO_COUNTH:
+        case ICM42688_FIFO_COUNTL:
+        {
+            uint16_t count = sim->fifo_count;
+            uint16_t size = fifo_packet_size(sim);
+            if ((bank0[ICM42688_INTF_CONFIG0] & FIFO_COUNT_REC) && size > 0U) { count /= size; }
+            bool high = (address == ICM42688_FIFO_COUNTH) == ((bank0[ICM42688_INTF_CONFIG0] & FIFO_COUNT_BIG_ENDIAN) != 0U);
+            return high ? (uint8_t)(count >> 8U) : (uint8_t)(count & 0xFF);
+        }
+        case ICM42688_FIFO_DATA:
+            return fifo_pop(sim);
+        case ICM42688_FIFO_LOST_PKT0:
+            return (uint8_t)(sim->fifo_lost & 0xFF);
+        case ICM42688_FIFO_LOST_PKT1:
+            return (uint8_t)(sim->fifo_lost >> 8U);
+        case ICM42688_DEVICE_CONFIG:
+        case ICM42688_SIGNAL_PATH_RESET:
+        default:
+            return bank0[address];
+    }
+}
+
+bool icm42688_sim_write(Icm42688Sim *sim, const uint8_t *data, size_t length)
+{
+    if (sim->now_us < sim->reset_until_us || length == 0U) { return false; }
+
+    uint8_t address = data[0] & 0x7F;
+    for (size_t i = 1U; i < length; i++)
+    {
+        write_register(sim, address, data[i]);
+        address = (uint8_t)((address + 1U) & 0x7F);
+    }
+    return true;
+}
+
+bool icm42688_sim_read(Icm42688Sim *sim, uint8_t register_address, uint8_t *data, size_t length)
+{
+    if (sim->now_us < sim->reset_until_us) { return false; }
+
+    uint8_t address = register_address & 0x7F;
+    if (sim->bank == 0U && address == ICM42688_FIFO_DATA) { fifo_pop_burst(sim, data, length); return true; }
+    for (size_t i = 0U; i < length; i++)
+    {
+        data[i] = read_register(sim, address);
+        /* FIFO_DATA does not auto-increment so a burst drains the fifo */
+        if (!(sim->bank == 0U && address == ICM42688_FIFO_DATA)) { address = (uint8_t)((address + 1U) & 0x7F); }
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * icm42688_sim.h - register level model of the ICM-42688 for the host backend. register banks, soft reset,
+ * sensor startup, ODR timing, self-test response, data registers, timestamps, FIFO and INT1 pulses,
+ * driven by a motion source that gives the true specific force and angular rate at any time
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ICM42688_SIM_H
+#define _ICM42688_SIM_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "imu.h"
+
+#define SIM_BANKS              5U
+#define SIM_BANK_SIZE          128U
+#define SIM_RESET_TIME_US      1000   /* no answer on the bus for this long after a soft reset */
+#define SIM_GYRO_STARTUP_US    30000  /* datasheet: gyro start up time from off */
+#define SIM_ACCEL_STARTUP_US   10000  /* datasheet: accel start up time from off */
+
+/* true motion in the sensor frame, before bias, noise, quantization and saturation */
+typedef struct {
+    float accel[3]; /* g */
+    float gyro[3];  /* dps */
+} SimMotion;
+
+typedef void (*SimMotionSource)(double t, SimMotion *motion, void *arg);
+
+typedef struct {
+    float accel_bias[3];     /* g */
+    float gyro_bias[3];      /* dps */
+    float gyro_bias_drift;   /* dps per hour on every axis, the bias at power up is gyro_bias */
+    float accel_noise;       /* rms per sample, g */
+    float gyro_noise;        /* rms per sample, dps */
+    float temperature;       /* degrees celsius */
+    float clock_drift_ppm;   /* how much slower the sensor clock runs than the host clock */
+    uint8_t accel_st_code[3]; /* factory self-test codes in bank 2 */
+    uint8_t gyro_st_code[3];  /* factory self-test codes in bank 1 */
+    uint32_t seed;
+} Icm42688SimConfig;
+
+typedef struct {
+    Icm42688SimConfig config;
+    SimMotionSource motion;
+    void *motion_arg;
+    uint8_t bank;
+    uint8_t registers[SIM_BANKS][SIM_BANK_SIZE];
+    int64_t now_us;
+    int64_t reset_until_us;   /* bus is dead until then */
+    bool reset_pending;       /* RESET_DONE shows up once reset_until_us passed */
+    int64_t accel_ready_us;   /* INT64_MAX while the sensor is off */
+    int64_t gyro_ready_us;
+    int64_t period_ns;        /* 0 while both sensors are off */
+    int64_t next_sample_ns;
+    uint8_t fifo[FIFO_SIZE];
+    uint16_t fifo_head;       /* bytes, oldest first */
+    uint16_t fifo_count;
+    uint16_t fifo_lost;
+    uint32_t int1_pulses;     /* rising edges on INT1 since the model was created */
+    uint64_t samples;         /* ODR ticks since the model was created */
+    uint32_t rng;
+    float gaussian_spare;     /* second half of the last box-muller pair */
+    bool gaussian_ready;
+} Icm42688Sim;
+
+/* noise and bias in the ballpark of the datasheet, factory self-test codes of a typical part */
+void icm42688_sim_default_config(Icm42688SimConfig *config);
+/* power on state, RESET_DONE already set */
+void icm42688_sim_init(Icm42688Sim *sim, const Icm42688SimConfig *config, SimMotionSource motion, void *arg);
+/* time of the next ODR tick in us, INT64_MAX if both sensors are off */
+int64_t icm42688_sim_next_event_us(const Icm42688Sim *sim);
+/* run the model up to now_us, returns the amount of rising edges on INT1 that happened meanwhile */
+uint32_t icm42688_sim_advance(Icm42688Sim *sim, int64_t now_us);
+/* register access at the current model time, data[0] of a write is the register address */
+/* both return false (NACK) while the part is resetting */
+bool icm42688_sim_write(Icm42688Sim *sim, const uint8_t *data, size_t length);
+bool icm42688_sim_read(Icm42688Sim *sim, uint8_t register_address, uint8_t *data, size_t length);
+
+#endif /* _ICM42688_SIM_H */
\ No newline at end of file
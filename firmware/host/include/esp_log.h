@@ -0,0 +1,57 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * esp_log.h - host stand-in for the ESP-IDF logging macros, stamped with the virtual clock
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ESP_LOG_H
+#define _ESP_LOG_H
+#include <stdio.h>
+#include <stdint.h>
+
+#define ESP_LOG_NONE     0
+#define ESP_LOG_ERROR    1
+#define ESP_LOG_WARN     2
+#define ESP_LOG_INFO     3
+#define ESP_LOG_DEBUG    4
+#define ESP_LOG_VERBOSE  5
+
+extern int host_log_level;
+int64_t hal_clock_now_us(void);
+
+#define HOST_LOG(level, letter, tag, fmt, ...) \
+    do { \
+        if (host_log_level >= (level)) \
+        { \
+            fprintf(stderr, letter " (%lld) %s: " fmt "\n", (long long)(hal_clock_now_us() / 1000), tag, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG(ESP_LOG_ERROR, "E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG(ESP_LOG_WARN, "W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG(ESP_LOG_INFO, "I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG(ESP_LOG_DEBUG, "D", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) HOST_LOG(ESP_LOG_VERBOSE, "V", tag, fmt, ##__VA_ARGS__)
+
+#endif /* _ESP_LOG_H */
\ No newline at end of file
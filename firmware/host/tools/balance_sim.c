@@ -0,0 +1,635 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * balance_sim.c - closed loop simulation of the robot balancing on a corner. a reuleaux triangle pivoting on a
+ * vertex (and rolling on the neighbouring arcs past 30 degrees) with the flywheel at its center, driven through a
+ * dc motor model by the pwm duties motor.c writes. the simulated ICM-42688 adds noise, bias and quantization at
+ * the configured odr, and the firmware's imu driver, control.c with its estimator and controller and motor.c
+ * run on top unmodified, each pass through the executive the way main.c's control task does it, about 2000x
+ * real time on a desktop. reports settle time after every push, rms pitch error and how often the command
+ * saturated, the numbers to compare before and after a control change
+ *  
+ * usage: balance_sim [--seconds s] [--tilt deg] [--push dps] [--push-period s] [--odr hz] [--watermark n]
+ *                    [--noise k] [--gyro-bias dps] [--seed n] [--kp x] [--kd x] [--ki x] [--mass kg] [--com m]
+ *                    [--inertia kgm2] [--wheel-inertia kgm2] [--friction Nm] [--stiction Nm] [--vbat V]
+ *                    [--record file] [--autotune rule] [--sysid file] [--sysid-signal n] [--friction-cal] [--stats]
+ *                    [--verbose]
+ * the control law is the one control.h picks, configure the host build with -DCONTROL_LAW=0 for pid.c.
+ * the accelerometer sits at the center of mass, so it also feels the angular acceleration the motor gives the body
+ * and the estimated pitch moves with the command. pid2 takes its D term from the gyro and holds through that, pid.c
+ * and pid_fx differentiate the estimate and fall at any gain. none of the pid flavours feeds the flywheel speed
+ * back either, it wanders with every push until the back emf leaves no torque, minutes in; the lqr and the mpc hold
+ * --record writes a session from the first release on, the same stream the robot records, for replay.c
+ * --autotune runs the relay autotuner with that rule (0 zn, 1 tl, 2 pessen, 3 no overshoot) a second after the
+ * first release, the way a write to 0xEEE2 would, accepts the gains it proposes and balances on them from there
+ * --sysid captures at the same point (--sysid-signal 0 prbs, 1 chirp) and writes the csv sysid_fit reads
+ * --friction-cal lets it lie on its side first and runs the friction calibration, the way a write to 0xEEE1 would,
+ * then stands it up and balances with the compensation it measured
+ * --stats prints the probe histograms, reading the host clock for them costs about 30% of the speed
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _DEFAULT_SOURCE /* M_PI */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "hal_host.h"
+#include "icm42688_sim.h"
+#include "imu.h"
+#include "control.h"
+#include "motor.h"
+#include "stats.h"
+#include "record.h"
+#include "autotune.h"
+#include "sysid.h"
+#include "friction.h"
+#include "executive.h"
+
+#define PI                    (3.14159265358979F)
+#define GYRO_MEASURE_ERROR    (PI * (40.0F / 180.0F)) /* same filter tuning as main.c */
+#define BETA(x)               (sqrtf(3.0F / 4.0F) * (x))
+#define DEFAULT_PID_KP        (100.0F) /* hold with pid2, the ones main.c boots with saturate and fall in this model */
+#define DEFAULT_PID_KD        (10.0F)
+#define DEFAULT_PID_KI        (20.0F)  /* without it a pitch offset spins the flywheel up until it can't push back */
+#define GRAVITY               (9.80665)
+#define PHYSICS_STEP          (1e-3)    /* seconds, midpoint rule. the fastest pole is the fall at ~11 rad/s, a step per sample is plenty */
+#define HOLD_SECONDS          (2.0)  /* held still at the start and after a fall while the estimator converges */
+#define VERTEX_ANGLE          (30.0 * M_PI / 180.0) /* past this the body leaves the vertex and rolls on an arc */
+#define FALL_ANGLE            (VERTEX_ANGLE)
+#define REST_ANGLE            (60.0 * M_PI / 180.0) /* lying on the middle of an arc, pitch 0, where it boots and calibrates */
+#define SETTLE_BAND           (0.5)  /* degrees */
+#define SETTLE_HOLD           (0.5)  /* seconds inside the band that count as settled */
+#define FRICTION_SPEED        (0.5)  /* rad/s, width of the tanh that smooths the coulomb friction through zero */
+#define ROLLING_DAMPING       (2e-3) /* Nms/rad, rocking on an arc dies out in a second or two, pivoting on the vertex loses nothing */
+#define REQUEST_DELAY         (1.0)  /* seconds after the first release, balancing on the starting gains, before --autotune or --sysid */
+
+typedef struct {
+    double mass;            /* kg, everything */
+    double com;             /* m, vertex to center of mass, the reuleaux width is sqrt(3) times this */
+    double inertia;         /* kgm2, body about the vertex */
+    double wheel_inertia;   /* kgm2, flywheel about its axis */
+    double kt;              /* Nm/A */
+    double ke;              /* Vs/rad */
+    double resistance;      /* ohm */
+    double vbat;            /* V */
+    double friction;        /* Nm, coulomb friction of the flywheel bearing and brushes */
+    double stiction;        /* Nm, breakaway torque of the wheel at rest */
+} Robot;
+
+typedef struct {
+    double theta;           /* rad, clockwise tilt off the vertex, pitch = CONTROL_DESIRED_ANGLE + theta */
+    double rate;            /* rad/s */
+    double wheel;           /* rad/s, flywheel relative to the body, positive the way a positive command spins it */
+} State;
+
+typedef struct {
+    Robot robot;
+    State state;
+    double t;               /* seconds of physics so far */
+    bool held;              /* someone holds it still, the motor does nothing */
+    bool stuck;             /* the wheel sits in its bearing, the motor torque stays inside the body */
+    double accel[2];        /* m/s2 of the center of mass in the world, x along the floor, y up */
+} World;
+
+static volatile bool imu_data_ready = false;
+static IMUSample imu_samples[FIFO_MAX_PACKETS];
+static Executive executive;
+
+static void imu_isr_handler(void *arg)
+{
+    imu_data_ready = true;
+}
+
+/* center of mass relative to the contact point and its slope, as a function of the tilt */
+static void contact_offset(const Robot *robot, double theta, double r[2], double slope[2])
+{
+    double d = robot->com;
+    double a = fabs(theta);
+    double sign = (theta < 0.0) ? -1.0 : 1.0;
+    double s = sin(a), c = cos(a);
+    double x, dx, y, dy;
+
+    if (a <= VERTEX_ANGLE)
+    {
+        x = d * s;
+        dx = d * c;
+        y = d * c;
+        dy = -d * s;
+    }
+    else
+    {
+        /* on the arc centered at the opposite vertex, which sits sqrt(3) d straight above the contact */
+        x = d * (0.5 * sqrt(3.0) * c - 0.5 * s);
+        dx = -d * (0.5 * sqrt(3.0) * s + 0.5 * c);
+        y = sqrt(3.0) * d - d * (0.5 * sqrt(3.0) * s + 0.5 * c);
+        dy = -x;
+    }
+    r[0] = sign * x;
+    r[1] = y;
+    slope[0] = dx;          /* d/dtheta of sign * x(|theta|) */
+    slope[1] = sign * dy;
+}
+
+static double motor_current(const Robot *robot, double wheel)
+{
+    double full = (double)hal_host_pwm_full_scale(PWM_IN1_CHANNEL);
+    double in1 = (double)hal_host_pwm_duty(PWM_IN1_CHANNEL);
+    double in2 = (double)hal_host_pwm_duty(PWM_IN2_CHANNEL);
+    double emf = robot->ke * wheel;
+
+    if (full <= 0.0 || (in1 == 0.0 && in2 == 0.0)) { return 0.0; } /* coasting, nothing flows */
+    if (in1 > 0.0 && in2 > 0.0)
+    {
+        /* brake decay: the winding is shorted between pulses, the average voltage drives it */
+        return (robot->vbat * (in1 - in2) / full - emf) / robot->resistance;
+    }
+    /* coast decay: current only flows during the pulse and stops once the back emf wins */
+    double sign = (in1 > 0.0) ? 1.0 : -1.0;
+    double duty = (in1 + in2) / full;
+    double current = duty * (robot->vbat - sign * emf) / robot->resistance;
+    return (current > 0.0) ? sign * current : 0.0;
+}
+
+/* theta'', wheel' and the acceleration of the center of mass */
+static void derivatives(const World *world, const State *state, double current, double *theta_acc, double *wheel_acc, double *accel)
+{
+    const Robot *robot = &world->robot;
+    double r[2], slope[2];
+    double torque = world->stuck ? 0.0 : robot->kt * current - robot->friction * tanh(state->wheel / FRICTION_SPEED);
+
+    contact_offset(robot, state->theta, r, slope);
+    double rx = r[0], ry = r[1];
+
+    /* inertia about the contact point, which moves once it rolls: J_c theta'' + J_c' theta'^2 / 2 + m g y' = torque */
+    double inertia_g = robot->inertia - robot->mass * robot->com * robot->com;
+    double inertia_c = inertia_g + robot->mass * (rx * rx + ry * ry);
+    double inertia_slope = 2.0 * robot->mass * (rx * slope[0] + ry * slope[1]);
+    double height_slope = slope[1];
+
+    double rolling = (fabs(state->theta) > VERTEX_ANGLE) ? ROLLING_DAMPING * state->rate : 0.0;
+    *theta_acc = (torque - rolling - 0.5 * inertia_slope * state->rate * state->rate - robot->mass * GRAVITY * height_slope) / inertia_c;
+    *wheel_acc = world->stuck ? 0.0 : *theta_acc + torque / robot->wheel_inertia;
+    /* v = theta' (ry, -rx), differentiated */
+    double rx_slope = slope[0];
+    accel[0] = *theta_acc * ry + state->rate * state->rate * height_slope;
+    accel[1] = -*theta_acc * rx - state->rate * state->rate * rx_slope;
+}
+
+static void physics_advance(World *world, double t)
+{
+    while (world->t < t)
+    {
+        double step = fmin(PHYSICS_STEP, t - world->t);
+        if (world->held)
+        {
+            world->state.rate = 0.0;
+            world->state.wheel = 0.0;
+            world->stuck = true;
+            world->accel[0] = 0.0;
+            world->accel[1] = 0.0;
+            world->t += step;
+            continue;
+        }
+
+        /* the duty only changes between control passes, so the current is held over the step */
+        double current = motor_current(&world->robot, world->state.wheel);
+        double wheel = world->state.wheel;
+        world->stuck = (world->stuck || wheel == 0.0) && fabs(world->robot.kt * current) <= world->robot.stiction;
+        /* midpoint rule, the slope halfway through carries the whole step */
+        State half = world->state;
+        double theta_acc, wheel_acc, accel[2];
+        derivatives(world, &world->state, current, &theta_acc, &wheel_acc, world->accel);
+        half.theta += 0.5 * step * half.rate;
+        half.rate += 0.5 * step * theta_acc;
+        half.wheel += 0.5 * step * wheel_acc;
+        derivatives(world, &half, current, &theta_acc, &wheel_acc, accel);
+        world->state.theta += step * half.rate;
+        world->state.rate += step * theta_acc;
+        world->state.wheel += step * wheel_acc;
+        /* through zero with less than the breakaway torque behind it, it stays there */
+        if (wheel * world->state.wheel < 0.0 && fabs(world->robot.kt * current) <= world->robot.stiction) { world->state.wheel = 0.0; }
+        world->t += step;
+    }
+}
+
+/* same axes as imu_sim: pitch rate on gyro x, gravity in the y-z plane, main.c remaps (gy, gx, -gz, ay, ax, -az) */
+static void motion_source(double t, SimMotion *out, void *arg)
+{
+    World *world = (World *)arg;
+    physics_advance(world, t);
+
+    double pitch = (double)CONTROL_DESIRED_ANGLE * M_PI / 180.0 + world->state.theta;
+    double force[2] = { world->accel[0] / GRAVITY, world->accel[1] / GRAVITY + 1.0 }; /* specific force, g */
+    out->gyro[0] = (float)(world->state.rate * 180.0 / M_PI);
+    out->gyro[1] = 0.0F;
+    out->gyro[2] = 0.0F;
+    out->accel[0] = 0.0F;
+    out->accel[1] = (float)(force[0] * cos(pitch) - force[1] * sin(pitch));
+    out->accel[2] = (float)(-force[0] * sin(pitch) - force[1] * cos(pitch));
+}
+
+static bool odr_codes(int hz, uint8_t *accel, uint8_t *gyro)
+{
+    switch (hz)
+    {
+        case 500:  *accel = AODR_500Hz; *gyro = GODR_500Hz; return true;
+        case 1000: *accel = AODR_1kHz;  *gyro = GODR_1kHz;  return true;
+        case 2000: *accel = AODR_2kHz;  *gyro = GODR_2kHz;  return true;
+        case 4000: *accel = AODR_4kHz;  *gyro = GODR_4kHz;  return true;
+        default:   return false;
+    }
+}
+
+/* what record_flash.c does on the robot, minus the pages */
+static void record_to_file(FILE *file)
+{
+    uint8_t buffer[4096];
+    size_t count;
+
+    while ((count = record_drain(buffer, sizeof(buffer))) > 0U) { fwrite(buffer, 1U, count, file); }
+}
+
+/* the csv a client reads off the sysid characteristic, for sysid_fit. false and the status in it without a capture */
+static bool sysid_to_file(FILE *file, char *status, size_t size)
+{
+    char buffer[SIZEOF_SYSID_DATA];
+    size_t length = sysid_read(buffer, sizeof(buffer));
+
+    if (length == 0U || buffer[0] != '#') { snprintf(status, size, "%s", buffer); return false; }
+    do { fwrite(buffer, 1U, length, file); }
+    while ((length = sysid_read(buffer, sizeof(buffer))) > 0U && strcmp(buffer, "end") != 0);
+    return true;
+}
+
+static double wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    Icm42688SimConfig config;
+    Icm42688Sim sim;
+    IMU imu;
+    Control control;
+    World world = { { 0.30, 0.05, 1.2e-3, 1.5e-5, 0.005, 0.005, 2.0, 3.7, 2e-4, 5e-4 }, { 0.0, 0.0, 0.0 }, 0.0, true, true, { 0.0, 0.0 } };
+    double seconds = 60.0;
+    double tilt = 2.0;
+    double push = 10.0;     /* dps, at 20 the 200 count limit can't bring it back from some of them */
+    double push_period = 5.0;
+    double noise = 1.0;
+    int odr = 1000;
+    uint16_t watermark = 5U;
+    float kp = DEFAULT_PID_KP, kd = DEFAULT_PID_KD, ki = DEFAULT_PID_KI;
+    uint8_t accel_odr, gyro_odr;
+    const char *record_path = NULL;
+    FILE *record_file = NULL;
+    int tune_rule = -1;
+    bool tuned = false;
+    const char *sysid_path = NULL;
+    SysidSignal sysid_signal = SYSID_PRBS;
+    bool requested = false;         /* the autotune or sysid request went out */
+    bool friction_calibrate = false;
+    FrictionCal friction_cal = { 0 };
+    bool control_active = false, was_active = false;
+    bool show_stats = false;
+
+    icm42688_sim_default_config(&config);
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--seconds") == 0 && has_value)            { seconds = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--tilt") == 0 && has_value)          { tilt = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--push") == 0 && has_value)          { push = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--push-period") == 0 && has_value)   { push_period = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--odr") == 0 && has_value)           { odr = atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--watermark") == 0 && has_value)     { watermark = (uint16_t)atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--noise") == 0 && has_value)         { noise = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--gyro-bias") == 0 && has_value)     { config.gyro_bias[0] = (float)atof(argv[++i]); }
+        else if (strcmp(argv[i], "--seed") == 0 && has_value)          { config.seed = (uint32_t)strtoul(argv[++i], NULL, 0); }
+        else if (strcmp(argv[i], "--kp") == 0 && has_value)            { kp = (float)atof(argv[++i]); }
+        else if (strcmp(argv[i], "--kd") == 0 && has_value)            { kd = (float)atof(argv[++i]); }
+        else if (strcmp(argv[i], "--ki") == 0 && has_value)            { ki = (float)atof(argv[++i]); }
+        else if (strcmp(argv[i], "--mass") == 0 && has_value)          { world.robot.mass = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--com") == 0 && has_value)           { world.robot.com = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--inertia") == 0 && has_value)       { world.robot.inertia = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--wheel-inertia") == 0 && has_value) { world.robot.wheel_inertia = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--friction") == 0 && has_value)      { world.robot.friction = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--stiction") == 0 && has_value)      { world.robot.stiction = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--vbat") == 0 && has_value)          { world.robot.vbat = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--record") == 0 && has_value)        { record_path = argv[++i]; }
+        else if (strcmp(argv[i], "--autotune") == 0 && has_value)      { tune_rule = atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--sysid") == 0 && has_value)         { sysid_path = argv[++i]; }
+        else if (strcmp(argv[i], "--sysid-signal") == 0 && has_value)  { sysid_signal = (SysidSignal)atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--friction-cal") == 0)               { friction_calibrate = true; }
+        else if (strcmp(argv[i], "--stats") == 0)                      { show_stats = true; }
+        else if (strcmp(argv[i], "--verbose") == 0)                    { hal_host_set_log_level(ESP_LOG_INFO); }
+        else { fprintf(stderr, "unknown argument %s, see the header of balance_sim.c\n", argv[i]); return 1; }
+    }
+    if (!odr_codes(odr, &accel_odr, &gyro_odr)) { fprintf(stderr, "odr goes in 500, 1000, 2000 or 4000 Hz\n"); return 1; }
+    if (tune_rule >= (int)AUTOTUNE_RULE_COUNT) { fprintf(stderr, "--autotune takes a rule from 0 to %d\n", (int)AUTOTUNE_RULE_COUNT - 1); return 1; }
+    if ((unsigned)sysid_signal >= SYSID_SIGNAL_COUNT) { fprintf(stderr, "--sysid-signal takes 0 for prbs or 1 for the chirp\n"); return 1; }
+    if (tune_rule >= 0 && sysid_path != NULL) { fprintf(stderr, "--autotune and --sysid both take over the controller, pick one\n"); return 1; }
+    if (world.robot.inertia <= world.robot.mass * world.robot.com * world.robot.com)
+    {
+        fprintf(stderr, "the inertia about the vertex has to be more than mass * com^2\n");
+        return 1;
+    }
+    config.accel_noise *= (float)noise;
+    config.gyro_noise *= (float)noise;
+    world.state.theta = REST_ANGLE;
+    hal_host_set_cycle_counter(show_stats); /* two clock reads per probe, a good part of the run when nobody looks */
+
+    if (record_path != NULL)
+    {
+        record_file = fopen(record_path, "wb");
+        if (record_file == NULL) { fprintf(stderr, "can't write %s\n", record_path); return 1; }
+        record_request((uint32_t)ceil(seconds));
+    }
+
+    double wall_start = wall_seconds();
+    icm42688_sim_init(&sim, &config, motion_source, &world);
+    hal_host_attach_imu(&sim, ICM42688_ADDR, IMU_INT1);
+
+    /* same bring up as app_main, minus the stored calibration, lying on its side like it does on the desk */
+    init_i2c();
+    if (!imu_wait_ready(IMU_READY_TIMEOUT_MS)) { fprintf(stderr, "imu did not answer\n"); return 1; }
+    imu_init(&imu, AFS_2G, GFS_500DPS, accel_odr, gyro_odr, aMode_LN, gMode_LN, false, true);
+    imu_calculate_bias(&imu);
+    init_pwm();
+    control_init(&control, BETA(GYRO_MEASURE_ERROR), imu.sample_period, CONTROL_DESIRED_ANGLE);
+    stats_init();
+    hal_gpio_irq_init(IMU_INT1, imu_isr_handler, NULL);
+    imu_fifo_enable(&imu, watermark);
+
+    ExecConfig exec_config;
+    exec_default_config(&exec_config, (int64_t)(imu.sample_period * 1000000.0F) * watermark);
+    exec_init(&executive, &exec_config);
+    if (friction_calibrate) { world.held = false; } /* free on its side while the wheel ramps, stood up afterwards */
+    else                    { world.state.theta = tilt * M_PI / 180.0; } /* stood up on its corner and held there until the estimator caught up */
+
+    double start = (double)hal_clock_now_us() * 1e-6;
+    double end = start + seconds;
+    double release = start + HOLD_SECONDS;
+    double first_release = -1.0;
+    double next_push = release + push_period;
+    double push_sign = 1.0;
+    double event = release;           /* last release or push, settle time counts from here */
+    double inside_since = -1.0;       /* entered the settle band, -1 while outside */
+    bool settled = false;
+    uint32_t events = 0U, settled_events = 0U, falls = 0U;
+    double settle_sum = 0.0, settle_max = 0.0;
+    double error_sum2 = 0.0, error_max = 0.0, estimate_sum2 = 0.0, wheel_max = 0.0;
+    uint64_t passes = 0U, saturated = 0U;
+    double active_seconds = 0.0;
+
+    while (hal_clock_now_us() < (int64_t)(end * 1e6))
+    {
+        if (!imu_data_ready)
+        {
+            hal_host_wait_irq((int64_t)(end * 1e6) - hal_clock_now_us());
+            continue;
+        }
+        imu_data_ready = false;
+        exec_pass_begin(&executive);
+        stats_pass();
+
+        /* sense */
+        STATS_BEGIN(read_start);
+        uint16_t count = imu_fifo_read_start(&imu, FIFO_MAX_PACKETS);
+        if (count > 0U) { count = imu_fifo_read_finish(&imu, imu_samples); }
+        STATS_END(STATS_IMU_READ, read_start);
+        exec_stage_end(&executive, EXEC_STAGE_SENSE);
+        ExecAction action = exec_after_sense(&executive, count, watermark, imu.sample_period);
+        double now = (double)hal_clock_now_us() * 1e-6;
+        physics_advance(&world, now); /* up to the moment the new duty goes out */
+
+        if (world.held && now >= release)
+        {
+            world.held = false;
+            control_active = true;
+            if (first_release < 0.0) { first_release = now; }
+            event = now;
+            events++;
+            settled = false;
+            inside_since = -1.0;
+        }
+        if (control_active && push != 0.0 && now >= next_push && !autotune_running() && !sysid_capturing())
+        {
+            /* a flick to the body, alternating sides */
+            world.state.rate += push_sign * push * M_PI / 180.0;
+            push_sign = -push_sign;
+            next_push += push_period;
+            if (!settled) { settle_sum += now - event; settle_max = fmax(settle_max, now - event); } /* never got there */
+            event = now;
+            events++;
+            settled = false;
+            inside_since = -1.0;
+        }
+
+        if (record_file != NULL)
+        {
+            /* a file needs no erasing, whatever a request asks for is ready right away */
+            uint32_t wanted = record_erase_request();
+            if (wanted > 0U) { record_prepared(wanted); }
+            record_poll(control_active, &control, &imu);
+        }
+        /* what a write to 0xEEE2 or the sysid characteristic would ask for, a second into balancing */
+        if (control_active && first_release >= 0.0 && now >= first_release + REQUEST_DELAY && !requested)
+        {
+            if (tune_rule >= 0)     { autotune_request((AutotuneRule)tune_rule); }
+            if (sysid_path != NULL) { sysid_request(sysid_signal, SYSID_DEFAULT_AMPLITUDE); }
+            requested = true;
+        }
+        if (tune_rule >= 0 && requested) { autotune_confirm(true); } /* only counts once the gains are proposed */
+
+        /* the rest of the pass is the control task's, with the ble writes and the leds left out */
+        exec_stage_begin(&executive);
+        if (action == EXEC_HOLD) { control_hold(&control, imu.sample_period * (float)watermark); }
+        else                     { control_estimate(&control, &imu, imu_samples, count); }
+        exec_stage_end(&executive, EXEC_STAGE_ESTIMATE);
+
+        if (control_active && !was_active) { exec_rearm(&executive); }
+        was_active = control_active;
+
+        if (friction_calibrate && !control_active && !friction_cal_running(&friction_cal)) { friction_cal_start(&friction_cal); }
+        friction_calibrate = false;
+        if (friction_cal_running(&friction_cal) && (control_active || action == EXEC_STOP)) { friction_cal_abort(&friction_cal); }
+
+        float gains[3];
+        if (autotune_poll(control_active && action != EXEC_STOP, &gains[0], &gains[1], &gains[2]))
+        {
+            kp = gains[0];
+            kd = gains[1];
+            ki = gains[2];
+            tuned = true;
+        }
+        sysid_poll(control_active && action != EXEC_STOP && !autotune_running());
+
+        if (friction_cal_running(&friction_cal))
+        {
+            if (action != EXEC_SKIP) { set_motor_command(friction_cal_step(&friction_cal, control.rate)); }
+            if (friction_cal.phase == FRICTION_CAL_DONE || friction_cal.phase == FRICTION_CAL_FAILED)
+            {
+                stop_motor();
+                if (friction_cal.phase == FRICTION_CAL_DONE) { friction_set(&control.friction, friction_cal.breakaway[0], friction_cal.breakaway[1]); }
+                /* picked up off its side and put on its corner */
+                world.held = true;
+                world.state.theta = tilt * M_PI / 180.0;
+                world.state.rate = 0.0;
+                world.state.wheel = 0.0;
+                release = now + HOLD_SECONDS;
+                next_push = release + push_period;
+            }
+        }
+        else if (!control_active || action == EXEC_STOP || action == EXEC_SKIP)
+        {
+            if (action != EXEC_SKIP) { control_stop(&control); }
+        }
+        else
+        {
+            exec_stage_begin(&executive);
+            bool computed = control_compute(&control, kp, kd, ki);
+            if (computed && autotune_running())
+            {
+                control.command = autotune_step(control.error, control.rate, control.step);
+                if (!autotune_running()) { control_restart(&control); }
+            }
+            else if (computed && sysid_capturing()) { control.command += sysid_excitation(control.step); }
+            exec_stage_end(&executive, EXEC_STAGE_CONTROL);
+            if (computed && exec_check_fall(&executive, control.error) != EXEC_STOP)
+            {
+                exec_stage_begin(&executive);
+                control_actuate(&control);
+                exec_stage_end(&executive, EXEC_STAGE_ACTUATE);
+            }
+        }
+        exec_pass_end(&executive);
+        if (record_file != NULL) { record_to_file(record_file); }
+        if (!control_active) { continue; }
+
+        double error = fabs(world.state.theta) * 180.0 / M_PI;
+        passes++;
+        active_seconds += (double)count * imu.sample_period;
+        error_sum2 += error * error * (double)count;
+        estimate_sum2 += ((double)control.error + world.state.theta * 180.0 / M_PI) * ((double)control.error + world.state.theta * 180.0 / M_PI) * (double)count;
+        error_max = fmax(error_max, error);
+        wheel_max = fmax(wheel_max, fabs(world.state.wheel));
+        if (fabsf(control.command) >= (float)CONTROL_MAX_DUTY_CYCLE) { saturated++; }
+
+        if (error < SETTLE_BAND)
+        {
+            if (inside_since < 0.0) { inside_since = now; }
+            if (!settled && now - inside_since >= SETTLE_HOLD)
+            {
+                settled = true;
+                settled_events++;
+                settle_sum += inside_since - event;
+                settle_max = fmax(settle_max, inside_since - event);
+            }
+        }
+        else { inside_since = -1.0; }
+
+        if (fabs(world.state.theta) > FALL_ANGLE)
+        {
+            /* picked up and put back on its corner, held until the estimator caught up again */
+            if (!settled) { settle_sum += now - event; settle_max = fmax(settle_max, now - event); }
+            settled = true;
+            falls++;
+            world.held = true;
+            control_active = false;
+            world.state.theta = tilt * M_PI / 180.0;
+            world.state.rate = 0.0;
+            world.state.wheel = 0.0;
+            release = now + HOLD_SECONDS;
+            next_push = release + push_period;
+        }
+    }
+
+    if (record_file != NULL)
+    {
+        record_request(0U);
+        record_poll(false, &control, &imu);
+        record_to_file(record_file);
+        fclose(record_file);
+    }
+
+    double wall = wall_seconds() - wall_start;
+    double simulated = (double)hal_clock_now_us() * 1e-6;
+    const MotorStats *motor = motor_stats();
+    char status[SIZEOF_SYSID_DATA];
+    bool captured = false;
+
+    if (sysid_path != NULL)
+    {
+        FILE *sysid_file = fopen(sysid_path, "w");
+        if (sysid_file == NULL) { fprintf(stderr, "can't write %s\n", sysid_path); return 1; }
+        captured = sysid_to_file(sysid_file, status, sizeof(status));
+        fclose(sysid_file);
+    }
+
+    printf("simulated time     %.3f s in %.3f s wall, %.0fx real time\n", simulated, wall, simulated / wall);
+    printf("balancing          %.1f s, %d Hz odr, %u samples per pass, %u falls\n", active_seconds, odr, watermark, falls);
+    printf("settle time        %.3f s mean, %.3f s max over %u events, %u settled within %.1f deg\n",
+           (events > 0U) ? settle_sum / (double)events : 0.0, settle_max, events, settled_events, SETTLE_BAND);
+    printf("pitch error        %.4f deg rms, %.3f deg max\n", (active_seconds > 0.0) ? sqrt(error_sum2 / (active_seconds / imu.sample_period)) : 0.0, error_max);
+    printf("estimate error     %.4f deg rms, controller's pitch against the true one\n",
+           (active_seconds > 0.0) ? sqrt(estimate_sum2 / (active_seconds / imu.sample_period)) : 0.0);
+    printf("saturation         %.2f%% of %llu passes at +-%u\n", (passes > 0U) ? 100.0 * (double)saturated / (double)passes : 0.0,
+           (unsigned long long)passes, CONTROL_MAX_DUTY_CYCLE);
+    if (tune_rule >= 0)
+    {
+        char status[SIZEOF_AUTOTUNE_DATA];
+        autotune_string(status, sizeof(status));
+        if (tuned) { printf("autotune           kp %.2f kd %.2f ki %.2f in use since the relay\n", kp, kd, ki); }
+        else       { printf("autotune           %s\n", status); }
+    }
+    if (sysid_path != NULL)
+    {
+        if (captured) { printf("sysid              %u samples of %s written to %s\n", SYSID_CAPTURE_SAMPLES, (sysid_signal == SYSID_PRBS) ? "prbs" : "chirp", sysid_path); }
+        else          { printf("sysid              no capture, %s\n", status); }
+    }
+    if (friction_cal.phase == FRICTION_CAL_DONE)
+    {
+        printf("friction cal       breakaway %.1f / %.1f counts, compensated from there\n", friction_cal.breakaway[0], friction_cal.breakaway[1]);
+    }
+    else if (friction_cal.phase != FRICTION_CAL_IDLE) { printf("friction cal       failed, the wheel never moved the body\n"); }
+    printf("executive          %lu deadline misses, %lu held, %lu stops, overruns %lu/%lu/%lu/%lu\n", (unsigned long)executive.deadline_misses,
+           (unsigned long)executive.held, (unsigned long)executive.stops, (unsigned long)executive.overruns[EXEC_STAGE_SENSE],
+           (unsigned long)executive.overruns[EXEC_STAGE_ESTIMATE], (unsigned long)executive.overruns[EXEC_STAGE_CONTROL],
+           (unsigned long)executive.overruns[EXEC_STAGE_ACTUATE]);
+    printf("motor              %lu channel writes, %lu skipped, flywheel at %.1f rad/s, %.1f at most\n", (unsigned long)motor->writes,
+           (unsigned long)motor->skipped, world.state.wheel, wheel_max);
+    if (show_stats)
+    {
+        char stats[512];
+        stats_string(stats, sizeof(stats));
+        printf("stats (host ns)    %s\n", stats);
+    }
+    return (falls > 0U) ? 2 : 0;
+}
\ No newline at end of file
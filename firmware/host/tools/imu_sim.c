@@ -0,0 +1,365 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * imu_sim.c - runs the real imu driver (self-test, bias calibration, fifo batches) and the madgwick
+ * filter against the simulated ICM-42688, faster than real time. motion is either a synthetic pitch
+ * oscillation or a csv recording, the estimated pitch is checked against the true one. built with
+ * CONTROL_FIXED_POINT the fixed-point filter is also checked against a float one fed the same samples, exit code 2
+ * if it strays past the FIXED_* bounds.
+ * every estimator backend runs on the same samples too, for the accuracy and the cost of each
+ *  
+ * usage: imu_sim [--seconds s] [--amplitude deg] [--frequency hz] [--drift ppm] [--bias-drift dps_per_hour] [--seed n]
+ *                [--watermark n] [--csv file] [--verbose]
+ * csv rows are t_s,ax,ay,az,gx,gy,gz[,pitch_deg] in the sensor frame, g and dps
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "hal_host.h"
+#include "icm42688_sim.h"
+#include "imu.h"
+#include "control.h"
+#include "stats.h"
+#include "estimator.h"
+
+#define PI                    (3.14159265358979F)
+#define GYRO_MEASURE_ERROR    (PI * (40.0F / 180.0F)) /* same filter tuning as main.c */
+#define BETA(x)               (sqrtf(3.0F / 4.0F) * (x))
+#define SETTLE_SECONDS        (1.0)  /* filter convergence, not counted in the error */
+#define CSV_MAX_ROWS          (1U << 20U)
+#define FIXED_PITCH_RMS       (0.005) /* degrees, fixed point against float over every batch, convergence included */
+#define FIXED_PITCH_MAX       (0.05)  /* the worst seen is 0.029, with one sample per batch */
+#define FIXED_QUATERNION_MAX  (1e-3)  /* per component, the worst seen is 4e-4 */
+
+typedef struct {
+    double amplitude;   /* degrees */
+    double frequency;   /* hz */
+    double start;       /* seconds, the robot sits still before this like it does while calibrating */
+    /* recorded motion, used instead of the synthetic one when rows > 0 */
+    double *t;
+    float (*row)[7];    /* ax, ay, az, gx, gy, gz, pitch */
+    size_t rows;
+} Motion;
+
+static volatile bool imu_data_ready = false;
+static IMUSample imu_samples[FIFO_MAX_PACKETS];
+
+static void imu_isr_handler(void *arg)
+{
+    imu_data_ready = true;
+}
+
+/* pitch about the filter's y axis, main.c feeds the filter (gy, gx, -gz, ay, ax, -az) of the sensor frame */
+static double synthetic_pitch(const Motion *motion, double t, double *rate)
+{
+    double w = 2.0 * M_PI * motion->frequency;
+    t -= motion->start;
+    if (t < 0.0) { *rate = 0.0; return 0.0; }
+    *rate = motion->amplitude * w * cos(w * t); /* dps */
+    return motion->amplitude * sin(w * t);      /* degrees */
+}
+
+static size_t csv_index(const Motion *motion, double t)
+{
+    size_t low = 0U;
+    size_t high = motion->rows - 1U;
+
+    while (high - low > 1U)
+    {
+        size_t mid = (low + high) / 2U;
+        if (motion->t[mid] <= t) { low = mid; } else { high = mid; }
+    }
+    return low;
+}
+
+static void recorded_sample(const Motion *motion, double t, float *out)
+{
+    if (t <= motion->t[0]) { memcpy(out, motion->row[0], sizeof(motion->row[0])); return; }
+    if (t >= motion->t[motion->rows - 1U]) { memcpy(out, motion->row[motion->rows - 1U], sizeof(motion->row[0])); return; }
+
+    size_t i = csv_index(motion, t);
+    float k = (float)((t - motion->t[i]) / (motion->t[i + 1U] - motion->t[i]));
+    for (uint8_t j = 0U; j < 7U; j++) { out[j] = motion->row[i][j] + k * (motion->row[i + 1U][j] - motion->row[i][j]); }
+}
+
+static void motion_source(double t, SimMotion *out, void *arg)
+{
+    const Motion *motion = (const Motion *)arg;
+
+    if (motion->rows > 0U)
+    {
+        float sample[7U];
+        recorded_sample(motion, t, sample);
+        for (uint8_t i = 0U; i < 3U; i++)
+        {
+            out->accel[i] = sample[i];
+            out->gyro[i] = sample[i + 3U];
+        }
+        return;
+    }
+
+    double rate = 0.0;
+    double pitch = synthetic_pitch(motion, t, &rate) * M_PI / 180.0;
+    out->gyro[0] = (float)rate;
+    out->gyro[1] = 0.0F;
+    out->gyro[2] = 0.0F;
+    out->accel[0] = 0.0F;
+    out->accel[1] = (float)-sin(pitch);
+    out->accel[2] = (float)-cos(pitch);
+}
+
+static double true_pitch(const Motion *motion, double t)
+{
+    if (motion->rows > 0U)
+    {
+        float sample[7U];
+        recorded_sample(motion, t, sample);
+        return (double)sample[6];
+    }
+
+    double rate = 0.0;
+    return synthetic_pitch(motion, t, &rate);
+}
+
+static bool load_csv(Motion *motion, const char *path, bool *has_pitch)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+
+    if (file == NULL) { fprintf(stderr, "cannot open %s\n", path); return false; }
+    motion->t = malloc(CSV_MAX_ROWS * sizeof(*motion->t));
+    motion->row = malloc(CSV_MAX_ROWS * sizeof(*motion->row));
+    motion->rows = 0U;
+    *has_pitch = true;
+
+    while (fgets(line, sizeof(line), file) != NULL && motion->rows < CSV_MAX_ROWS)
+    {
+        double t = 0.0;
+        float *row = motion->row[motion->rows];
+        int fields = sscanf(line, "%lf,%f,%f,%f,%f,%f,%f,%f", &t, &row[0], &row[1], &row[2], &row[3], &row[4], &row[5], &row[6]);
+        if (fields < 7) { continue; } /* header or junk */
+        if (fields == 7) { row[6] = 0.0F; *has_pitch = false; }
+        motion->t[motion->rows++] = t;
+    }
+    fclose(file);
+
+    if (motion->rows < 2U) { fprintf(stderr, "%s has less than two samples\n", path); return false; }
+    return true;
+}
+
+static double wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    Icm42688SimConfig config;
+    Icm42688Sim sim;
+    Motion motion = { 10.0, 1.0, INFINITY, NULL, NULL, 0U };
+    IMU imu;
+    Control control;
+    double seconds = 10.0;
+    uint16_t watermark = 5U;
+    bool has_pitch = true;
+
+    icm42688_sim_default_config(&config);
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--seconds") == 0 && has_value)        { seconds = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--amplitude") == 0 && has_value) { motion.amplitude = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--frequency") == 0 && has_value) { motion.frequency = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--drift") == 0 && has_value)     { config.clock_drift_ppm = (float)atof(argv[++i]); }
+        else if (strcmp(argv[i], "--bias-drift") == 0 && has_value) { config.gyro_bias_drift = (float)atof(argv[++i]); }
+        else if (strcmp(argv[i], "--seed") == 0 && has_value)      { config.seed = (uint32_t)strtoul(argv[++i], NULL, 0); }
+        else if (strcmp(argv[i], "--watermark") == 0 && has_value) { watermark = (uint16_t)atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--csv") == 0 && has_value)       { if (!load_csv(&motion, argv[++i], &has_pitch)) { return 1; } }
+        else if (strcmp(argv[i], "--verbose") == 0)                { hal_host_set_log_level(ESP_LOG_INFO); }
+        else { fprintf(stderr, "unknown argument %s, see the header of imu_sim.c\n", argv[i]); return 1; }
+    }
+
+    double wall_start = wall_seconds();
+    icm42688_sim_init(&sim, &config, motion_source, &motion);
+    hal_host_attach_imu(&sim, ICM42688_ADDR, IMU_INT1);
+
+    /* same bring up as app_main, minus the stored calibration */
+    init_i2c();
+    if (!imu_wait_ready(IMU_READY_TIMEOUT_MS)) { fprintf(stderr, "imu did not answer\n"); return 1; }
+    imu_init(&imu, AFS_2G, GFS_500DPS, AODR_1kHz, GODR_1kHz, aMode_LN, gMode_LN, false, true);
+    imu_calculate_bias(&imu);
+    control_init(&control, BETA(GYRO_MEASURE_ERROR), imu.sample_period, CONTROL_DESIRED_ANGLE);
+    stats_init();
+    hal_gpio_irq_init(IMU_INT1, imu_isr_handler, NULL);
+    imu_fifo_enable(&imu, watermark);
+
+    int64_t start_us = hal_clock_now_us();
+    motion.start = (double)start_us * 1e-6;
+    int64_t end_us = start_us + (int64_t)(seconds * 1e6);
+    double ppm = 1.0 + (double)config.clock_drift_ppm * 1e-6;
+    bool unwrapped_valid = false;
+    uint64_t sensor_us = 0U;   /* 16-bit fifo timestamps unwrapped into the sensor's own time */
+    uint16_t last_stamp = 0U;
+    uint64_t samples = 0U;
+    uint64_t batches = 0U;
+    uint64_t error_count = 0U;
+    double error_sum2 = 0.0;
+    double error_max = 0.0;
+    /* every estimator backend on the same samples, whatever control.c was built with */
+    Estimator bench[ESTIMATOR_COUNT];
+    EstimatorConfig bench_config;
+    Timebase bench_timebase;
+    uint64_t bench_ns[ESTIMATOR_COUNT] = { 0U };
+    double bench_sum2[ESTIMATOR_COUNT] = { 0.0 };
+    double bench_max[ESTIMATOR_COUNT] = { 0.0 };
+    estimator_default_config(&bench_config, BETA(GYRO_MEASURE_ERROR), imu.sample_period);
+    for (uint8_t k = 0U; k < ESTIMATOR_COUNT; k++) { estimator_init(&bench[k], (EstimatorKind)k, &bench_config); }
+    timebase_init(&bench_timebase, imu.sample_period, TIMEBASE_TICK_US);
+#if CONTROL_FIXED_POINT
+    double fixed_sum2 = 0.0;
+    double fixed_max = 0.0;
+    float quaternion_max = 0.0F;
+#endif
+
+    while (hal_clock_now_us() < end_us)
+    {
+        if (!imu_data_ready)
+        {
+            hal_host_wait_irq(end_us - hal_clock_now_us());
+            continue;
+        }
+        imu_data_ready = false;
+        stats_pass();
+
+        STATS_BEGIN(read_start);
+        uint16_t count = imu_fifo_read_start(&imu, FIFO_MAX_PACKETS);
+        if (count > 0U) { count = imu_fifo_read_finish(&imu, imu_samples); }
+        STATS_END(STATS_IMU_READ, read_start);
+        batches++;
+
+        for (uint16_t i = 0U; i < count; i++)
+        {
+            if (unwrapped_valid) { sensor_us += (uint16_t)(imu_samples[i].timestamp - last_stamp); }
+            last_stamp = imu_samples[i].timestamp;
+            samples++;
+        }
+        if (count > 0U && !unwrapped_valid)
+        {
+            /* the newest sample is only the bus transfer old, pick the rollover period that puts it right before now */
+            uint64_t now_sensor = (uint64_t)((double)hal_clock_now_us() / ppm);
+            sensor_us = now_sensor - (uint16_t)((uint16_t)now_sensor - last_stamp);
+            unwrapped_valid = true;
+        }
+
+        control_estimate(&control, &imu, imu_samples, count); /* the control task's estimate stage, control stays off */
+        Madgwick *attitude = control_attitude(&control);
+        madgwick_get_rpy(attitude);
+        for (uint16_t i = 0U; i < count; i++)
+        {
+            float deltat = timebase_update(&bench_timebase, imu_samples[i].timestamp);
+            imu_convert_sample(&imu, &imu_samples[i]);
+            for (uint8_t k = 0U; k < ESTIMATOR_COUNT; k++)
+            {
+                uint32_t begin = hal_cycle_count();
+                estimator_update(&bench[k], (imu.gy*PI/180.0F), (imu.gx*PI/180.0F), -(imu.gz*PI/180.0F), imu.ay, imu.ax, -imu.az, deltat);
+                bench_ns[k] += hal_cycle_count() - begin;
+            }
+        }
+#if CONTROL_FIXED_POINT
+        if (count > 0U)
+        {
+            Madgwick *reference = &bench[ESTIMATOR_MADGWICK].state.madgwick;
+            const float q[4] = { reference->q1 - attitude->q1, reference->q2 - attitude->q2, reference->q3 - attitude->q3, reference->q4 - attitude->q4 };
+            for (uint8_t j = 0U; j < 4U; j++) { if (fabsf(q[j]) > quaternion_max) { quaternion_max = fabsf(q[j]); } }
+            double difference = fabs((double)(madgwick_pitch(reference) - attitude->pitch));
+            fixed_sum2 += difference * difference;
+            if (difference > fixed_max) { fixed_max = difference; }
+        }
+#endif
+        double t = (double)sensor_us * ppm * 1e-6;
+        if (count > 0U && has_pitch && t - (double)start_us * 1e-6 >= SETTLE_SECONDS)
+        {
+            double truth = true_pitch(&motion, t);
+            double error = fabs((double)attitude->pitch - truth);
+            error_sum2 += error * error;
+            if (error > error_max) { error_max = error; }
+            error_count++;
+            for (uint8_t k = 0U; k < ESTIMATOR_COUNT; k++)
+            {
+                error = fabs((double)estimator_get_pitch(&bench[k]) - truth);
+                bench_sum2[k] += error * error;
+                if (error > bench_max[k]) { bench_max[k] = error; }
+            }
+        }
+    }
+
+    double wall = wall_seconds() - wall_start;
+    double simulated = (double)hal_clock_now_us() * 1e-6;
+    const HalHostBusStats *bus = hal_host_bus_stats();
+
+    printf("simulated time     %.3f s in %.3f s wall, %.0fx real time\n", simulated, wall, simulated / wall);
+    printf("samples            %llu in %llu batches, %llu odr ticks\n", (unsigned long long)samples, (unsigned long long)batches, (unsigned long long)sim.samples);
+    printf("fifo               %lu overflows, %lu lost packets\n", (unsigned long)imu.fifo_overflows, (unsigned long)imu.fifo_lost_packets);
+    printf("bus                %lu transfers, %llu bytes, %.1f%% busy, %lu errors\n", (unsigned long)bus->transfers, (unsigned long long)bus->bytes,
+           100.0 * (double)bus->busy_us * 1e-6 / simulated, (unsigned long)bus->errors);
+    printf("self-test ratio    a %.2f %.2f %.2f  g %.2f %.2f %.2f\n", imu.st_ratio[0], imu.st_ratio[1], imu.st_ratio[2], imu.st_ratio[3], imu.st_ratio[4], imu.st_ratio[5]);
+    printf("gyro bias          %.3f %.3f %.3f dps (true %.3f %.3f %.3f)\n", imu.gxbias, imu.gybias, imu.gzbias,
+           config.gyro_bias[0], config.gyro_bias[1], config.gyro_bias[2]);
+    printf("accel bias         %.4f %.4f %.4f g (true %.4f %.4f %.4f)\n", imu.axbias, imu.aybias, imu.azbias,
+           config.accel_bias[0], config.accel_bias[1], config.accel_bias[2]);
+    printf("timebase jitter    %.2f us, %lu outliers\n", timebase_jitter(&control.timebase) * 1e6F, (unsigned long)control.timebase.outliers);
+    if (error_count > 0U)
+    {
+        printf("pitch error        %.3f deg rms, %.3f deg max over %llu batches\n", sqrt(error_sum2 / (double)error_count), error_max, (unsigned long long)error_count);
+        for (uint8_t k = 0U; k < ESTIMATOR_COUNT; k++)
+        {
+            printf("  %-16s %.3f deg rms, %.3f deg max, %.0f host ns per update\n", estimator_name((EstimatorKind)k), sqrt(bench_sum2[k] / (double)error_count),
+                   bench_max[k], (double)bench_ns[k] / (double)samples);
+        }
+        /* the pitch axis is the sensor x axis, the calibrated bias is already taken out before the estimator */
+        printf("kalman gyro bias   %.3f dps (true residual %.3f dps)\n", bench[ESTIMATOR_KALMAN].state.kalman.x[1],
+               config.gyro_bias[0] + config.gyro_bias_drift * (float)(simulated / 3600.0) - imu.gxbias);
+    }
+
+    bool failed = false;
+#if CONTROL_FIXED_POINT
+    double fixed_rms = sqrt(fixed_sum2 / (double)batches);
+    failed = fixed_rms > FIXED_PITCH_RMS || fixed_max > FIXED_PITCH_MAX || quaternion_max > FIXED_QUATERNION_MAX;
+    printf("fixed vs float     pitch %.4f deg rms, %.4f deg max, quaternion %.2e max, %s (bounds %.3f, %.3f, %.0e)\n", fixed_rms, fixed_max,
+           quaternion_max, failed ? "FAILED" : "ok", FIXED_PITCH_RMS, FIXED_PITCH_MAX, FIXED_QUATERNION_MAX);
+#endif
+    char stats[512];
+    stats_string(stats, sizeof(stats));
+    printf("stats (host ns)    %s\n", stats);
+
+    free(motion.t);
+    free(motion.row);
+    return failed ? 2 : 0;
+}
\ No newline at end of file
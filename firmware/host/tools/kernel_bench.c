@@ -0,0 +1,753 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * kernel_bench.c - microbenchmarks of the estimator, attitude and controller kernels and the telemetry push on fixed, seeded input corpora.
+ * every kernel gets timed over its whole corpus (best of --repeat runs, ns per call, and cycles per call where there
+ * is a cycle counter to read: a RISC-V build, e.g. under qemu) and, where there is one, compared step by step
+ * against a double precision reference of the same equations. prints json for diffing runs before and after a change
+ *  
+ * usage: kernel_bench [--samples n] [--repeat n] [--seed n] [--filter text] [--output file]
+ * add a kernel by adding a row to the kernels table, estimators come in through estimator.h on their own
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _DEFAULT_SOURCE /* M_PI, clock_gettime */
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "control.h" /* every kernel's header and the build configuration */
+#include "telemetry.h"
+
+#define PI                    (3.14159265358979F)
+#define GYRO_MEASURE_ERROR    (PI * (40.0F / 180.0F)) /* same filter tuning as main.c */
+#define BETA(x)               (sqrtf(3.0F / 4.0F) * (x))
+#define DEG                   (M_PI / 180.0)
+#define DEFAULT_SAMPLES       10000U  /* 10 s at 1 kHz, and as many controller steps */
+#define DEFAULT_REPEAT        20U
+#define DEFAULT_SEED          0x1234U
+#define SAMPLE_US             1000U
+#define STEP_US               5000U   /* one controller step per 5 samples, like the firmware */
+#define JITTER_US             20U
+#define GYRO_RESOLUTION       (500.0F / 32768.0F) /* dps per count, GFS_500DPS */
+#define ACCEL_RESOLUTION      (2.0F / 32768.0F)   /* g per count, AFS_2G */
+#define GYRO_NOISE            (0.3)   /* dps */
+#define ACCEL_NOISE           (0.005) /* g */
+#define SETPOINT              (-60.0F) /* control.h's, the corpus pitch swings around it */
+#define KP                    (100.0F) /* gains that hold in balance_sim */
+#define KD                    (10.0F)
+#define KI                    (20.0F)
+#define OUT_LIMIT             (200.0F)
+
+typedef enum {
+    GROUP_ESTIMATOR = 0,
+    GROUP_ATTITUDE,
+    GROUP_CONTROLLER,
+    GROUP_TELEMETRY,
+} Group;
+
+typedef struct {
+    const char *name;
+    Group group;
+    const char *reference;      /* what the error is against, NULL for timing only */
+    const char *unit;
+    int variant;                /* estimator kind for the estimator rows */
+    void (*reset)(int variant);
+    void (*run)(int variant, uint32_t begin, uint32_t end);
+    double (*error)(int variant, uint32_t i); /* after run(i, i + 1) */
+} Kernel;
+
+typedef struct {
+    int16_t gyro[3];            /* counts */
+    int16_t accel[3];
+    uint32_t deltat_us;
+} Sample;
+
+/* corpora, built once from the seed */
+static uint32_t samples = DEFAULT_SAMPLES;
+static Sample *imu;
+static float (*gyro)[3];        /* rad/s, what madgwick_update gets */
+static float (*accel)[3];       /* g */
+static float *deltat;           /* s */
+static double (*q_ref)[4];      /* madgwick_update's equations in double on the same counts */
+static double *pitch_true;      /* degrees, of the motion the samples came from */
+static float (*q_corpus)[4];    /* q_ref rounded to float, the input of the attitude kernels */
+static float *error_in;         /* controller corpus: pitch error in degrees, pitch rate in dps */
+static float *rate_in;
+static uint32_t *step_us;
+static double *pid_ref;
+static double *pid2_ref;
+static double *lqr_ref;
+static double *mpc_ref;
+
+/* kernel state, global so nothing gets optimized away */
+static Madgwick madgwick;
+static MadgwickFx madgwick_fx;
+static Estimator estimator;
+static EstimatorConfig estimator_config;
+static float attitude_out[3];
+static PID pid;
+static PidFx pid_fx;
+static PID2 pid2;
+static LQR lqr;
+static MPC mpc;
+static float controller_out;
+static uint32_t rng;
+
+static double uniform(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return ((double)rng + 0.5) / 4294967296.0;
+}
+
+static double gaussian(void)
+{
+    return sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform());
+}
+
+static int16_t counts(double value, double resolution)
+{
+    double scaled = round(value / resolution);
+    if (scaled > 32767.0) { return 32767; }
+    if (scaled < -32768.0) { return -32768; }
+    return (int16_t)scaled;
+}
+
+/* zyx euler angles to the quaternion madgwick.c reads them back from */
+static void euler_quaternion(double roll, double pitch, double yaw, double q[4])
+{
+    double cr = cos(roll / 2.0), sr = sin(roll / 2.0);
+    double cp = cos(pitch / 2.0), sp = sin(pitch / 2.0);
+    double cy = cos(yaw / 2.0), sy = sin(yaw / 2.0);
+    q[0] = cr * cp * cy + sr * sp * sy;
+    q[1] = sr * cp * cy - cr * sp * sy;
+    q[2] = cr * sp * cy + sr * cp * sy;
+    q[3] = cr * cp * sy - sr * sp * cy;
+}
+
+static void motion(double t, double q[4])
+{
+    double pitch = SETPOINT * DEG + 15.0 * DEG * sin(2.0 * M_PI * 0.5 * t) + 3.0 * DEG * sin(2.0 * M_PI * 3.1 * t);
+    double roll = 4.0 * DEG * sin(2.0 * M_PI * 0.7 * t);
+    double yaw = 0.3 * t;
+    euler_quaternion(roll, pitch, yaw, q);
+}
+
+/* madgwick_update's equations, step for step, in double */
+static void madgwick_reference(double q[4], double beta, double gx, double gy, double gz, double ax, double ay, double az, double dt)
+{
+    double norm = sqrt(ax * ax + ay * ay + az * az);
+    ax /= norm; ay /= norm; az /= norm;
+    double f1 = 2.0 * q[1] * q[3] - 2.0 * q[0] * q[2] - ax;
+    double f2 = 2.0 * q[0] * q[1] + 2.0 * q[2] * q[3] - ay;
+    double f3 = 1.0 - 2.0 * q[1] * q[1] - 2.0 * q[2] * q[2] - az;
+    double j11 = 2.0 * q[2], j12 = 2.0 * q[3], j13 = 2.0 * q[0], j14 = 2.0 * q[1];
+    double j32 = 2.0 * j14, j33 = 2.0 * j11;
+    double s[4] = { j14 * f2 - j11 * f1, j12 * f1 + j13 * f2 - j32 * f3, j12 * f2 - j33 * f3 - j13 * f1, j14 * f1 + j11 * f2 };
+    norm = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3]);
+    double w[4] = { -q[1] * gx - q[2] * gy - q[3] * gz, q[0] * gx + q[2] * gz - q[3] * gy,
+                    q[0] * gy - q[1] * gz + q[3] * gx, q[0] * gz + q[1] * gy - q[2] * gx };
+    for (int k = 0; k < 4; k++) { q[k] += (0.5 * w[k] - beta * s[k] / norm) * dt; }
+    norm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    for (int k = 0; k < 4; k++) { q[k] /= norm; }
+}
+
+static double pitch_of(const double q[4])
+{
+    return -asin(2.0 * (q[1] * q[3] - q[0] * q[2])) / DEG;
+}
+
+static void build_corpora(uint32_t seed)
+{
+    imu = calloc(samples, sizeof(*imu));
+    gyro = calloc(samples, sizeof(*gyro));
+    accel = calloc(samples, sizeof(*accel));
+    deltat = calloc(samples, sizeof(*deltat));
+    q_ref = calloc(samples, sizeof(*q_ref));
+    pitch_true = calloc(samples, sizeof(*pitch_true));
+    q_corpus = calloc(samples, sizeof(*q_corpus));
+    error_in = calloc(samples, sizeof(*error_in));
+    rate_in = calloc(samples, sizeof(*rate_in));
+    step_us = calloc(samples, sizeof(*step_us));
+    pid_ref = calloc(samples, sizeof(*pid_ref));
+    pid2_ref = calloc(samples, sizeof(*pid2_ref));
+    lqr_ref = calloc(samples, sizeof(*lqr_ref));
+    mpc_ref = calloc(samples, sizeof(*mpc_ref));
+    if (step_us == NULL || mpc_ref == NULL) { fprintf(stderr, "out of memory\n"); exit(1); }
+
+    /* imu: body rates from the derivative of the motion (q' = q w / 2), gravity seen from the body, noise, counts */
+    rng = seed ? seed : 1U;
+    double t = 0.0;
+    double q[4] = { 1.0, 0.0, 0.0, 0.0 };
+    double beta = (double)BETA(GYRO_MEASURE_ERROR);
+    for (uint32_t i = 0U; i < samples; i++)
+    {
+        uint32_t us = SAMPLE_US + (uint32_t)(uniform() * 2.0 * JITTER_US) - JITTER_US;
+        t += (double)us * 1e-6;
+        double a[4], b[4], m[4], h = 1e-5;
+        motion(t - h, a);
+        motion(t + h, b);
+        motion(t, m);
+        double dq[4] = { (b[0] - a[0]) / (2.0 * h), (b[1] - a[1]) / (2.0 * h), (b[2] - a[2]) / (2.0 * h), (b[3] - a[3]) / (2.0 * h) };
+        /* w = 2 conj(q) dq, vector part */
+        double w[3] = { 2.0 * (m[0] * dq[1] - m[1] * dq[0] - m[2] * dq[3] + m[3] * dq[2]),
+                        2.0 * (m[0] * dq[2] + m[1] * dq[3] - m[2] * dq[0] - m[3] * dq[1]),
+                        2.0 * (m[0] * dq[3] - m[1] * dq[2] + m[2] * dq[1] - m[3] * dq[0]) };
+        double g[3] = { 2.0 * (m[1] * m[3] - m[0] * m[2]), 2.0 * (m[0] * m[1] + m[2] * m[3]), m[0] * m[0] - m[1] * m[1] - m[2] * m[2] + m[3] * m[3] };
+        Sample *sample = &imu[i];
+        for (int k = 0; k < 3; k++)
+        {
+            sample->gyro[k] = counts(w[k] / DEG + GYRO_NOISE * gaussian(), GYRO_RESOLUTION);
+            sample->accel[k] = counts(g[k] + ACCEL_NOISE * gaussian(), ACCEL_RESOLUTION);
+            gyro[i][k] = (float)sample->gyro[k] * GYRO_RESOLUTION * PI / 180.0F;
+            accel[i][k] = (float)sample->accel[k] * ACCEL_RESOLUTION;
+        }
+        sample->deltat_us = us;
+        deltat[i] = (float)us * 1e-6F;
+        pitch_true[i] = pitch_of(m);
+
+        madgwick_reference(q, beta, sample->gyro[0] * (double)GYRO_RESOLUTION * DEG, sample->gyro[1] * (double)GYRO_RESOLUTION * DEG,
+                           sample->gyro[2] * (double)GYRO_RESOLUTION * DEG, sample->accel[0], sample->accel[1], sample->accel[2], us * 1e-6);
+        for (int k = 0; k < 4; k++) { q_ref[i][k] = q[k]; q_corpus[i][k] = (float)q[k]; }
+    }
+
+    /* controller: a wobble around the set point with gyro-like noise on the rate and jitter on the step */
+    t = 0.0;
+    for (uint32_t i = 0U; i < samples; i++)
+    {
+        uint32_t us = STEP_US + (uint32_t)(uniform() * 2.0 * JITTER_US) - JITTER_US;
+        t += (double)us * 1e-6;
+        double error = 2.0 * sin(2.0 * M_PI * 0.7 * t) + 0.5 * sin(2.0 * M_PI * 5.0 * t);
+        double rate = -(2.0 * 2.0 * M_PI * 0.7 * cos(2.0 * M_PI * 0.7 * t) + 0.5 * 2.0 * M_PI * 5.0 * cos(2.0 * M_PI * 5.0 * t));
+        error_in[i] = (float)(error + 0.02 * gaussian());
+        rate_in[i] = (float)(rate + GYRO_NOISE * gaussian());
+        step_us[i] = us;
+    }
+
+    /* pid_compute's equations in double */
+    double integral = 0.0, previous = 0.0;
+    for (uint32_t i = 0U; i < samples; i++)
+    {
+        double error = error_in[i], dt = (double)((float)step_us[i] * 1e-6F);
+        integral += error * dt;
+        pid_ref[i] = (double)KP * error + (double)KI * integral + (double)KD * (error - previous) / dt;
+        previous = error;
+    }
+
+    /* pid2_step's, back calculation, no derivative filter */
+    double period = (double)((float)STEP_US * 1e-6F), ci = 0.0, ct = 0.0, rate = 0.0;
+    integral = 0.0;
+    for (uint32_t i = 0U; i < samples; i++)
+    {
+        double dt = (double)((float)step_us[i] * 1e-6F);
+        if (i == 0U || fabs(dt - period) > (double)PID2_PERIOD_TOLERANCE * period) { period = dt; }
+        ci = (double)KI * period;
+        double tracking = sqrt((double)KD / (double)KI);
+        ct = (tracking > period) ? period / tracking : 1.0;
+        rate = rate_in[i];
+        double unclamped = (double)KP * error_in[i] + integral - (double)KD * rate;
+        double output = fmin(fmax(unclamped, -OUT_LIMIT), OUT_LIMIT);
+        integral += ci * error_in[i] + ct * (output - unclamped);
+        integral = fmin(fmax(integral, -OUT_LIMIT), OUT_LIMIT);
+        pid2_ref[i] = output;
+    }
+
+    /* lqr_step's, the wheel prediction and conditional integration included */
+    static const float lqr_k[LQR_STATES] = LQR_GAINS;
+    static const float lqr_a[LQR_STATES] = LQR_WHEEL_A;
+    double wheel = 0.0;
+    integral = 0.0;
+    for (uint32_t i = 0U; i < samples; i++)
+    {
+        double error = error_in[i], dt = (double)((float)step_us[i] * 1e-6F);
+        double x[LQR_STATES] = { -error, rate_in[i], wheel, integral };
+        double unclamped = 0.0;
+        for (int k = 0; k < LQR_STATES; k++) { unclamped -= (double)lqr_k[k] * x[k]; }
+        double output = fmin(fmax(unclamped, -OUT_LIMIT), OUT_LIMIT);
+        double predicted = (double)LQR_WHEEL_B * output;
+        for (int k = 0; k < LQR_STATES; k++) { predicted += (double)lqr_a[k] * x[k]; }
+        wheel += (predicted - wheel) * (dt / (double)LQR_PERIOD);
+        if (output == unclamped || (unclamped > output) != (error > 0.0)) { integral = integral * (double)LQR_INTEGRAL_DECAY - error * dt; }
+        lqr_ref[i] = output;
+    }
+
+    /* mpc_step's, the same lattice of the same laws */
+    static const MpcLaw mpc_law[MPC_LAW_COUNT] = MPC_LAWS;
+    static const uint32_t mpc_term[MPC_TERM_COUNT] = MPC_TERMS;
+    static const float mpc_a[MPC_STATES] = MPC_WHEEL_A;
+    wheel = 0.0;
+    integral = 0.0;
+    for (uint32_t i = 0U; i < samples; i++)
+    {
+        double error = error_in[i], dt = (double)((float)step_us[i] * 1e-6F);
+        double x[MPC_STATES] = { -error, rate_in[i], wheel, integral };
+        double law[MPC_LAW_COUNT], unclamped = -(double)MPC_MAX_DUTY;
+        for (int l = 0; l < MPC_LAW_COUNT; l++)
+        {
+            law[l] = mpc_law[l].offset;
+            for (int k = 0; k < MPC_STATES; k++) { law[l] += (double)mpc_law[l].k[k] * x[k]; }
+        }
+        for (int t = 0; t < MPC_TERM_COUNT; t++)
+        {
+            double lowest = MPC_MAX_DUTY;
+            for (int l = 0; l < MPC_LAW_COUNT; l++)
+            {
+                if (mpc_term[t] & (1U << l)) { lowest = fmin(lowest, law[l]); }
+            }
+            unclamped = fmax(unclamped, lowest);
+        }
+        double output = fmin(fmax(unclamped, -OUT_LIMIT), OUT_LIMIT);
+        double predicted = (double)MPC_WHEEL_B * output;
+        for (int k = 0; k < MPC_STATES; k++) { predicted += (double)mpc_a[k] * x[k]; }
+        wheel += (predicted - wheel) * (dt / (double)MPC_PERIOD);
+        if (output > -OUT_LIMIT && output < OUT_LIMIT) { integral = integral * (double)MPC_INTEGRAL_DECAY - error * dt; }
+        mpc_ref[i] = output;
+    }
+}
+
+/* estimators */
+static void estimator_reset(int variant)
+{
+    estimator_default_config(&estimator_config, BETA(GYRO_MEASURE_ERROR), (float)SAMPLE_US * 1e-6F);
+    estimator_init(&estimator, (EstimatorKind)variant, &estimator_config);
+
+    /* start every backend from the first accel sample instead of level, the complementary and kalman filters already do */
+    double norm = sqrt((double)accel[0][0] * accel[0][0] + (double)accel[0][1] * accel[0][1] + (double)accel[0][2] * accel[0][2]);
+    double q[4];
+    euler_quaternion(atan2((double)accel[0][1], (double)accel[0][2]), -asin((double)accel[0][0] / norm), 0.0, q);
+    if (variant == ESTIMATOR_MADGWICK)
+    {
+        float qf[4] = { (float)q[0], (float)q[1], (float)q[2], (float)q[3] };
+        madgwick_set_quaternion(&estimator.state.madgwick, qf);
+    }
+    else if (variant == ESTIMATOR_MAHONY)
+    {
+        estimator.state.mahony.q1 = (float)q[0];
+        estimator.state.mahony.q2 = (float)q[1];
+        estimator.state.mahony.q3 = (float)q[2];
+        estimator.state.mahony.q4 = (float)q[3];
+    }
+}
+
+static void estimator_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        estimator_update(&estimator, gyro[i][0], gyro[i][1], gyro[i][2], accel[i][0], accel[i][1], accel[i][2], deltat[i]);
+    }
+}
+
+static double estimator_error(int variant, uint32_t i)
+{
+    return fabs((double)estimator_get_pitch(&estimator) - pitch_true[i]);
+}
+
+static void madgwick_reset(int variant)
+{
+    madgwick_init(&madgwick, BETA(GYRO_MEASURE_ERROR));
+}
+
+static void madgwick_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        madgwick_update(&madgwick, gyro[i][0], gyro[i][1], gyro[i][2], accel[i][0], accel[i][1], accel[i][2], deltat[i]);
+    }
+}
+
+static double quaternion_error(const float q[4], uint32_t i)
+{
+    double worst = 0.0;
+    for (int k = 0; k < 4; k++) { worst = fmax(worst, fabs((double)q[k] - q_ref[i][k])); }
+    return worst;
+}
+
+static double madgwick_error(int variant, uint32_t i)
+{
+    float q[4] = { madgwick.q1, madgwick.q2, madgwick.q3, madgwick.q4 };
+    return quaternion_error(q, i);
+}
+
+static void madgwick_fx_reset(int variant)
+{
+    madgwick_fx_init(&madgwick_fx, BETA(GYRO_MEASURE_ERROR), GYRO_RESOLUTION);
+}
+
+static void madgwick_fx_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const Sample *sample = &imu[i];
+        madgwick_fx_update(&madgwick_fx, sample->gyro[0], sample->gyro[1], sample->gyro[2], sample->accel[0], sample->accel[1], sample->accel[2], sample->deltat_us);
+    }
+}
+
+static double madgwick_fx_error(int variant, uint32_t i)
+{
+    float q[4];
+    for (int k = 0; k < 4; k++) { q[k] = (float)madgwick_fx.q[k] / (float)(1L << MADGWICK_FX_Q); }
+    return quaternion_error(q, i);
+}
+
+/* attitude, on the reference quaternions */
+static void attitude_reset(int variant)
+{
+    madgwick_init(&madgwick, 0.0F);
+}
+
+static void rpy_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        madgwick_set_quaternion(&madgwick, q_corpus[i]);
+        madgwick_get_rpy(&madgwick);
+        attitude_out[0] = madgwick.roll;
+        attitude_out[1] = madgwick.pitch;
+        attitude_out[2] = madgwick.yaw;
+    }
+}
+
+static double rpy_error(int variant, uint32_t i)
+{
+    const float *q = q_corpus[i];
+    double q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+    double roll = atan2(2.0 * (q1 * q2 + q3 * q4), q1 * q1 - q2 * q2 - q3 * q3 + q4 * q4) / DEG;
+    double pitch = -asin(2.0 * (q2 * q4 - q1 * q3)) / DEG;
+    double yaw = atan2(2.0 * (q2 * q3 + q1 * q4), q1 * q1 + q2 * q2 - q3 * q3 - q4 * q4) / DEG + 13.8;
+    if (yaw < 0.0) { yaw += 360.0; }
+    double yaw_error = fabs((double)attitude_out[2] - yaw);
+    yaw_error = fmin(yaw_error, 360.0 - yaw_error);
+    return fmax(fmax(fabs((double)attitude_out[0] - roll), fabs((double)attitude_out[1] - pitch)), yaw_error);
+}
+
+static void pitch_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        madgwick_set_quaternion(&madgwick, q_corpus[i]);
+        attitude_out[1] = madgwick_pitch(&madgwick);
+    }
+}
+
+static void pitch_fast_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        madgwick_set_quaternion(&madgwick, q_corpus[i]);
+        attitude_out[1] = madgwick_pitch_fast(&madgwick);
+    }
+}
+
+static double pitch_error(int variant, uint32_t i)
+{
+    const float *q = q_corpus[i];
+    return fabs((double)attitude_out[1] + asin(2.0 * ((double)q[1] * q[3] - (double)q[0] * q[2])) / DEG);
+}
+
+static void pitch_error_run(int variant, uint32_t begin, uint32_t end)
+{
+    float setpoint_sin = sinf(SETPOINT * PI / 180.0F), setpoint_cos = cosf(SETPOINT * PI / 180.0F);
+    for (uint32_t i = begin; i < end; i++)
+    {
+        madgwick_set_quaternion(&madgwick, q_corpus[i]);
+        attitude_out[1] = madgwick_pitch_error(&madgwick, setpoint_sin, setpoint_cos);
+    }
+}
+
+static double pitch_error_error(int variant, uint32_t i)
+{
+    /* same small angle equation in double, see madgwick.h for how far that is from the real difference */
+    const float *q = q_corpus[i];
+    double sin_pitch = -2.0 * ((double)q[1] * q[3] - (double)q[0] * q[2]);
+    double cos_pitch = sqrt(fmax(1.0 - sin_pitch * sin_pitch, 0.0));
+    return fabs((double)attitude_out[1] - (sin(SETPOINT * DEG) * cos_pitch - cos(SETPOINT * DEG) * sin_pitch) / DEG);
+}
+
+/* controllers */
+static void pid_reset(int variant)
+{
+    pid_init(&pid, KP, KD, KI);
+}
+
+static void pid_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        controller_out = pid_compute(&pid, error_in[i], 0.0F, (float)step_us[i] * 1e-6F);
+    }
+}
+
+static double pid_error(int variant, uint32_t i)
+{
+    return fabs((double)controller_out - pid_ref[i]);
+}
+
+static void pid_fx_reset(int variant)
+{
+    pid_fx_init(&pid_fx, KP, KD, KI);
+}
+
+static void pid_fx_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        controller_out = pid_fx_to_float(pid_fx_compute(&pid_fx, pid_fx_from_float(error_in[i]), 0, step_us[i]));
+    }
+}
+
+static void pid2_reset_kernel(int variant)
+{
+    pid2_init(&pid2, -OUT_LIMIT, OUT_LIMIT, (float)STEP_US * 1e-6F, PID2_WINDUP_BACK_CALCULATION);
+    pid2_set_gains(&pid2, KP, KD, KI);
+}
+
+static void pid2_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        controller_out = pid2_step(&pid2, error_in[i], rate_in[i], (float)step_us[i] * 1e-6F);
+    }
+}
+
+static double pid2_error(int variant, uint32_t i)
+{
+    return fabs((double)controller_out - pid2_ref[i]);
+}
+
+static void lqr_reset_kernel(int variant)
+{
+    lqr_init(&lqr, -OUT_LIMIT, OUT_LIMIT);
+}
+
+static void lqr_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        controller_out = lqr_step(&lqr, error_in[i], rate_in[i], (float)step_us[i] * 1e-6F);
+    }
+}
+
+static double lqr_error(int variant, uint32_t i)
+{
+    return fabs((double)controller_out - lqr_ref[i]);
+}
+
+static void mpc_reset_kernel(int variant)
+{
+    mpc_init(&mpc, -OUT_LIMIT, OUT_LIMIT);
+}
+
+static void mpc_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        controller_out = mpc_step(&mpc, error_in[i], rate_in[i], (float)step_us[i] * 1e-6F);
+    }
+}
+
+static double mpc_error(int variant, uint32_t i)
+{
+    return fabs((double)controller_out - mpc_ref[i]);
+}
+
+/* variant is the decimation. nothing drains the ring, the producer laps it like it would with nobody reading */
+static void telemetry_reset(int variant)
+{
+    telemetry_set_decimation((uint32_t)variant);
+    telemetry_enable(true);
+}
+
+static void telemetry_run(int variant, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        telemetry_push(i * STEP_US, SETPOINT - error_in[i], rate_in[i], controller_out, controller_out, (uint8_t)i);
+    }
+}
+
+static const Kernel kernels[] = {
+    { "madgwick_update", GROUP_ESTIMATOR, "madgwick_update in double", "quaternion", 0, madgwick_reset, madgwick_run, madgwick_error },
+    { "madgwick_fx_update", GROUP_ESTIMATOR, "madgwick_update in double", "quaternion", 0, madgwick_fx_reset, madgwick_fx_run, madgwick_fx_error },
+    { "madgwick_get_rpy", GROUP_ATTITUDE, "atan2, asin in double", "deg", 0, attitude_reset, rpy_run, rpy_error },
+    { "madgwick_pitch", GROUP_ATTITUDE, "asin in double", "deg", 0, attitude_reset, pitch_run, pitch_error },
+    { "madgwick_pitch_fast", GROUP_ATTITUDE, "asin in double", "deg", 0, attitude_reset, pitch_fast_run, pitch_error },
+    { "madgwick_pitch_error", GROUP_ATTITUDE, "sin of the error in double", "deg", 0, attitude_reset, pitch_error_run, pitch_error_error },
+    { "pid_compute", GROUP_CONTROLLER, "pid_compute in double", "counts", 0, pid_reset, pid_run, pid_error },
+    { "pid_fx_compute", GROUP_CONTROLLER, "pid_compute in double", "counts", 0, pid_fx_reset, pid_fx_run, pid_error },
+    { "pid2_step", GROUP_CONTROLLER, "pid2_step in double", "counts", 0, pid2_reset_kernel, pid2_run, pid2_error },
+    { "lqr_step", GROUP_CONTROLLER, "lqr_step in double", "counts", 0, lqr_reset_kernel, lqr_run, lqr_error },
+    { "mpc_step", GROUP_CONTROLLER, "mpc_step in double", "counts", 0, mpc_reset_kernel, mpc_run, mpc_error },
+    { "telemetry_push", GROUP_TELEMETRY, NULL, NULL, 1, telemetry_reset, telemetry_run, NULL },
+    { "telemetry_push_decimated", GROUP_TELEMETRY, NULL, NULL, (int)TELEMETRY_DEFAULT_DECIMATION, telemetry_reset, telemetry_run, NULL },
+};
+#define KERNEL_COUNT    (sizeof(kernels) / sizeof(kernels[0]))
+
+static const char *group_names[] = { "estimator", "attitude", "controller", "telemetry" };
+
+static double now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/* cycles where the isa has a counter user code can read, the c3's own core is risc-v */
+static bool cycles_available(void)
+{
+#if defined(__riscv)
+    return true;
+#else
+    return false;
+#endif
+}
+
+static uint64_t cycles_now(void)
+{
+#if defined(__riscv) && __riscv_xlen == 32
+    uint32_t high, low, check;
+    do
+    {
+        __asm__ volatile ("rdcycleh %0" : "=r"(high));
+        __asm__ volatile ("rdcycle %0" : "=r"(low));
+        __asm__ volatile ("rdcycleh %0" : "=r"(check));
+    } while (high != check);
+    return ((uint64_t)high << 32) | low;
+#elif defined(__riscv)
+    uint64_t value;
+    __asm__ volatile ("rdcycle %0" : "=r"(value));
+    return value;
+#else
+    return 0U;
+#endif
+}
+
+static void json_number(FILE *out, const char *key, double value, bool last)
+{
+    if (isfinite(value)) { fprintf(out, "\"%s\": %.6g%s", key, value, last ? "" : ", "); }
+    else                 { fprintf(out, "\"%s\": null%s", key, last ? "" : ", "); }
+}
+
+static void bench(FILE *out, const Kernel *kernel, uint32_t repeat, bool last)
+{
+    double best_ns = INFINITY, best_cycles = INFINITY;
+
+    for (uint32_t r = 0U; r < repeat; r++)
+    {
+        kernel->reset(kernel->variant);
+        uint64_t cycles = cycles_now();
+        double start = now_ns();
+        kernel->run(kernel->variant, 0U, samples);
+        double elapsed = now_ns() - start;
+        cycles = cycles_now() - cycles;
+        best_ns = fmin(best_ns, elapsed);
+        best_cycles = fmin(best_cycles, (double)cycles);
+    }
+
+    double max = NAN, rms = NAN;
+    if (kernel->error != NULL)
+    {
+        double sum2 = 0.0;
+        uint32_t count = 0U;
+        max = 0.0;
+        kernel->reset(kernel->variant);
+        for (uint32_t i = 0U; i < samples; i++)
+        {
+            kernel->run(kernel->variant, i, i + 1U);
+            double error = kernel->error(kernel->variant, i);
+            max = fmax(max, error);
+            sum2 += error * error;
+            count++;
+        }
+        rms = (count > 0U) ? sqrt(sum2 / (double)count) : NAN;
+    }
+
+    fprintf(out, "    { \"name\": \"%s\", \"group\": \"%s\", \"calls\": %u, ", kernel->name, group_names[kernel->group], samples);
+    json_number(out, "ns_per_call", best_ns / (double)samples, false);
+    json_number(out, "cycles_per_call", cycles_available() ? best_cycles / (double)samples : NAN, false);
+    if (kernel->reference != NULL) { fprintf(out, "\"reference\": \"%s\", \"error_unit\": \"%s\", ", kernel->reference, kernel->unit); }
+    else                           { fprintf(out, "\"reference\": null, \"error_unit\": null, "); }
+    json_number(out, "max_error", max, false);
+    json_number(out, "rms_error", rms, true);
+    fprintf(out, " }%s\n", last ? "" : ",");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t repeat = DEFAULT_REPEAT;
+    uint32_t seed = DEFAULT_SEED;
+    const char *filter = NULL;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--samples") == 0 && has_value)     { samples = (uint32_t)strtoul(argv[++i], NULL, 10); }
+        else if (strcmp(argv[i], "--repeat") == 0 && has_value) { repeat = (uint32_t)strtoul(argv[++i], NULL, 10); }
+        else if (strcmp(argv[i], "--seed") == 0 && has_value)   { seed = (uint32_t)strtoul(argv[++i], NULL, 0); }
+        else if (strcmp(argv[i], "--filter") == 0 && has_value) { filter = argv[++i]; }
+        else if (strcmp(argv[i], "--output") == 0 && has_value) { path = argv[++i]; }
+        else { fprintf(stderr, "unknown argument %s, see the header of kernel_bench.c\n", argv[i]); return 1; }
+    }
+    if (samples == 0U || repeat == 0U) { fprintf(stderr, "--samples and --repeat take at least 1\n"); return 1; }
+    FILE *out = (path != NULL) ? fopen(path, "w") : stdout;
+    if (out == NULL) { fprintf(stderr, "can't write %s\n", path); return 1; }
+
+    build_corpora(seed);
+
+    /* every estimator backend as well, against the motion itself since they don't share equations */
+    Kernel rows[KERNEL_COUNT + ESTIMATOR_COUNT];
+    char names[ESTIMATOR_COUNT][48];
+    uint32_t count = 0U;
+    for (uint32_t k = 0U; k < KERNEL_COUNT; k++) { rows[count++] = kernels[k]; }
+    for (int k = 0; k < ESTIMATOR_COUNT; k++)
+    {
+        snprintf(names[k], sizeof(names[k]), "estimator_%s", estimator_name((EstimatorKind)k));
+        Kernel row = { names[k], GROUP_ESTIMATOR, "pitch of the motion", "deg", k, estimator_reset, estimator_run, estimator_error };
+        rows[count++] = row;
+    }
+    uint32_t selected = 0U;
+    for (uint32_t k = 0U; k < count; k++)
+    {
+        if (filter == NULL || strstr(rows[k].name, filter) != NULL) { rows[selected++] = rows[k]; }
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"tool\": \"kernel_bench\",\n");
+    fprintf(out, "  \"compiler\": \"%s\",\n", __VERSION__);
+#ifdef BENCH_BUILD_TYPE
+    fprintf(out, "  \"build_type\": \"%s\",\n", BENCH_BUILD_TYPE);
+#endif
+    fprintf(out, "  \"config\": { \"control_law\": %d, \"estimator\": %d, \"fixed_point\": %d, \"pitch_mode\": %d },\n",
+            CONTROL_LAW, CONTROL_ESTIMATOR, CONTROL_FIXED_POINT, CONTROL_PITCH_MODE);
+    fprintf(out, "  \"corpus\": { \"calls\": %u, \"seed\": %u, \"sample_us\": %u, \"step_us\": %u },\n", samples, seed, SAMPLE_US, STEP_US);
+    fprintf(out, "  \"repeat\": %u,\n", repeat);
+    fprintf(out, "  \"kernels\": [\n");
+    for (uint32_t k = 0U; k < selected; k++) { bench(out, &rows[k], repeat, k + 1U == selected); }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) { fclose(out); }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * lqr_synth.c - lqr gains for the balance controller. discretizes the reaction wheel pendulum of
+ * wheel_model.c at the control period, solves the discrete riccati equation and prints main/lqr_gains.h
+ *  
+ * usage: lqr_synth [--mass kg] [--com m] [--inertia kgm2] [--wheel-inertia kgm2] [--kt Nm/A] [--ke Vs/rad]
+ *                  [--resistance ohm] [--vbat V] [--period s] [--leak s] [--q a,b,c,d] [--r x] > main/lqr_gains.h
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _DEFAULT_SOURCE /* M_PI */
+#include <math.h>
+#include <stdio.h>
+#include "wheel_model.h"
+
+#define N                   WHEEL_MODEL_STATES
+
+int main(int argc, char **argv)
+{
+    WheelModel model;
+    double Ad[N][N], Bd[N], K[N], P[N][N];
+
+    wheel_model_defaults(&model);
+    for (int i = 1; i < argc; i++)
+    {
+        int parsed = wheel_model_parse(&model, argc, argv, &i);
+        if (parsed < 0) { return 1; }
+        if (parsed == 0) { fprintf(stderr, "unknown argument %s, see the header of lqr_synth.c\n", argv[i]); return 1; }
+    }
+
+    if (wheel_model_discrete(&model, Ad, Bd) < 0) { return 1; }
+    int iterations = wheel_model_dare(Ad, Bd, model.q, model.r, K, P);
+    if (iterations < 0) { fprintf(stderr, "riccati iteration did not converge, is the plant controllable with these parameters?\n"); return 1; }
+    double radius = wheel_model_spectral_radius(Ad, Bd, K);
+    fprintf(stderr, "riccati converged in %d iterations, closed loop spectral radius %.4f\n", iterations, radius);
+    if (radius >= 1.0) { fprintf(stderr, "closed loop is not stable\n"); return 1; }
+
+    printf("/*\n");
+    printf(" * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi\n");
+    printf(" * lqr_gains.h - generated by host/tools/lqr_synth.c, don't edit, run it again\n");
+    wheel_model_print(&model, stdout);
+    printf(" * closed loop spectral radius %.4f\n", radius);
+    printf(" */\n\n");
+    printf("#ifndef _LQR_GAINS_H\n#define _LQR_GAINS_H\n\n");
+    /* the firmware works in degrees, dps and deg s, the wheel stays in rad/s */
+    double deg = M_PI / 180.0;
+    printf("#define LQR_STATES    %d\n", N);
+    printf("#define LQR_PERIOD    (%#.6gF) /* seconds */\n\n", model.period);
+    printf("/* duty = -K x, x = [pitch - balance (deg), pitch rate (dps), wheel speed (rad/s, positive the way positive duty spins it), */\n");
+    printf("/* integral of pitch - balance (deg s)] */\n");
+    printf("#define LQR_GAINS     { %#.9gF, %#.9gF, %#.9gF, %#.9gF }\n", K[0] * deg, K[1] * deg, K[2], K[3] * deg);
+    printf("/* discrete model row of the wheel speed, the firmware has no encoder and predicts it from the duty it sent */\n");
+    printf("#define LQR_WHEEL_A   { %#.9gF, %#.9gF, %#.9gF, %#.9gF }\n", Ad[2][0] * deg, Ad[2][1] * deg, Ad[2][2], Ad[2][3] * deg);
+    printf("#define LQR_WHEEL_B   (%#.9gF)\n", Bd[2]);
+    printf("/* the pitch integral decays by this much every period */\n");
+    printf("#define LQR_INTEGRAL_DECAY (%#.9gF)\n\n", Ad[3][3]);
+    printf("#endif /* _LQR_GAINS_H */");
+    return 0;
+}
\ No newline at end of file
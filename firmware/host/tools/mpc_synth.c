@@ -0,0 +1,432 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * mpc_synth.c - explicit mpc for the balance controller. solves the input constrained finite horizon problem
+ * of wheel_model.c offline over a grid of states, collects the affine law of the first move in each region
+ * and prints main/mpc_regions.h with them in lattice form, duty = max over terms of min over the laws of the
+ * term. the firmware evaluates that instead of solving a qp every step
+ *  
+ * usage: mpc_synth [model options of lqr_synth] [--horizon steps] [--max-duty counts] [--box deg,dps,rad/s,deg s]
+ *                  [--grid points] > main/mpc_regions.h
+ * the terminal cost is the lqr one, so inside the unsaturated region the law is exactly the lqr gain
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _DEFAULT_SOURCE /* M_PI */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "wheel_model.h"
+
+#define N                   WHEEL_MODEL_STATES
+#define MAX_HORIZON         32
+#define MAX_LAWS            32      /* one bit each in the firmware's term masks */
+#define MAX_REGIONS         4096
+#define LAW_TOLERANCE       1e-6    /* relative, laws closer than this are the same law */
+#define VERIFY_SAMPLES      200000
+
+typedef struct {
+    int horizon;
+    double max_duty;
+    double box[N];          /* half width of the sampled box, model units */
+    int grid;               /* points per side */
+    /* condensed problem: min 1/2 U'HU + (Fx)'U, |U| <= max_duty */
+    double H[MAX_HORIZON][MAX_HORIZON];
+    double F[MAX_HORIZON][N];
+} Problem;
+
+typedef struct {
+    double k[N];
+    double offset;
+} Law;
+
+/* the states that share one active set, a convex polyhedron */
+typedef struct {
+    uint32_t upper;         /* moves held at +max_duty */
+    uint32_t lower;         /* moves held at -max_duty */
+    int law;
+    uint32_t above;         /* laws that were >= this region's law at every sample in it */
+} Region;
+
+static Law laws[MAX_LAWS];
+static int law_count;
+static Region regions[MAX_REGIONS];
+static int region_count;
+static uint32_t terms[MAX_REGIONS];
+static int term_count;
+
+/* x_k = A^k x0 + sum A^(k-1-j) B u_j, cost sum_{k=1}^{n-1} x'Qx + x_n'Px_n + r sum u^2, the x0 term is constant */
+static void condense(Problem *problem, double Ad[N][N], const double Bd[N], const double q[N], double r, double P[N][N])
+{
+    int n = problem->horizon;
+    static double Sx[MAX_HORIZON + 1][N][N];       /* A^k */
+    static double Su[MAX_HORIZON + 1][N][MAX_HORIZON];
+
+    memset(Sx, 0, sizeof(Sx));
+    memset(Su, 0, sizeof(Su));
+    for (int i = 0; i < N; i++) { Sx[0][i][i] = 1.0; }
+    for (int k = 1; k <= n; k++)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++) { for (int m = 0; m < N; m++) { Sx[k][i][j] += Ad[i][m] * Sx[k - 1][m][j]; } }
+            for (int j = 0; j < k - 1; j++) { for (int m = 0; m < N; m++) { Su[k][i][j] += Ad[i][m] * Su[k - 1][m][j]; } }
+            Su[k][i][k - 1] = Bd[i];
+        }
+    }
+
+    memset(problem->H, 0, sizeof(problem->H));
+    memset(problem->F, 0, sizeof(problem->F));
+    for (int k = 1; k <= n; k++)
+    {
+        double W[N][N] = { { 0.0 } };
+        for (int i = 0; i < N; i++) { for (int j = 0; j < N; j++) { W[i][j] = (k == n) ? P[i][j] : ((i == j) ? q[i] : 0.0); } }
+        for (int a = 0; a < n; a++)
+        {
+            double WSu[N] = { 0.0 };
+            for (int i = 0; i < N; i++) { for (int j = 0; j < N; j++) { WSu[i] += W[i][j] * Su[k][j][a]; } }
+            for (int b = 0; b < n; b++) { for (int i = 0; i < N; i++) { problem->H[b][a] += Su[k][i][b] * WSu[i]; } }
+            for (int c = 0; c < N; c++) { for (int i = 0; i < N; i++) { problem->F[a][c] += WSu[i] * Sx[k][i][c]; } }
+        }
+    }
+    for (int a = 0; a < n; a++) { problem->H[a][a] += r; }
+}
+
+/* solves M y = b in place for the m x m symmetric positive definite M, by cholesky */
+static void cholesky_solve(int m, double M[MAX_HORIZON][MAX_HORIZON], double *b)
+{
+    double L[MAX_HORIZON][MAX_HORIZON] = { { 0.0 } };
+
+    for (int i = 0; i < m; i++)
+    {
+        for (int j = 0; j <= i; j++)
+        {
+            double sum = M[i][j];
+            for (int k = 0; k < j; k++) { sum -= L[i][k] * L[j][k]; }
+            L[i][j] = (i == j) ? sqrt(sum) : sum / L[j][j];
+        }
+    }
+    for (int i = 0; i < m; i++)
+    {
+        for (int k = 0; k < i; k++) { b[i] -= L[i][k] * b[k]; }
+        b[i] /= L[i][i];
+    }
+    for (int i = m - 1; i >= 0; i--)
+    {
+        for (int k = i + 1; k < m; k++) { b[i] -= L[k][i] * b[k]; }
+        b[i] /= L[i][i];
+    }
+}
+
+/* minimizer on the free moves with the others held at their bounds */
+static void solve_free(const Problem *problem, const double *f, const int *bound, double *U)
+{
+    int n = problem->horizon;
+    int index[MAX_HORIZON];
+    double M[MAX_HORIZON][MAX_HORIZON];
+    double b[MAX_HORIZON];
+    int m = 0;
+
+    for (int i = 0; i < n; i++) { if (bound[i] == 0) { index[m++] = i; } }
+    for (int a = 0; a < m; a++)
+    {
+        b[a] = -f[index[a]];
+        for (int i = 0; i < n; i++) { if (bound[i] != 0) { b[a] -= problem->H[index[a]][i] * bound[i] * problem->max_duty; } }
+        for (int c = 0; c < m; c++) { M[a][c] = problem->H[index[a]][index[c]]; }
+    }
+    cholesky_solve(m, M, b);
+    for (int i = 0; i < n; i++) { U[i] = (bound[i] == 0) ? 0.0 : bound[i] * problem->max_duty; }
+    for (int a = 0; a < m; a++) { U[index[a]] = b[a]; }
+}
+
+/*
+ * primal active set for the box constrained qp: bound[i] is -1, 0 or +1 for a move held at the lower bound,
+ * free or held at the upper bound. exact and finite, the horizon is short enough not to care about speed
+ */
+static void solve_qp(const Problem *problem, const double *x, int *bound)
+{
+    int n = problem->horizon;
+    double f[MAX_HORIZON];
+    double U[MAX_HORIZON] = { 0.0 };
+    double target[MAX_HORIZON];
+
+    for (int a = 0; a < n; a++)
+    {
+        f[a] = 0.0;
+        for (int c = 0; c < N; c++) { f[a] += problem->F[a][c] * x[c]; }
+        bound[a] = 0;
+    }
+    for (int iteration = 0; iteration < 8 * MAX_HORIZON * MAX_HORIZON; iteration++)
+    {
+        solve_free(problem, f, bound, target);
+
+        /* walk towards the free minimizer until the first bound gets in the way */
+        double step = 1.0;
+        int blocking = -1;
+        for (int i = 0; i < n; i++)
+        {
+            if (bound[i] != 0 || fabs(target[i]) <= problem->max_duty) { continue; }
+            double limit = (target[i] > 0.0) ? problem->max_duty : -problem->max_duty;
+            double reach = (limit - U[i]) / (target[i] - U[i]);
+            if (reach < step) { step = reach; blocking = i; }
+        }
+        for (int i = 0; i < n; i++) { U[i] += step * (target[i] - U[i]); }
+        if (blocking >= 0)
+        {
+            bound[blocking] = (target[blocking] > 0.0) ? 1 : -1;
+            U[blocking] = bound[blocking] * problem->max_duty;
+            continue;
+        }
+
+        /* free minimizer reached, let go of the bound whose multiplier has the wrong sign the most */
+        int release = -1;
+        double worst = 0.0;
+        for (int i = 0; i < n; i++)
+        {
+            if (bound[i] == 0) { continue; }
+            double gradient = f[i];
+            for (int j = 0; j < n; j++) { gradient += problem->H[i][j] * U[j]; }
+            /* held at the upper bound it has to want to go up, gradient < 0, and the other way for the lower one */
+            double wrong = gradient * bound[i];
+            if (wrong > worst) { worst = wrong; release = i; }
+        }
+        if (release < 0) { return; }
+        bound[release] = 0;
+    }
+    fprintf(stderr, "active set did not settle, the result may be off\n");
+}
+
+/* affine law of the first move for the active set in bound, u0 = k x + offset */
+static Law law_of(const Problem *problem, const int *bound)
+{
+    Law law;
+    double f[MAX_HORIZON];
+    double U[MAX_HORIZON];
+
+    if (bound[0] != 0)
+    {
+        memset(law.k, 0, sizeof(law.k));
+        law.offset = bound[0] * problem->max_duty;
+        return law;
+    }
+    /* u0 is linear in f, so push a unit vector of the state through the free solve, held moves go in the offset */
+    memset(f, 0, sizeof(f));
+    solve_free(problem, f, bound, U);
+    law.offset = U[0];
+    for (int c = 0; c < N; c++)
+    {
+        for (int a = 0; a < problem->horizon; a++) { f[a] = problem->F[a][c]; }
+        solve_free(problem, f, bound, U);
+        law.k[c] = U[0] - law.offset;
+    }
+    return law;
+}
+
+static int same_law(const Law *a, const Law *b, const double *box)
+{
+    /* compare what each term contributes over the box, gains of very different units otherwise */
+    double scale = fmax(fabs(a->offset), 1.0);
+    double difference = fabs(a->offset - b->offset);
+    for (int c = 0; c < N; c++)
+    {
+        scale = fmax(scale, fabs(a->k[c]) * box[c]);
+        difference = fmax(difference, fabs(a->k[c] - b->k[c]) * box[c]);
+    }
+    return difference <= LAW_TOLERANCE * scale;
+}
+
+static int find_law(const Law *law, const double *box)
+{
+    for (int i = 0; i < law_count; i++) { if (same_law(&laws[i], law, box)) { return i; } }
+    if (law_count == MAX_LAWS) { fprintf(stderr, "more than %d laws, shrink the box or the horizon\n", MAX_LAWS); exit(1); }
+    laws[law_count] = *law;
+    return law_count++;
+}
+
+static double evaluate(const Law *law, const double *x)
+{
+    double u = law->offset;
+    for (int c = 0; c < N; c++) { u += law->k[c] * x[c]; }
+    return u;
+}
+
+/* solve at x and narrow down which laws stay above the region's own law */
+static void sample(const Problem *problem, const double *x)
+{
+    int bound[MAX_HORIZON];
+    uint32_t upper = 0U, lower = 0U;
+    Region *region = NULL;
+
+    solve_qp(problem, x, bound);
+    for (int i = 0; i < problem->horizon; i++)
+    {
+        if (bound[i] > 0) { upper |= 1U << i; }
+        if (bound[i] < 0) { lower |= 1U << i; }
+    }
+    for (int i = 0; i < region_count && region == NULL; i++) { if (regions[i].upper == upper && regions[i].lower == lower) { region = &regions[i]; } }
+    if (region == NULL)
+    {
+        if (region_count == MAX_REGIONS) { fprintf(stderr, "more than %d regions, shrink the box or the horizon\n", MAX_REGIONS); exit(1); }
+        Law law = law_of(problem, bound);
+        region = &regions[region_count++];
+        *region = (Region){ .upper = upper, .lower = lower, .law = find_law(&law, problem->box), .above = 0xFFFFFFFFU };
+    }
+
+    double own = evaluate(&laws[region->law], x);
+    for (int j = 0; j < law_count; j++)
+    {
+        if (evaluate(&laws[j], x) < own - LAW_TOLERANCE * problem->max_duty) { region->above &= ~(1U << j); }
+    }
+}
+
+/*
+ * lattice form of a continuous piecewise affine function (tarela & martinez): f = max over regions i of the min of
+ * the laws that are >= law i all over region i. terms that contain another term never win the max, drop them
+ */
+static void lattice(void)
+{
+    for (int i = 0; i < region_count; i++)
+    {
+        uint32_t term = regions[i].above & ((law_count < 32) ? ((1U << law_count) - 1U) : 0xFFFFFFFFU);
+        int dominated = 0;
+        for (int t = 0; t < term_count && !dominated; t++) { dominated = ((terms[t] & term) == terms[t]); }
+        if (dominated) { continue; }
+        int kept = 0;
+        for (int t = 0; t < term_count; t++) { if ((terms[t] & term) != term) { terms[kept++] = terms[t]; } }
+        term_count = kept;
+        terms[term_count++] = term;
+    }
+}
+
+static double evaluate_lattice(const double *x)
+{
+    double best = -INFINITY;
+    for (int t = 0; t < term_count; t++)
+    {
+        double lowest = INFINITY;
+        for (int j = 0; j < law_count; j++) { if (terms[t] & (1U << j)) { lowest = fmin(lowest, evaluate(&laws[j], x)); } }
+        best = fmax(best, lowest);
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    WheelModel model;
+    static Problem problem;
+    double Ad[N][N], Bd[N], K[N], P[N][N];
+    double deg = M_PI / 180.0;
+    double unit[N] = { deg, deg, 1.0, deg };   /* firmware units to model units */
+
+    wheel_model_defaults(&model);
+    problem.horizon = 10;
+    problem.max_duty = 200.0;   /* CONTROL_MAX_DUTY_CYCLE */
+    problem.grid = 17;
+    double box[N] = { 3.0, 90.0, 400.0, 2.0 };
+    for (int i = 1; i < argc; i++)
+    {
+        int parsed = wheel_model_parse(&model, argc, argv, &i);
+        if (parsed < 0) { return 1; }
+        if (parsed > 0) { continue; }
+        int has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--horizon") == 0 && has_value)        { problem.horizon = atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--max-duty") == 0 && has_value)  { problem.max_duty = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--grid") == 0 && has_value)      { problem.grid = atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--box") == 0 && has_value)
+        {
+            if (sscanf(argv[++i], "%lf,%lf,%lf,%lf", &box[0], &box[1], &box[2], &box[3]) != 4) { fprintf(stderr, "--box takes four comma separated half widths\n"); return 1; }
+        }
+        else { fprintf(stderr, "unknown argument %s, see the header of mpc_synth.c\n", argv[i]); return 1; }
+    }
+    if (problem.horizon < 1 || problem.horizon > MAX_HORIZON) { fprintf(stderr, "--horizon goes from 1 to %d\n", MAX_HORIZON); return 1; }
+    if (problem.grid < 2) { fprintf(stderr, "--grid needs at least 2 points per side\n"); return 1; }
+    for (int c = 0; c < N; c++) { problem.box[c] = box[c] * unit[c]; }
+
+    if (wheel_model_discrete(&model, Ad, Bd) < 0) { return 1; }
+    if (wheel_model_dare(Ad, Bd, model.q, model.r, K, P) < 0) { fprintf(stderr, "riccati iteration did not converge, is the plant controllable with these parameters?\n"); return 1; }
+    condense(&problem, Ad, Bd, model.q, model.r, P);
+
+    for (int point = 0, points = (int)pow(problem.grid, N); point < points; point++)
+    {
+        double x[N];
+        for (int c = 0, rest = point; c < N; c++, rest /= problem.grid)
+        {
+            x[c] = problem.box[c] * (2.0 * (rest % problem.grid) / (problem.grid - 1) - 1.0);
+        }
+        sample(&problem, x);
+    }
+    lattice();
+
+    /* how far the lattice is from the qp, off the grid it was built on */
+    double worst = 0.0, squares = 0.0;
+    srand(1);
+    for (int sample = 0; sample < VERIFY_SAMPLES; sample++)
+    {
+        double x[N];
+        for (int c = 0; c < N; c++) { x[c] = problem.box[c] * (2.0 * rand() / RAND_MAX - 1.0); }
+        int bound[MAX_HORIZON];
+        solve_qp(&problem, x, bound);
+        Law exact = law_of(&problem, bound);
+        double difference = fabs(evaluate_lattice(x) - evaluate(&exact, x));
+        worst = fmax(worst, difference);
+        squares += difference * difference;
+    }
+    fprintf(stderr, "%d regions, %d laws, %d terms\n", region_count, law_count, term_count);
+    fprintf(stderr, "first move against the qp over %d random states: rms %.3f max %.3f duty counts\n", VERIFY_SAMPLES, sqrt(squares / VERIFY_SAMPLES), worst);
+
+    printf("/*\n");
+    printf(" * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi\n");
+    printf(" * mpc_regions.h - generated by host/tools/mpc_synth.c, don't edit, run it again\n");
+    wheel_model_print(&model, stdout);
+    printf(" * horizon %d, max duty %g, sampled over %g deg, %g dps, %g rad/s, %g deg s, %d regions\n",
+           problem.horizon, problem.max_duty, box[0], box[1], box[2], box[3], region_count);
+    printf(" * first move against the qp: rms %.3f max %.3f duty counts\n", sqrt(squares / VERIFY_SAMPLES), worst);
+    printf(" */\n\n");
+    printf("#ifndef _MPC_REGIONS_H\n#define _MPC_REGIONS_H\n\n");
+    /* same units as lqr_gains.h: degrees, dps and deg s, the wheel in rad/s */
+    printf("#define MPC_STATES    %d\n", N);
+    printf("#define MPC_PERIOD    (%#.6gF) /* seconds */\n", model.period);
+    printf("#define MPC_MAX_DUTY  (%#.6gF)\n", problem.max_duty);
+    printf("/* x = [pitch - balance (deg), pitch rate (dps), wheel speed (rad/s), integral of pitch - balance (deg s)] */\n");
+    printf("#define MPC_WHEEL_A   { %#.9gF, %#.9gF, %#.9gF, %#.9gF }\n", Ad[2][0] * deg, Ad[2][1] * deg, Ad[2][2], Ad[2][3] * deg);
+    printf("#define MPC_WHEEL_B   (%#.9gF)\n", Bd[2]);
+    printf("#define MPC_INTEGRAL_DECAY (%#.9gF)\n\n", Ad[3][3]);
+    printf("/* { { k }, offset }: duty = k x + offset */\n");
+    printf("#define MPC_LAW_COUNT %d\n", law_count);
+    printf("#define MPC_LAWS      { \\\n");
+    for (int i = 0; i < law_count; i++)
+    {
+        printf("    { { %#.9gF, %#.9gF, %#.9gF, %#.9gF }, %#.9gF }, \\\n",
+               laws[i].k[0] * unit[0], laws[i].k[1] * unit[1], laws[i].k[2] * unit[2], laws[i].k[3] * unit[3], laws[i].offset);
+    }
+    printf("}\n");
+    printf("/* duty = max over the terms of the min over the laws whose bit is set */\n");
+    printf("#define MPC_TERM_COUNT %d\n", term_count);
+    printf("#define MPC_TERMS     {");
+    for (int t = 0; t < term_count; t++) { printf(" 0x%08XU%s", terms[t], (t + 1 < term_count) ? "," : ""); }
+    printf(" }\n\n");
+    printf("#endif /* _MPC_REGIONS_H */");
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,229 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * replay.c - software in the loop replay of a session recorded by record.c, on the robot or by balance_sim --record.
+ * restores the snapshot the session starts with and feeds the recorded samples, gains and stops through control.c
+ * in the same order the control task did, then diffs the pitch error, the command and the duty that went out bit for
+ * bit against the recorded ones. streams the file through a fixed buffer, hours of session take seconds
+ *  
+ * usage: replay [--kp x] [--kd x] [--ki x] [--report n] session.bin
+ * a build with another CONTROL_LAW, CONTROL_ESTIMATOR, CONTROL_FIXED_POINT or CONTROL_PITCH_MODE than the recording starts
+ * cold from control_init, same for gains given here: the outputs get compared but aren't expected to match
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _DEFAULT_SOURCE /* clock_gettime */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "imu.h"
+#include "control.h"
+#include "motor.h"
+#include "stats.h"
+#include "record.h"
+
+#define PI                    (3.14159265358979F)
+#define GYRO_MEASURE_ERROR    (PI * (40.0F / 180.0F)) /* same filter tuning as main.c */
+#define BETA(x)               (sqrtf(3.0F / 4.0F) * (x))
+#define BUFFER_SIZE           65536U
+#define DEFAULT_REPORT        10U
+
+typedef enum {
+    OUTPUT_ERROR = 0,
+    OUTPUT_COMMAND,
+    OUTPUT_APPLIED,
+    OUTPUT_COUNT
+} Output;
+
+typedef struct {
+    uint64_t compared;
+    uint64_t differ;
+    double first;           /* sensor time of the first difference, seconds */
+    double max;
+    double sum2;
+} Diff;
+
+static const char *output_names[OUTPUT_COUNT] = { "pitch error", "command", "applied" };
+static uint8_t buffer[BUFFER_SIZE];
+static IMU imu;
+static Control control;
+
+/* distance in representable floats, 0 only for the exact same bits */
+static uint32_t ulps(float a, float b)
+{
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    if (ia < 0) { ia = (int32_t)(0x80000000U - (uint32_t)ia); }
+    if (ib < 0) { ib = (int32_t)(0x80000000U - (uint32_t)ib); }
+    return (ia > ib) ? (uint32_t)ia - (uint32_t)ib : (uint32_t)ib - (uint32_t)ia;
+}
+
+static void compare(Diff *diff, Output output, float recorded, float replayed, double time, uint32_t *reports)
+{
+    diff->compared++;
+    if (memcmp(&recorded, &replayed, sizeof(float)) == 0) { return; }
+
+    double delta = (double)replayed - (double)recorded;
+    if (diff->differ == 0U) { diff->first = time; }
+    diff->differ++;
+    diff->max = fmax(diff->max, fabs(delta));
+    diff->sum2 += delta * delta;
+    if (*reports > 0U)
+    {
+        (*reports)--;
+        printf("%10.4f s  %-12s recorded %.9g replayed %.9g, %u ulps\n", time, output_names[output], recorded, replayed, ulps(recorded, replayed));
+    }
+}
+
+static double wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    float override[3] = { NAN, NAN, NAN };
+    uint32_t reports = DEFAULT_REPORT;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--kp") == 0 && has_value)          { override[0] = (float)atof(argv[++i]); }
+        else if (strcmp(argv[i], "--kd") == 0 && has_value)     { override[1] = (float)atof(argv[++i]); }
+        else if (strcmp(argv[i], "--ki") == 0 && has_value)     { override[2] = (float)atof(argv[++i]); }
+        else if (strcmp(argv[i], "--report") == 0 && has_value) { reports = (uint32_t)strtoul(argv[++i], NULL, 10); }
+        else if (argv[i][0] != '-' && path == NULL)              { path = argv[i]; }
+        else { fprintf(stderr, "unknown argument %s, see the header of replay.c\n", argv[i]); return 1; }
+    }
+    if (path == NULL) { fprintf(stderr, "usage: replay [--kp x] [--kd x] [--ki x] [--report n] session.bin\n"); return 1; }
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) { fprintf(stderr, "can't read %s\n", path); return 1; }
+
+    double wall_start = wall_seconds();
+    size_t length = fread(buffer, 1U, BUFFER_SIZE, file);
+    RecordHeader header;
+    int used = record_decode_header(buffer, length, &header);
+    if (used <= 0) { fprintf(stderr, "%s is not a session recorded by record.c\n", path); return 1; }
+
+    control_init(&control, BETA(GYRO_MEASURE_ERROR), header.sample_period, CONTROL_DESIRED_ANGLE);
+    bool exact = record_restore(&header, &control, &imu);
+    if (!exact)
+    {
+        printf("recorded with control law %u, estimator %u, fixed point %u, pitch mode %u, this build has %u, %u, %u, %u:\n",
+               header.control_law, header.estimator, header.fixed_point, header.pitch_mode,
+               CONTROL_LAW, CONTROL_ESTIMATOR, CONTROL_FIXED_POINT, CONTROL_PITCH_MODE);
+        printf("starting cold, configure the host build like the robot's for a bit exact replay\n");
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        if (!isnan(override[i])) { exact = false; }
+    }
+    init_pwm();
+    stats_init();
+
+    /* the same calls in the same order as the control task, see record.h for what each event stands for */
+    Diff diffs[OUTPUT_COUNT] = { { 0 } };
+    RecordEvent event;
+    float gains[3] = { 0.0F, 0.0F, 0.0F };
+    uint64_t events = 0U, samples = 0U;
+    size_t start = (size_t)used;
+    bool ended = false, garbage = false;
+
+    while (!ended)
+    {
+        int size = record_decode(&buffer[start], length - start, &event);
+        if (size == 0)
+        {
+            /* out of whole events, move the tail to the front and read on */
+            memmove(buffer, &buffer[start], length - start);
+            length -= start;
+            start = 0U;
+            size_t more = fread(&buffer[length], 1U, BUFFER_SIZE - length, file);
+            if (more == 0U) { ended = true; if (length > 0U) { garbage = true; } }
+            length += more;
+            continue;
+        }
+        if (size < 0) { garbage = true; break; }
+        start += (size_t)size;
+        events++;
+
+        double time = (double)samples * (double)header.sample_period;
+        switch (event.tag)
+        {
+        case RECORD_SAMPLES:
+            control_estimate(&control, &imu, event.samples, event.count);
+            samples += event.count;
+            break;
+        case RECORD_HOLD:
+            control_hold(&control, event.values[0]);
+            break;
+        case RECORD_GAINS:
+            for (int i = 0; i < 3; i++) { gains[i] = isnan(override[i]) ? event.values[i] : override[i]; }
+            break;
+        case RECORD_COMPUTE:
+            control_compute(&control, gains[0], gains[1], gains[2]);
+            compare(&diffs[OUTPUT_ERROR], OUTPUT_ERROR, event.values[0], control.error, time, &reports);
+            compare(&diffs[OUTPUT_COMMAND], OUTPUT_COMMAND, event.values[1], control.command, time, &reports);
+            break;
+        case RECORD_ACTUATE:
+            /* what the motor got asked for, autotune and sysid replace or add to the controller's command. */
+            /* a replay that isn't exact keeps its own command, that's the point of changing something */
+            if (exact) { control.command = event.values[0]; }
+            control_actuate(&control);
+            compare(&diffs[OUTPUT_APPLIED], OUTPUT_APPLIED, event.values[1], control.applied, time, &reports);
+            break;
+        case RECORD_STOP:
+            control_stop(&control);
+            break;
+        case RECORD_RESTART:
+            control_restart(&control);
+            break;
+        default:
+            ended = true;
+            break;
+        }
+    }
+    fclose(file);
+
+    double wall = wall_seconds() - wall_start;
+    double seconds = (double)samples * (double)header.sample_period;
+    bool same = true;
+    printf("replayed           %.3f s of session, %llu samples, %llu events in %.3f s wall, %.0fx real time\n", seconds,
+           (unsigned long long)samples, (unsigned long long)events, wall, (wall > 0.0) ? seconds / wall : 0.0);
+    if (garbage) { printf("the session ends in the middle of an event or in garbage, replayed up to there\n"); }
+    for (int i = 0; i < OUTPUT_COUNT; i++)
+    {
+        const Diff *diff = &diffs[i];
+        if (diff->differ == 0U) { printf("%-18s identical over %llu\n", output_names[i], (unsigned long long)diff->compared); continue; }
+        same = false;
+        printf("%-18s %llu of %llu differ, first at %.4f s, max %.6g, rms %.6g\n", output_names[i], (unsigned long long)diff->differ,
+               (unsigned long long)diff->compared, diff->first, diff->max, sqrt(diff->sum2 / (double)diff->compared));
+    }
+    return same ? 0 : 2;
+}
\ No newline at end of file
@@ -0,0 +1,257 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * sysid_fit.c - fits a discrete transfer function from motor command to pitch (or pitch rate) to a capture of
+ * the firmware's sysid mode and estimates the delay between the two. least squares arx, every delay up to the
+ * limit gets a fit and the one with the smallest residual wins. the capture runs closed loop, the excitation
+ * is what makes the command informative, so only the one-step prediction error is meaningful: simulating the
+ * open loop model of an inverted pendulum runs away
+ *  
+ * usage: sysid_fit [--output pitch|rate] [--na n] [--nb n] [--max-delay ms] [--decimate n] capture.csv
+ * csv rows are t_us,command,rate_dps,pitch_deg as read from the sysid characteristic, # lines and the header skipped
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ROWS            65536U
+#define MAX_ORDER           6
+#define MAX_PARAMS          (2 * MAX_ORDER)
+#define ROOT_ITERATIONS     500
+
+typedef struct {
+    double *t;              /* seconds */
+    double *u;              /* command, counts */
+    double *y;              /* pitch, degrees, or rate, dps */
+    size_t rows;
+} Capture;
+
+typedef struct {
+    int na;
+    int nb;
+    int delay;              /* samples between the command and the first b term */
+    double theta[MAX_PARAMS]; /* a1..ana, b1..bnb */
+    double residual;        /* rms one-step prediction error */
+    double fit;             /* percent of the output variance the one-step prediction explains */
+} Arx;
+
+static bool load_capture(Capture *capture, const char *path, bool rate, int decimate)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+    size_t row = 0U;
+
+    if (file == NULL) { fprintf(stderr, "cannot open %s\n", path); return false; }
+    capture->t = malloc(MAX_ROWS * sizeof(double));
+    capture->u = malloc(MAX_ROWS * sizeof(double));
+    capture->y = malloc(MAX_ROWS * sizeof(double));
+    capture->rows = 0U;
+
+    while (fgets(line, sizeof(line), file) != NULL && capture->rows < MAX_ROWS)
+    {
+        double t = 0.0, u = 0.0, r = 0.0, p = 0.0;
+        if (sscanf(line, "%lf,%lf,%lf,%lf", &t, &u, &r, &p) != 4) { continue; } /* header, comments or junk */
+        if (row++ % (size_t)decimate != 0U) { continue; }
+        capture->t[capture->rows] = t * 1e-6;
+        capture->u[capture->rows] = u;
+        capture->y[capture->rows] = rate ? r : p;
+        capture->rows++;
+    }
+    fclose(file);
+
+    if (capture->rows < 64U) { fprintf(stderr, "%s has only %zu samples\n", path, capture->rows); return false; }
+    return true;
+}
+
+/* solves m x = v in place by gaussian elimination with partial pivoting, false if singular */
+static bool solve(int n, double m[MAX_PARAMS][MAX_PARAMS], double v[MAX_PARAMS], double x[MAX_PARAMS])
+{
+    for (int c = 0; c < n; c++)
+    {
+        int pivot = c;
+        for (int r = c + 1; r < n; r++) { if (fabs(m[r][c]) > fabs(m[pivot][c])) { pivot = r; } }
+        if (fabs(m[pivot][c]) < 1e-12) { return false; }
+        for (int k = 0; k < n; k++) { double swap = m[c][k]; m[c][k] = m[pivot][k]; m[pivot][k] = swap; }
+        double swap = v[c]; v[c] = v[pivot]; v[pivot] = swap;
+        for (int r = c + 1; r < n; r++)
+        {
+            double f = m[r][c] / m[c][c];
+            for (int k = c; k < n; k++) { m[r][k] -= f * m[c][k]; }
+            v[r] -= f * v[c];
+        }
+    }
+    for (int r = n - 1; r >= 0; r--)
+    {
+        double sum = v[r];
+        for (int k = r + 1; k < n; k++) { sum -= m[r][k] * x[k]; }
+        x[r] = sum / m[r][r];
+    }
+    return true;
+}
+
+/* y[k] = -a1 y[k-1] - ... - ana y[k-na] + b1 u[k-d-1] + ... + bnb u[k-d-nb], inputs with the means removed */
+static void regressors(const Arx *model, const double *u, const double *y, size_t k, double phi[MAX_PARAMS])
+{
+    for (int i = 0; i < model->na; i++) { phi[i] = -y[k - 1 - (size_t)i]; }
+    for (int i = 0; i < model->nb; i++) { phi[model->na + i] = u[k - 1 - (size_t)model->delay - (size_t)i]; }
+}
+
+static bool fit_arx(Arx *model, const double *u, const double *y, size_t rows)
+{
+    int n = model->na + model->nb;
+    size_t start = (size_t)((model->na > model->delay + model->nb) ? model->na : model->delay + model->nb);
+    double m[MAX_PARAMS][MAX_PARAMS] = { { 0.0 } };
+    double v[MAX_PARAMS] = { 0.0 };
+    double phi[MAX_PARAMS];
+
+    for (size_t k = start; k < rows; k++)
+    {
+        regressors(model, u, y, k, phi);
+        for (int i = 0; i < n; i++)
+        {
+            v[i] += phi[i] * y[k];
+            for (int j = 0; j < n; j++) { m[i][j] += phi[i] * phi[j]; }
+        }
+    }
+    if (!solve(n, m, v, model->theta)) { return false; }
+
+    double error = 0.0, energy = 0.0;
+    for (size_t k = start; k < rows; k++)
+    {
+        double prediction = 0.0;
+        regressors(model, u, y, k, phi);
+        for (int i = 0; i < n; i++) { prediction += phi[i] * model->theta[i]; }
+        error += (y[k] - prediction) * (y[k] - prediction);
+        energy += y[k] * y[k];
+    }
+    model->residual = sqrt(error / (double)(rows - start));
+    model->fit = (energy > 0.0) ? 100.0 * (1.0 - sqrt(error / energy)) : 0.0;
+    return true;
+}
+
+/* roots of z^n + c[0] z^(n-1) + ... + c[n-1], durand-kerner */
+static void roots(int n, const double *c, double complex *z)
+{
+    for (int i = 0; i < n; i++) { z[i] = cpow(0.4 + 0.9 * I, i); }
+    for (int iteration = 0; iteration < ROOT_ITERATIONS; iteration++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            double complex value = 1.0, denominator = 1.0;
+            for (int k = 0; k < n; k++) { value = value * z[i] + c[k]; }
+            for (int k = 0; k < n; k++) { if (k != i) { denominator *= z[i] - z[k]; } }
+            z[i] -= value / denominator;
+        }
+    }
+}
+
+static void print_polynomial(const char *name, const double *c, int n, bool monic)
+{
+    printf("%s(z) = ", name);
+    if (monic) { printf("1"); }
+    for (int i = 0; i < n; i++)
+    {
+        if (i > 0 || monic) { printf(" %c ", (c[i] < 0.0) ? '-' : '+'); printf("%.6g", fabs(c[i])); }
+        else                { printf("%.6g", c[i]); }
+        printf(" z^-%d", i + 1);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    Capture capture;
+    Arx model = { 2, 2, 0, { 0.0 }, 0.0, 0.0 };
+    Arx best = model;
+    const char *path = NULL;
+    bool rate = false;
+    double max_delay_ms = 30.0;
+    int decimate = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--output") == 0 && has_value)         { rate = (strcmp(argv[++i], "rate") == 0); }
+        else if (strcmp(argv[i], "--na") == 0 && has_value)        { model.na = atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--nb") == 0 && has_value)        { model.nb = atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--max-delay") == 0 && has_value) { max_delay_ms = atof(argv[++i]); }
+        else if (strcmp(argv[i], "--decimate") == 0 && has_value)  { decimate = atoi(argv[++i]); }
+        else if (argv[i][0] != '-' && path == NULL)                { path = argv[i]; }
+        else { fprintf(stderr, "unknown argument %s, see the header of sysid_fit.c\n", argv[i]); return 1; }
+    }
+    if (path == NULL) { fprintf(stderr, "no capture given, see the header of sysid_fit.c\n"); return 1; }
+    if (model.na < 1 || model.na > MAX_ORDER || model.nb < 1 || model.nb > MAX_ORDER || decimate < 1)
+    {
+        fprintf(stderr, "orders go from 1 to %d, decimate from 1 up\n", MAX_ORDER);
+        return 1;
+    }
+    if (!load_capture(&capture, path, rate, decimate)) { return 1; }
+
+    /* the operating point comes out, the model is of the deviations around it */
+    double period = (capture.t[capture.rows - 1U] - capture.t[0]) / (double)(capture.rows - 1U);
+    double u_mean = 0.0, y_mean = 0.0;
+    for (size_t k = 0U; k < capture.rows; k++) { u_mean += capture.u[k]; y_mean += capture.y[k]; }
+    u_mean /= (double)capture.rows;
+    y_mean /= (double)capture.rows;
+    for (size_t k = 0U; k < capture.rows; k++) { capture.u[k] -= u_mean; capture.y[k] -= y_mean; }
+
+    int max_delay = (int)(max_delay_ms * 1e-3 / period + 0.5);
+    best.residual = INFINITY;
+    fprintf(stderr, "%zu samples every %.3f ms, command mean %.2f counts\n", capture.rows, period * 1e3, u_mean);
+    for (model.delay = 0; model.delay <= max_delay; model.delay++)
+    {
+        if (!fit_arx(&model, capture.u, capture.y, capture.rows)) { continue; }
+        fprintf(stderr, "delay %2d (%6.2f ms): rms residual %.5f, fit %.2f%%\n", model.delay, model.delay * period * 1e3, model.residual, model.fit);
+        if (model.residual < best.residual) { best = model; }
+    }
+    if (!isfinite(best.residual)) { fprintf(stderr, "no delay gave a solvable fit, is there any excitation in the capture?\n"); return 1; }
+
+    const double *a = best.theta;
+    const double *b = &best.theta[best.na];
+    printf("# %s over command, %d/%d arx at %.3f ms\n", rate ? "pitch rate (dps)" : "pitch (deg)", best.na, best.nb, period * 1e3);
+    printf("delay %d samples, %.2f ms from the command to the first response\n", best.delay + 1, (best.delay + 1) * period * 1e3);
+    printf("one-step fit %.2f%%, rms residual %.5f\n", best.fit, best.residual);
+    printf("G(z) = z^-%d B(z) / A(z)\n", best.delay);
+    print_polynomial("A", a, best.na, true);
+    print_polynomial("B", b, best.nb, false);
+
+    double complex poles[MAX_ORDER];
+    roots(best.na, a, poles);
+    printf("poles:\n");
+    for (int i = 0; i < best.na; i++)
+    {
+        double complex s = clog(poles[i]) / period;
+        printf("  z = %9.6f %+9.6fi    s = %10.4f %+10.4fi rad/s%s\n", creal(poles[i]), cimag(poles[i]), creal(s), cimag(s),
+               (cabs(poles[i]) > 1.0) ? "  unstable" : "");
+    }
+    double dc_a = 1.0, dc_b = 0.0;
+    for (int i = 0; i < best.na; i++) { dc_a += a[i]; }
+    for (int i = 0; i < best.nb; i++) { dc_b += b[i]; }
+    if (fabs(dc_a) > 1e-9) { printf("static gain %.6g per count\n", dc_b / dc_a); }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,271 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * wheel_model.c - linear model of the reaction wheel pendulum around the balance point, shared by the
+ * host synthesis tools
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wheel_model.h"
+
+#define N                   WHEEL_MODEL_STATES
+#define PWM_FULL_SCALE      255.0
+#define GRAVITY             9.80665
+#define DARE_ITERATIONS     100000
+#define DARE_TOLERANCE      1e-12
+#define EXPM_TERMS          20
+
+/* c = a * b, all n x n */
+static void matmul(int n, const double *a, const double *b, double *c)
+{
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            double sum = 0.0;
+            for (int k = 0; k < n; k++) { sum += a[i * n + k] * b[k * n + j]; }
+            c[i * n + j] = sum;
+        }
+    }
+}
+
+/* exp(m) by scaling and squaring of a taylor series, good enough for the tiny systems here */
+static void expm(int n, const double *m, double *out)
+{
+    double scaled[(N + 1) * (N + 1)];
+    double term[(N + 1) * (N + 1)];
+    double next[(N + 1) * (N + 1)];
+    double norm = 0.0;
+    int squarings = 0;
+
+    for (int i = 0; i < n * n; i++) { norm = fmax(norm, fabs(m[i])); }
+    while (norm * n > 0.5) { norm *= 0.5; squarings++; }
+    for (int i = 0; i < n * n; i++) { scaled[i] = m[i] / pow(2.0, squarings); }
+
+    for (int i = 0; i < n * n; i++) { out[i] = term[i] = (i % (n + 1) == 0) ? 1.0 : 0.0; }
+    for (int k = 1; k <= EXPM_TERMS; k++)
+    {
+        matmul(n, term, scaled, next);
+        for (int i = 0; i < n * n; i++) { term[i] = next[i] / k; out[i] += term[i]; }
+    }
+    for (int s = 0; s < squarings; s++)
+    {
+        matmul(n, out, out, next);
+        memcpy(out, next, sizeof(double) * (size_t)(n * n));
+    }
+}
+
+/* x' = A x + B u around the balance point */
+static void linearize(const WheelModel *p, double A[N][N], double B[N])
+{
+    double gravity = p->mass * GRAVITY * p->com / p->inertia;          /* 1/s^2 */
+    double drive = p->kt * p->vbat / (PWM_FULL_SCALE * p->resistance); /* Nm per duty count */
+    double emf = p->kt * p->ke / p->resistance;                        /* Nm per rad/s of wheel */
+
+    memset(A, 0, sizeof(double) * N * N);
+    /* body: J phi'' = m g l phi + tau, the motor pushes the body one way and the wheel the other */
+    A[0][1] = 1.0;
+    A[1][0] = gravity;
+    A[1][2] = -emf / p->inertia;
+    B[1] = drive / p->inertia;
+    /* wheel relative to the body: w' = phi'' + tau / Jw */
+    A[2][0] = gravity;
+    A[2][2] = -emf / p->inertia - emf / p->wheel_inertia;
+    B[2] = drive / p->inertia + drive / p->wheel_inertia;
+    /* integral of the pitch, discretized separately */
+    B[0] = 0.0;
+    B[3] = 0.0;
+}
+
+/* zero order hold: exp([A B; 0 0] T) = [Ad Bd; 0 1] */
+static void discretize(double A[N][N], const double B[N], double period, double Ad[N][N], double Bd[N])
+{
+    double m[(N + 1) * (N + 1)] = { 0.0 };
+    double e[(N + 1) * (N + 1)];
+
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++) { m[i * (N + 1) + j] = A[i][j] * period; }
+        m[i * (N + 1) + N] = B[i] * period;
+    }
+    expm(N + 1, m, e);
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++) { Ad[i][j] = e[i * (N + 1) + j]; }
+        Bd[i] = e[i * (N + 1) + N];
+    }
+}
+
+/*
+ * the gravity impulse is the only thing that changes the total angular momentum, so a pure integral of the
+ * pitch is a fixed combination of the wheel speed and the pitch rate and the riccati iteration never settles.
+ * the firmware leaks the integral instead, x3[k+1] = decay x3[k] + T x0[k], and the model does the same
+ */
+static void leak_integral(double Ad[N][N], double Bd[N], double period, double leak)
+{
+    for (int j = 0; j < N; j++) { Ad[3][j] = 0.0; }
+    Ad[3][0] = period;
+    Ad[3][3] = 1.0 - period / leak;
+    Bd[3] = 0.0;
+}
+
+/*
+ * P = Q + (A - BK)'P(A - BK) + K'RK with K = (R + B'PB)^-1 B'PA, iterated to a fixed point. same answer as the
+ * textbook A'PA - A'PB (R + B'PB)^-1 B'PA but it keeps P symmetric and positive, the textbook form loses both to
+ * cancellation with these stiff gains and blows up before the slow integral mode settles. single input, so the
+ * inverse is a division
+ */
+int wheel_model_dare(double Ad[N][N], const double Bd[N], const double q[N], double r, double K[N], double P[N][N])
+{
+    double next[N][N];
+
+    memset(P, 0, sizeof(double) * N * N);
+    for (int i = 0; i < N; i++) { P[i][i] = q[i]; }
+    for (int iteration = 0; iteration < DARE_ITERATIONS; iteration++)
+    {
+        double PB[N] = { 0.0 };
+        double BPB = 0.0;
+        double closed[N][N];
+        double PC[N][N] = { { 0.0 } };
+        double change = 0.0;
+
+        for (int i = 0; i < N; i++) { for (int j = 0; j < N; j++) { PB[i] += P[i][j] * Bd[j]; } }
+        for (int i = 0; i < N; i++) { BPB += Bd[i] * PB[i]; }
+        for (int j = 0; j < N; j++)
+        {
+            double BPA = 0.0;
+            for (int i = 0; i < N; i++) { BPA += PB[i] * Ad[i][j]; }
+            K[j] = BPA / (r + BPB);
+        }
+
+        for (int i = 0; i < N; i++) { for (int j = 0; j < N; j++) { closed[i][j] = Ad[i][j] - Bd[i] * K[j]; } }
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++) { for (int k = 0; k < N; k++) { PC[i][j] += P[i][k] * closed[k][j]; } }
+        }
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = i; j < N; j++)
+            {
+                double CPC = 0.0;
+                for (int k = 0; k < N; k++) { CPC += closed[k][i] * PC[k][j]; }
+                next[i][j] = next[j][i] = ((i == j) ? q[i] : 0.0) + CPC + K[i] * r * K[j];
+                change = fmax(change, fabs(next[i][j] - P[i][j]) / fmax(1.0, fabs(next[i][j])));
+            }
+        }
+        memcpy(P, next, sizeof(next));
+        if (!isfinite(P[0][0])) { return -1; }
+        if (change < DARE_TOLERANCE) { return iteration + 1; }
+    }
+    return -1;
+}
+
+double wheel_model_spectral_radius(double Ad[N][N], const double Bd[N], const double K[N])
+{
+    double v[N] = { 1.0, 0.7, 0.3, 0.1 };
+    double radius = 0.0;
+
+    for (int iteration = 0; iteration < 2000; iteration++)
+    {
+        double w[N] = { 0.0 };
+        double norm = 0.0;
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++) { w[i] += (Ad[i][j] - Bd[i] * K[j]) * v[j]; }
+            norm += w[i] * w[i];
+        }
+        norm = sqrt(norm);
+        if (norm == 0.0) { return 0.0; }
+        radius = norm;
+        for (int i = 0; i < N; i++) { v[i] = w[i] / norm; }
+    }
+    return radius;
+}
+
+void wheel_model_defaults(WheelModel *p)
+{
+    /* ballpark of the reuleaux triangle with the flywheel in the middle, measure yours */
+    p->mass = 0.30;
+    p->com = 0.05;
+    p->inertia = 1.2e-3;
+    p->wheel_inertia = 1.5e-5;
+    p->kt = 0.005;
+    p->ke = 0.005;
+    p->resistance = 2.0;
+    p->vbat = 3.7;
+    p->period = 0.005;  /* one fifo batch of 5 samples at 1 kHz */
+    p->leak = 2.0;
+    p->q[0] = 100.0;
+    p->q[1] = 1.0;
+    p->q[2] = 1e-4;
+    p->q[3] = 10.0;
+    p->r = 1e-4;
+}
+
+int wheel_model_parse(WheelModel *p, int argc, char **argv, int *i)
+{
+    const char *option = argv[*i];
+    if (*i + 1 >= argc) { return 0; }
+    const char *value = argv[*i + 1];
+
+    if (strcmp(option, "--mass") == 0)               { p->mass = atof(value); }
+    else if (strcmp(option, "--com") == 0)           { p->com = atof(value); }
+    else if (strcmp(option, "--inertia") == 0)       { p->inertia = atof(value); }
+    else if (strcmp(option, "--wheel-inertia") == 0) { p->wheel_inertia = atof(value); }
+    else if (strcmp(option, "--kt") == 0)            { p->kt = atof(value); }
+    else if (strcmp(option, "--ke") == 0)            { p->ke = atof(value); }
+    else if (strcmp(option, "--resistance") == 0)    { p->resistance = atof(value); }
+    else if (strcmp(option, "--vbat") == 0)          { p->vbat = atof(value); }
+    else if (strcmp(option, "--period") == 0)        { p->period = atof(value); }
+    else if (strcmp(option, "--leak") == 0)          { p->leak = atof(value); }
+    else if (strcmp(option, "--r") == 0)             { p->r = atof(value); }
+    else if (strcmp(option, "--q") == 0)
+    {
+        if (sscanf(value, "%lf,%lf,%lf,%lf", &p->q[0], &p->q[1], &p->q[2], &p->q[3]) != 4) { fprintf(stderr, "--q takes four comma separated weights\n"); return -1; }
+    }
+    else { return 0; }
+    (*i)++;
+    return 1;
+}
+
+int wheel_model_discrete(const WheelModel *p, double Ad[N][N], double Bd[N])
+{
+    double A[N][N], B[N];
+
+    if (p->period <= 0.0 || p->leak <= p->period) { fprintf(stderr, "--leak has to be longer than --period\n"); return -1; }
+    if (p->inertia <= 0.0 || p->wheel_inertia <= 0.0 || p->resistance <= 0.0) { fprintf(stderr, "inertias and resistance have to be positive\n"); return -1; }
+    linearize(p, A, B);
+    discretize(A, B, p->period, Ad, Bd);
+    leak_integral(Ad, Bd, p->period, p->leak);
+    return 0;
+}
+
+void wheel_model_print(const WheelModel *p, FILE *out)
+{
+    fprintf(out, " * mass %g kg, com %g m, inertia %g kgm2, wheel inertia %g kgm2, kt %g, ke %g, resistance %g ohm, vbat %g V\n",
+            p->mass, p->com, p->inertia, p->wheel_inertia, p->kt, p->ke, p->resistance, p->vbat);
+    fprintf(out, " * period %g s, leak %g s, q %g,%g,%g,%g, r %g\n", p->period, p->leak, p->q[0], p->q[1], p->q[2], p->q[3], p->r);
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * wheel_model.h - linear model of the reaction wheel pendulum around the balance point, shared by the
+ * host synthesis tools. states are [pitch - balance (rad), pitch rate (rad/s), wheel speed (rad/s),
+ * leaky integral of pitch (rad s)], the input is the signed motor duty in counts of an 8-bit pwm
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WHEEL_MODEL_H
+#define _WHEEL_MODEL_H
+#include <stdio.h>
+
+#define WHEEL_MODEL_STATES  4
+
+typedef struct {
+    double mass;            /* whole robot, kg */
+    double com;             /* pivot to center of mass, m */
+    double inertia;         /* body about the pivot, wheel mass included, kg m^2 */
+    double wheel_inertia;   /* flywheel about its axle, kg m^2 */
+    double kt;              /* torque constant, Nm/A */
+    double ke;              /* back emf constant, V s/rad */
+    double resistance;      /* winding, ohm */
+    double vbat;            /* V */
+    double period;          /* control period, s */
+    double leak;            /* time constant of the pitch integral, s */
+    double q[WHEEL_MODEL_STATES]; /* state weights */
+    double r;               /* input weight */
+} WheelModel;
+
+void wheel_model_defaults(WheelModel *model);
+/* takes argv[*i] and its value if it is one of the model options, returns 0 if it isn't and -1 if it is malformed */
+int wheel_model_parse(WheelModel *model, int argc, char **argv, int *i);
+/* discrete Ad, Bd at the control period, -1 if the parameters make no sense */
+int wheel_model_discrete(const WheelModel *model, double Ad[WHEEL_MODEL_STATES][WHEEL_MODEL_STATES], double Bd[WHEEL_MODEL_STATES]);
+/* infinite horizon gain and cost, returns the iterations it took or -1 if it didn't converge */
+int wheel_model_dare(double Ad[WHEEL_MODEL_STATES][WHEEL_MODEL_STATES], const double Bd[WHEEL_MODEL_STATES], const double q[WHEEL_MODEL_STATES],
+                     double r, double K[WHEEL_MODEL_STATES], double P[WHEEL_MODEL_STATES][WHEEL_MODEL_STATES]);
+/* largest |eigenvalue| of Ad - Bd K by power iteration, < 1 means the loop is stable. rough for complex pairs */
+double wheel_model_spectral_radius(double Ad[WHEEL_MODEL_STATES][WHEEL_MODEL_STATES], const double Bd[WHEEL_MODEL_STATES], const double K[WHEEL_MODEL_STATES]);
+/* the parameters as comment lines for a generated header */
+void wheel_model_print(const WheelModel *model, FILE *out);
+
+#endif /* _WHEEL_MODEL_H */
\ No newline at end of file
@@ -0,0 +1,239 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * autotune.c - relay feedback autotuner for the pid gains
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "autotune.h"
+#include "control.h"
+
+#define PI    (3.14159265358979F)
+
+/*
+ * a relay on the pitch error alone can't hold an inverted pendulum, with the motor and sampling lag the swing grows
+ * until it falls. so the relay switches on error - lead * rate, which is the pendulum with a (1 + lead s) in front:
+ * the experiment finds the ultimate point of that loop and the rule designs a pid for it, the lead gets multiplied
+ * back in when converting to the parallel gains of the firmware (the lead * Td s^2 term is left out)
+ */
+
+typedef struct {
+    float kp;               /* times ku */
+    float ti;               /* times tu */
+    float td;               /* times tu */
+} Rule;
+
+static const Rule rules[AUTOTUNE_RULE_COUNT] = {
+    [AUTOTUNE_RULE_ZIEGLER_NICHOLS] = { 0.6F,        0.5F, 0.125F      },
+    [AUTOTUNE_RULE_TYREUS_LUYBEN]   = { 1.0F / 2.2F, 2.2F, 1.0F / 6.3F },
+    [AUTOTUNE_RULE_PESSEN]          = { 0.7F,        0.4F, 0.15F       },
+    [AUTOTUNE_RULE_NO_OVERSHOOT]    = { 0.2F,        0.5F, 1.0F / 3.0F },
+};
+static const char *rule_names[AUTOTUNE_RULE_COUNT] = { "zn", "tl", "pessen", "no-overshoot" };
+
+typedef struct {
+    AutotuneRule rule;
+    float relay;            /* command sent, +-AUTOTUNE_RELAY */
+    float elapsed;          /* seconds since the start */
+    float since_switch;     /* seconds since the relay last went positive */
+    bool switched;          /* went positive at least once, since_switch is a whole period from the next one on */
+    float sigma_min;        /* of error - lead * rate over the current period */
+    float sigma_max;
+    uint8_t periods;        /* whole periods seen, including the skipped ones */
+    float period[AUTOTUNE_CYCLES];
+    float amplitude[AUTOTUNE_CYCLES];
+} Relay;
+
+static Relay relay;                                 /* only touched by the control task */
+static AutotuneResult result;                       /* written before phase turns DONE */
+static const char *failure = "";
+static volatile AutotunePhase phase = AUTOTUNE_IDLE;
+static volatile int8_t requested = -1;              /* rule asked for over ble, -1 for none */
+static volatile int8_t confirmation = 0;            /* 1 accept, -1 drop, 0 nothing yet */
+
+static void fail(const char *reason)
+{
+    failure = reason;
+    phase = AUTOTUNE_FAILED;
+    ESP_LOGW("autotune", "Relay experiment failed: %s", reason);
+}
+
+void autotune_request(AutotuneRule rule)
+{
+    if (rule >= AUTOTUNE_RULE_COUNT) { return; }
+    /* the lqr and the mpc never look at the ble gains, a run would only propose gains nothing uses */
+    if (!control_uses_gains())
+    {
+        if (phase != AUTOTUNE_RELAY_RUNNING) { fail("the control law ignores pid gains"); }
+        return;
+    }
+    requested = (int8_t)rule;
+}
+
+void autotune_confirm(bool accept)
+{
+    /* only once the gains are out there to look at, an early confirmation would take them unseen */
+    if (phase == AUTOTUNE_DONE) { confirmation = accept ? 1 : -1; }
+}
+
+size_t autotune_string(char *buffer, size_t size)
+{
+    int length = 0;
+    switch (phase)
+    {
+        case AUTOTUNE_RELAY_RUNNING:
+            length = snprintf(buffer, size, "relay %s %u/%u", rule_names[relay.rule], relay.periods, AUTOTUNE_SKIP_CYCLES + AUTOTUNE_CYCLES);
+            break;
+        case AUTOTUNE_DONE:
+            length = snprintf(buffer, size, "confirm? ku %.2f tu %.3f kp %.2f kd %.2f ki %.2f", result.ku, result.tu, result.kp, result.kd, result.ki);
+            break;
+        case AUTOTUNE_FAILED:
+            length = snprintf(buffer, size, "failed: %s", failure);
+            break;
+        default:
+            length = snprintf(buffer, size, "idle");
+            break;
+    }
+    if (length < 0) { return 0U; }
+    return ((size_t)length < size) ? (size_t)length : size - 1U;
+}
+
+void autotune_gains(AutotuneRule rule, float ku, float tu, float lead, AutotuneResult *out)
+{
+    const Rule *r = &rules[rule];
+    float kp = r->kp * ku;
+    float ti = r->ti * tu;
+    float td = r->td * tu;
+
+    /* kp (1 + 1 / (ti s) + td s) (1 + lead s), multiplied out */
+    out->ku = ku;
+    out->tu = tu;
+    out->kp = kp * (1.0F + lead / ti);
+    out->ki = kp / ti;
+    out->kd = kp * (td + lead);
+}
+
+bool autotune_poll(bool active, float *kp, float *kd, float *ki)
+{
+    if (phase == AUTOTUNE_RELAY_RUNNING && !active) { fail("control went off"); }
+
+    if (requested >= 0 && active && phase != AUTOTUNE_RELAY_RUNNING)
+    {
+        relay.rule = (AutotuneRule)requested;
+        relay.relay = AUTOTUNE_RELAY;
+        relay.elapsed = 0.0F;
+        relay.since_switch = 0.0F;
+        relay.switched = false;
+        relay.sigma_min = INFINITY;
+        relay.sigma_max = -INFINITY;
+        relay.periods = 0U;
+        confirmation = 0;
+        phase = AUTOTUNE_RELAY_RUNNING;
+        ESP_LOGI("autotune", "Relay experiment started, %s rule", rule_names[relay.rule]);
+    }
+    requested = -1;
+
+    if (phase != AUTOTUNE_DONE || confirmation == 0) { return false; }
+    phase = AUTOTUNE_IDLE;
+    if (confirmation < 0) { return false; }
+
+    *kp = result.kp;
+    *kd = result.kd;
+    *ki = result.ki;
+    return true;
+}
+
+bool autotune_running(void)
+{
+    return phase == AUTOTUNE_RELAY_RUNNING;
+}
+
+static void finish(void)
+{
+    float period_sum = 0.0F;
+    float amplitude_sum = 0.0F;
+    float period_min = INFINITY;
+    float period_max = 0.0F;
+    for (uint8_t i = 0U; i < AUTOTUNE_CYCLES; i++)
+    {
+        period_sum += relay.period[i];
+        amplitude_sum += relay.amplitude[i];
+        period_min = fminf(period_min, relay.period[i]);
+        period_max = fmaxf(period_max, relay.period[i]);
+    }
+    float tu = period_sum / (float)AUTOTUNE_CYCLES;
+    float amplitude = amplitude_sum / (float)AUTOTUNE_CYCLES;
+
+    if (period_max - period_min > AUTOTUNE_PERIOD_SPREAD * tu) { fail("the oscillation never settled"); return; }
+    if (amplitude <= AUTOTUNE_HYSTERESIS) { fail("the oscillation is inside the hysteresis"); return; }
+
+    /* describing function of a relay with hysteresis, 4 d / (pi sqrt(a^2 - h^2)) */
+    float ku = 4.0F * AUTOTUNE_RELAY / (PI * sqrtf(amplitude * amplitude - AUTOTUNE_HYSTERESIS * AUTOTUNE_HYSTERESIS));
+    autotune_gains(relay.rule, ku, tu, AUTOTUNE_LEAD, &result);
+    confirmation = 0;
+    phase = AUTOTUNE_DONE;
+    ESP_LOGI("autotune", "ku %.2f tu %.3f s -> kp %.2f kd %.2f ki %.2f, waiting for confirmation", ku, tu, result.kp, result.kd, result.ki);
+}
+
+float autotune_step(float error, float rate, float deltat)
+{
+    if (phase != AUTOTUNE_RELAY_RUNNING) { return 0.0F; }
+
+    relay.elapsed += deltat;
+    relay.since_switch += deltat;
+    if (fabsf(error) > AUTOTUNE_MAX_ERROR) { fail("swung past the amplitude limit"); return 0.0F; }
+    if (relay.elapsed > AUTOTUNE_TIMEOUT) { fail("timed out"); return 0.0F; }
+
+    float sigma = error - AUTOTUNE_LEAD * rate;
+    relay.sigma_min = fminf(relay.sigma_min, sigma);
+    relay.sigma_max = fmaxf(relay.sigma_max, sigma);
+
+    if (relay.relay < 0.0F && sigma > AUTOTUNE_HYSTERESIS)
+    {
+        /* a whole period ends every time the relay goes positive */
+        if (relay.switched)
+        {
+            if (relay.periods >= AUTOTUNE_SKIP_CYCLES)
+            {
+                uint8_t i = relay.periods - AUTOTUNE_SKIP_CYCLES;
+                relay.period[i] = relay.since_switch;
+                relay.amplitude[i] = 0.5F * (relay.sigma_max - relay.sigma_min);
+            }
+            relay.periods++;
+        }
+        relay.switched = true;
+        relay.since_switch = 0.0F;
+        relay.sigma_min = sigma;
+        relay.sigma_max = sigma;
+        relay.relay = AUTOTUNE_RELAY;
+        if (relay.periods >= AUTOTUNE_SKIP_CYCLES + AUTOTUNE_CYCLES) { finish(); return 0.0F; }
+    }
+    else if (relay.relay > 0.0F && sigma < -AUTOTUNE_HYSTERESIS)
+    {
+        relay.relay = -AUTOTUNE_RELAY;
+    }
+    return relay.relay;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * autotune.h - relay feedback (astrom & hagglund) autotuner for the pid gains. the relay balances the robot
+ * around the set point on its own for a few seconds, the oscillation it settles into gives the ultimate gain and
+ * period, and a tuning rule turns those into kp, kd and ki that wait for a confirmation before they get used
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _AUTOTUNE_H
+#define _AUTOTUNE_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define AUTOTUNE_RELAY           (160.0F) /* counts either way, the swing has to stay where this can still catch it */
+#define AUTOTUNE_HYSTERESIS      (0.3F)   /* degrees, keeps gyro and accel noise from flipping the relay */
+#define AUTOTUNE_LEAD            (0.06F)  /* seconds, the relay switches on error - lead * rate, see autotune.c */
+#define AUTOTUNE_MAX_ERROR       (3.0F)   /* degrees off the set point that end the experiment, past ~2 the relay can't pull it back */
+#define AUTOTUNE_TIMEOUT         (8.0F)   /* seconds */
+#define AUTOTUNE_SKIP_CYCLES     2U       /* the first periods are still settling */
+#define AUTOTUNE_CYCLES          4U       /* averaged into the result */
+#define AUTOTUNE_PERIOD_SPREAD   (0.2F)   /* measured periods further apart than this fraction of the mean don't count */
+#define SIZEOF_AUTOTUNE_DATA     128
+
+typedef enum {
+    AUTOTUNE_IDLE = 0,
+    AUTOTUNE_RELAY_RUNNING,  /* the relay drives the motor instead of the controller */
+    AUTOTUNE_DONE,           /* gains proposed, waiting for autotune_confirm */
+    AUTOTUNE_FAILED,
+} AutotunePhase;
+
+typedef enum {
+    AUTOTUNE_RULE_ZIEGLER_NICHOLS = 0, /* classic, quarter decay, overshoots */
+    AUTOTUNE_RULE_TYREUS_LUYBEN,       /* gentler and more robust, the safe pick for a new unit */
+    AUTOTUNE_RULE_PESSEN,              /* pessen integral rule, fast disturbance rejection */
+    AUTOTUNE_RULE_NO_OVERSHOOT,
+    AUTOTUNE_RULE_COUNT
+} AutotuneRule;
+
+typedef struct {
+    float ku;               /* ultimate gain, counts per degree */
+    float tu;               /* ultimate period, seconds */
+    float kp;               /* same units as the ble gains: counts per degree, per dps and per degree second */
+    float kd;
+    float ki;
+} AutotuneResult;
+
+/* ble side, any task: ask for a run with rule, picked up on the next pass if control is on */
+void autotune_request(AutotuneRule rule);
+/* ble side: accept or drop the proposed gains */
+void autotune_confirm(bool accept);
+size_t autotune_string(char *buffer, size_t size);
+
+/* control task, once per pass: starts a requested run when active, aborts it when not */
+/* returns true once with the gains after they were accepted */
+bool autotune_poll(bool active, float *kp, float *kd, float *ki);
+bool autotune_running(void);
+/* one control pass of the relay: error = set point - pitch (deg), rate in dps. returns the command */
+float autotune_step(float error, float rate, float deltat);
+/* kp, kd, ki for the pid from the ultimate point of the relay loop */
+void autotune_gains(AutotuneRule rule, float ku, float tu, float lead, AutotuneResult *result);
+
+#endif /* _AUTOTUNE_H */
\ No newline at end of file
@@ -45,12 +45,21 @@
 #include "services/gatt/ble_svc_gatt.h"
 #include "globals.h"
 #include "ble.h"
+#include "boot.h"
+#include "stats.h"
+#include "autotune.h"
+#include "sysid.h"
+#include "record.h"
+#include "telemetry.h"
 
 /* TODO: the read and write operations of the PID constants variables aren't technically thread safe */
 /*       they need a mutex but i'm lazy and since this thread only read/writes while the other just  */
 /*       reads (and multiple times), it is ok so whatever :PPP also im too lazy rn to do that        */
 
 static uint8_t ble_addr_type;
+static uint16_t telemetry_handle;
+static uint16_t telemetry_conn = BLE_HS_CONN_HANDLE_NONE; /* subscribed to telemetry, only touched in the host task */
+static struct ble_npl_callout telemetry_callout;
 
 void ble_app_advertise(void); /* forward declare this function cause api is shit >:) */
 
@@ -167,6 +176,150 @@ static int update_ki(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_
     return 0;
 }
 
+static int read_boot(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char buffer[SIZEOF_BOOT_DATA] = { 0 };
+    size_t length = boot_timeline_string(buffer, SIZEOF_BOOT_DATA);
+    os_mbuf_append(ctxt->om, buffer, length);
+    return 0;
+}
+
+static int read_stats(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char buffer[SIZEOF_STATS_DATA] = { 0 };
+    size_t length = stats_string(buffer, SIZEOF_STATS_DATA);
+    os_mbuf_append(ctxt->om, buffer, length);
+    return 0;
+}
+
+static int reset_stats(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    /* any write clears them, the control task picks it up on its next pass */
+    stats_request_reset();
+    return 0;
+}
+
+static int calibrate_friction(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    /* any write starts it, the control task ignores it while control is on. the wheel must be free to spin */
+    friction_calibrate = true;
+    return 0;
+}
+
+static int read_autotune(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char buffer[SIZEOF_AUTOTUNE_DATA] = { 0 };
+    size_t length = autotune_string(buffer, SIZEOF_AUTOTUNE_DATA);
+    os_mbuf_append(ctxt->om, buffer, length);
+    return 0;
+}
+
+static int start_autotune(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char *data = (char *)ctxt->om->om_data;
+    char parsed_data[SIZEOF_RDATA] = { 0 };
+
+    /* the rule number, e.g. "1;" for tyreus-luyben. only starts while control is on and the robot is balancing */
+    if (!parse_rx_data(data, parsed_data)) { return 0; }
+    autotune_request((AutotuneRule)strtoul(parsed_data, NULL, 10));
+    return 0;
+}
+
+static int confirm_autotune(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char *data = (char *)ctxt->om->om_data;
+
+    /* same as toggle_control, "1" uses the proposed gains and "0" throws them away */
+    if (strncmp(data, "1", 1) == 0) { autotune_confirm(true); }
+    if (strncmp(data, "0", 1) == 0) { autotune_confirm(false); }
+    return 0;
+}
+
+static int read_sysid(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    static char buffer[SIZEOF_SYSID_DATA]; /* too big for the ble host task stack */
+
+    /* a read blob would call this again and move the capture on, so a chunk has to fit one read response (mtu - 1). */
+    /* the terminator makes it one shorter still, a response that fills the mtu exactly makes some clients read on */
+    size_t size = (size_t)ble_att_mtu(con_handle) - 1U;
+    if (size > SIZEOF_SYSID_DATA) { size = SIZEOF_SYSID_DATA; }
+    if (size < SYSID_MIN_READ)
+    {
+        size = (size_t)snprintf(buffer, SIZEOF_SYSID_DATA, "mtu %u too small, needs %u", ble_att_mtu(con_handle), SYSID_MIN_READ + 1U);
+        os_mbuf_append(ctxt->om, buffer, size);
+        return 0;
+    }
+    size_t length = sysid_read(buffer, size);
+    os_mbuf_append(ctxt->om, buffer, length);
+    return 0;
+}
+
+static int start_sysid(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char *data = (char *)ctxt->om->om_data;
+    char parsed_data[SIZEOF_RDATA] = { 0 };
+
+    /* first digit the signal (0 prbs, 1 chirp), the rest the amplitude in counts: "140;" is a 40 count chirp */
+    if (!parse_rx_data(data, parsed_data)) { return 0; }
+    sysid_request((SysidSignal)(parsed_data[0] - '0'), strtof(&parsed_data[1], NULL));
+    return 0;
+}
+
+static int read_record(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char buffer[SIZEOF_RECORD_DATA] = { 0 };
+    size_t length = record_string(buffer, SIZEOF_RECORD_DATA);
+    os_mbuf_append(ctxt->om, buffer, length);
+    return 0;
+}
+
+static int start_record(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char *data = (char *)ctxt->om->om_data;
+    char parsed_data[SIZEOF_RDATA] = { 0 };
+
+    /* seconds of session to record, e.g. "600;", starting with the next pass that has control on. "0;" ends it */
+    if (!parse_rx_data(data, parsed_data)) { return 0; }
+    record_request((uint32_t)strtoul(parsed_data, NULL, 10));
+    return 0;
+}
+
+static int read_telemetry(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char buffer[SIZEOF_TELEMETRY_DATA] = { 0 };
+    size_t length = telemetry_string(buffer, SIZEOF_TELEMETRY_DATA);
+    os_mbuf_append(ctxt->om, buffer, length);
+    return 0;
+}
+
+static int update_telemetry(uint16_t con_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    char *data = (char *)ctxt->om->om_data;
+    char parsed_data[SIZEOF_RDATA] = { 0 };
+
+    /* keep one pass out of this many, e.g. "4;" for 50 Hz */
+    if (!parse_rx_data(data, parsed_data)) { return 0; }
+    telemetry_set_decimation((uint32_t)strtoul(parsed_data, NULL, 10));
+    return 0;
+}
+
+/* runs in the host task every TELEMETRY_PERIOD_MS while someone is subscribed, one notification per tick */
+static void telemetry_notify(struct ble_npl_event *event)
+{
+    uint8_t buffer[TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_RECORDS * TELEMETRY_RECORD_SIZE];
+
+    if (telemetry_conn == BLE_HS_CONN_HANDLE_NONE) { return; }
+    size_t room = ble_att_mtu(telemetry_conn) - 3U; /* att notification header */
+    if (room > sizeof(buffer)) { room = sizeof(buffer); }
+    size_t length = telemetry_pack(buffer, room);
+    if (length > 0U)
+    {
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(buffer, length);
+        if (om != NULL) { ble_gatts_notify_custom(telemetry_conn, telemetry_handle, om); } /* out of mbufs drops this one */
+    }
+    ble_npl_callout_reset(&telemetry_callout, ble_npl_time_ms_to_ticks32(TELEMETRY_PERIOD_MS));
+}
+
 /* array of pointers to other service definitions */
 /* UUID - Universal Unique Identifier */
 static const struct ble_gatt_svc_def gatt_svcs[] = {
@@ -194,6 +347,49 @@ static const struct ble_gatt_svc_def gatt_svcs[] = {
          {.uuid = BLE_UUID16_DECLARE(WRIT_KI_UUID),
           .flags = BLE_GATT_CHR_F_WRITE,
           .access_cb = update_ki},
+         {.uuid = BLE_UUID16_DECLARE(READ_BOOT_UUID),
+          .flags = BLE_GATT_CHR_F_READ,
+          .access_cb = read_boot},
+         {.uuid = BLE_UUID16_DECLARE(READ_STATS_UUID),
+          .flags = BLE_GATT_CHR_F_READ,
+          .access_cb = read_stats},
+         {.uuid = BLE_UUID16_DECLARE(WRIT_STATS_UUID),
+          .flags = BLE_GATT_CHR_F_WRITE,
+          .access_cb = reset_stats},
+         {.uuid = BLE_UUID16_DECLARE(WRIT_FRICTION_UUID),
+          .flags = BLE_GATT_CHR_F_WRITE,
+          .access_cb = calibrate_friction},
+         {.uuid = BLE_UUID16_DECLARE(READ_TUNE_UUID),
+          .flags = BLE_GATT_CHR_F_READ,
+          .access_cb = read_autotune},
+         {.uuid = BLE_UUID16_DECLARE(WRIT_TUNE_UUID),
+          .flags = BLE_GATT_CHR_F_WRITE,
+          .access_cb = start_autotune},
+         {.uuid = BLE_UUID16_DECLARE(CONF_TUNE_UUID),
+          .flags = BLE_GATT_CHR_F_WRITE,
+          .access_cb = confirm_autotune},
+         {.uuid = BLE_UUID16_DECLARE(READ_SYSID_UUID),
+          .flags = BLE_GATT_CHR_F_READ,
+          .access_cb = read_sysid},
+         {.uuid = BLE_UUID16_DECLARE(WRIT_SYSID_UUID),
+          .flags = BLE_GATT_CHR_F_WRITE,
+          .access_cb = start_sysid},
+         {.uuid = BLE_UUID16_DECLARE(READ_RECORD_UUID),
+          .flags = BLE_GATT_CHR_F_READ,
+          .access_cb = read_record},
+         {.uuid = BLE_UUID16_DECLARE(WRIT_RECORD_UUID),
+          .flags = BLE_GATT_CHR_F_WRITE,
+          .access_cb = start_record},
+         {.uuid = BLE_UUID16_DECLARE(NOTI_TELEM_UUID),
+          .flags = BLE_GATT_CHR_F_NOTIFY,
+          .val_handle = &telemetry_handle,
+          .access_cb = read_telemetry},
+         {.uuid = BLE_UUID16_DECLARE(READ_TELEM_UUID),
+          .flags = BLE_GATT_CHR_F_READ,
+          .access_cb = read_telemetry},
+         {.uuid = BLE_UUID16_DECLARE(WRIT_TELEM_UUID),
+          .flags = BLE_GATT_CHR_F_WRITE,
+          .access_cb = update_telemetry},
          {0}}},
     {0}};
 
@@ -210,12 +406,26 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
     /* advertise again after completion of the event */
     case BLE_GAP_EVENT_DISCONNECT:
         ESP_LOGD("ble_gap_event", "BLE GAP EVENT DISCONNECTED. Reason: %d", event->disconnect.reason);
+        if (event->disconnect.conn.conn_handle == telemetry_conn)
+        {
+            telemetry_enable(false);
+            telemetry_conn = BLE_HS_CONN_HANDLE_NONE;
+        }
         ble_app_advertise();
         break;
     case BLE_GAP_EVENT_ADV_COMPLETE:
         ESP_LOGD("ble_gap_event", "BLE GAP EVENT");
         ble_app_advertise();
         break;
+    /* the control task only fills the telemetry ring while someone listens */
+    case BLE_GAP_EVENT_SUBSCRIBE:
+        if (event->subscribe.attr_handle != telemetry_handle) { break; }
+        ESP_LOGD("ble_gap_event", "telemetry notifications %s", event->subscribe.cur_notify ? "on" : "off");
+        telemetry_conn = event->subscribe.cur_notify ? event->subscribe.conn_handle : BLE_HS_CONN_HANDLE_NONE;
+        telemetry_enable(event->subscribe.cur_notify);
+        if (event->subscribe.cur_notify) { ble_npl_callout_reset(&telemetry_callout, ble_npl_time_ms_to_ticks32(TELEMETRY_PERIOD_MS)); }
+        else                             { ble_npl_callout_stop(&telemetry_callout); }
+        break;
     case BLE_GAP_EVENT_PASSKEY_ACTION:
         ESP_LOGD("ble_gap_event", "Passkey action requested, action = %d", event->passkey.params.action);
         /* handle passkey actions (e.g. display, input) */
@@ -268,7 +478,10 @@ void ble_app_advertise(void)
 static void ble_app_on_sync(void)
 {
     ble_hs_id_infer_auto(0, &ble_addr_type); /* determines the best address type automatically, privacy mode 0 */
+    ble_npl_callout_init(&telemetry_callout, nimble_port_get_dflt_eventq(), telemetry_notify, NULL);
     ble_app_advertise();                     /* define the BLE connection */
+    boot_mark("ble advertising");
+    boot_set_ready(BOOT_BLE_READY);
 }
 
 /* the infinite task */
@@ -277,9 +490,22 @@ static void host_task(void *param)
     nimble_port_run(); /* this function will return only when nimble_port_stop() is executed */
 }
 
+static void init_nvs(void)
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        nvs_flash_erase(); /* partition layout changed, start over */
+        err = nvs_flash_init();
+    }
+    if (err != ESP_OK) { ESP_LOGE("init_nvs", "nvs_flash_init failed: %d", err); }
+}
+
 void ble_task(void)
 {
-    nvs_flash_init();                                  /* init non volatile memory*/
+    init_nvs();                                        /* init non volatile memory, shared with the imu calibration */
+    boot_mark("nvs");
+    boot_set_ready(BOOT_NVS_READY);
     nimble_port_init();                                /* init nimble stack in server mode */
     ble_svc_gap_device_name_set("Jirachi .:. gluons"); /* config server name */
     ble_config_security();
@@ -36,8 +36,24 @@
 #define WRIT_KD_UUID     0xBBB1
 #define READ_KI_UUID     0xCCCC
 #define WRIT_KI_UUID     0xCCC1
+#define READ_BOOT_UUID   0xB007
+#define READ_STATS_UUID  0xDDDD
+#define WRIT_STATS_UUID  0xDDD1
+#define WRIT_FRICTION_UUID 0xEEE1
+#define READ_TUNE_UUID   0xEEEE
+#define WRIT_TUNE_UUID   0xEEE2
+#define CONF_TUNE_UUID   0xEEE3
+#define READ_SYSID_UUID  0xEEED
+#define WRIT_SYSID_UUID  0xEEE4
+#define READ_RECORD_UUID 0xEEEC
+#define WRIT_RECORD_UUID 0xEEE5
+#define NOTI_TELEM_UUID  0xEEEA
+#define READ_TELEM_UUID  0xEEEB
+#define WRIT_TELEM_UUID  0xEEE6
 #define PKT_DELIMETER    ';'
 #define SIZEOF_RDATA     12
+#define SIZEOF_BOOT_DATA 256
+#define SIZEOF_STATS_DATA 512 /* largest attribute value, longer snapshots get cut */
 
 /*
  * @brief Initializes the needed peripherals, configures NimBLE stack,
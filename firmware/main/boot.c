@@ -0,0 +1,102 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * boot.c - boot phase instrumentation and readiness tracking. every init stage gets timestamped so
+ * the boot timeline can be reported over the log and BLE, and the init tasks running in parallel
+ * use readiness bits to wait on the stages they depend on instead of fixed sleeps
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "boot.h"
+
+static BootStage stages[BOOT_MAX_STAGES];
+static uint8_t stage_count = 0U;
+static portMUX_TYPE stage_lock = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t ready_bits = NULL;
+
+void boot_init(void)
+{
+    ready_bits = xEventGroupCreate();
+    if (ready_bits == NULL) { ESP_LOGE("boot_init", "Failed to create the readiness event group"); }
+}
+
+void boot_mark(const char *name)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&stage_lock);
+    if (stage_count < BOOT_MAX_STAGES)
+    {
+        stages[stage_count].name = name;
+        stages[stage_count].time = now;
+        stage_count++;
+    }
+    portEXIT_CRITICAL(&stage_lock);
+}
+
+void boot_set_ready(uint32_t bits)
+{
+    xEventGroupSetBits(ready_bits, (EventBits_t)bits);
+}
+
+bool boot_wait_ready(uint32_t bits, uint32_t timeout_ms)
+{
+    EventBits_t set = xEventGroupWaitBits(ready_bits, (EventBits_t)bits, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (set & bits) == bits;
+}
+
+void boot_report(void)
+{
+    int64_t previous = 0;
+
+    ESP_LOGI("boot_report", "-----------------------");
+    ESP_LOGI("boot_report", "BOOT TIMELINE");
+    for (uint8_t i = 0U; i < stage_count; i++)
+    {
+        ESP_LOGI("boot_report", "%8.1f ms (+%7.1f ms) %s", (float)stages[i].time / 1000.0F,
+                 (float)(stages[i].time - previous) / 1000.0F, stages[i].name);
+        previous = stages[i].time;
+    }
+    ESP_LOGI("boot_report", "-----------------------");
+}
+
+size_t boot_timeline_string(char *buffer, size_t size)
+{
+    size_t length = 0U;
+    if (size == 0U) { return 0U; }
+    buffer[0] = '\0';
+
+    for (uint8_t i = 0U; i < stage_count && length < size; i++)
+    {
+        int written = snprintf(&buffer[length], size - length, "%s:%lu;", stages[i].name, (unsigned long)(stages[i].time / 1000));
+        if (written < 0) { break; }
+        length += (size_t)written;
+    }
+
+    return (length < size) ? length : size - 1U;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * boot.h - boot phase instrumentation and readiness tracking. every init stage gets timestamped so
+ * the boot timeline can be reported over the log and BLE, and the init tasks running in parallel
+ * use readiness bits to wait on the stages they depend on instead of fixed sleeps
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _BOOT_H
+#define _BOOT_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BOOT_MAX_STAGES   16U
+/* readiness bits, set by whoever finishes bringing the thing up */
+#define BOOT_NVS_READY    (1U << 0U)
+#define BOOT_BLE_READY    (1U << 1U)
+#define BOOT_IMU_READY    (1U << 2U)
+
+typedef struct {
+    const char *name; /* must point to a string literal */
+    int64_t time;     /* us since reset */
+} BootStage;
+
+/* has to be called before any other boot_* function */
+void boot_init(void);
+/* timestamp the end of an init stage, safe to call from any task */
+void boot_mark(const char *name);
+void boot_set_ready(uint32_t bits);
+/* block until all the bits are set, returns false on timeout */
+bool boot_wait_ready(uint32_t bits, uint32_t timeout_ms);
+/* log the timeline to the console */
+void boot_report(void);
+/* write the timeline as "stage:ms;" pairs, returns the length written */
+size_t boot_timeline_string(char *buffer, size_t size);
+
+#endif /* _BOOT_H */
\ No newline at end of file
@@ -0,0 +1,204 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * calib.c - persistence of the imu calibration (biases, self-test ratios and the resolution they
+ * were taken at) in non volatile storage, plus the quick boot-time check that decides if the stored
+ * calibration can be reused or a full calibration is needed
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include "nvs.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+#include "calib.h"
+
+static float store_breakaway[2];             /* written by the control task before the flag goes up */
+static volatile bool store_requested = false;
+
+static uint32_t calib_crc(const IMUCalibration *calib)
+{
+    return esp_rom_crc32_le(0U, (const uint8_t *)calib, offsetof(IMUCalibration, crc));
+}
+
+static uint32_t calib_motor_crc(const MotorCalibration *calib)
+{
+    return esp_rom_crc32_le(0U, (const uint8_t *)calib, offsetof(MotorCalibration, crc));
+}
+
+esp_err_t calib_load(IMU *imu)
+{
+    IMUCalibration calib = { 0 };
+    size_t size = sizeof(calib);
+    nvs_handle_t handle;
+
+    esp_err_t err = nvs_open(CALIB_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) { ESP_LOGI("calib_load", "No stored calibration: %d", err); return err; }
+    err = nvs_get_blob(handle, CALIB_NVS_KEY, &calib, &size);
+    nvs_close(handle);
+    if (err != ESP_OK) { ESP_LOGI("calib_load", "No stored calibration: %d", err); return err; }
+
+    if (size != sizeof(calib) || calib.version != CALIB_VERSION || calib.size != sizeof(calib))
+    {
+        ESP_LOGW("calib_load", "Stored calibration has an old format (version %u)", calib.version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (calib.crc != calib_crc(&calib))
+    {
+        ESP_LOGW("calib_load", "Stored calibration is corrupted");
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (calib.accel_resolution != imu->accel_resolution || calib.gyro_resolution != imu->gyro_resolution)
+    {
+        ESP_LOGW("calib_load", "Stored calibration was taken at a different full scale");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    imu->axbias = calib.bias[0];
+    imu->aybias = calib.bias[1];
+    imu->azbias = calib.bias[2];
+    imu->gxbias = calib.bias[3];
+    imu->gybias = calib.bias[4];
+    imu->gzbias = calib.bias[5];
+    for (uint8_t i = 0U; i < 6U; i++) { imu->st_ratio[i] = calib.st_ratio[i]; }
+
+    return ESP_OK;
+}
+
+esp_err_t calib_store(const IMU *imu)
+{
+    IMUCalibration calib = { 0 }; /* zeroed so the padding that goes into the crc is deterministic */
+    nvs_handle_t handle;
+
+    calib.version = CALIB_VERSION;
+    calib.size = sizeof(calib);
+    calib.accel_resolution = imu->accel_resolution;
+    calib.gyro_resolution = imu->gyro_resolution;
+    calib.bias[0] = imu->axbias;
+    calib.bias[1] = imu->aybias;
+    calib.bias[2] = imu->azbias;
+    calib.bias[3] = imu->gxbias;
+    calib.bias[4] = imu->gybias;
+    calib.bias[5] = imu->gzbias;
+    for (uint8_t i = 0U; i < 6U; i++) { calib.st_ratio[i] = imu->st_ratio[i]; }
+    calib.crc = calib_crc(&calib);
+
+    esp_err_t err = nvs_open(CALIB_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) { ESP_LOGE("calib_store", "nvs_open failed: %d", err); return err; }
+    err = nvs_set_blob(handle, CALIB_NVS_KEY, &calib, sizeof(calib));
+    if (err == ESP_OK) { err = nvs_commit(handle); }
+    nvs_close(handle);
+    if (err != ESP_OK) { ESP_LOGE("calib_store", "Failed to store calibration: %d", err); }
+
+    return err;
+}
+
+bool calib_check(IMU *imu)
+{
+    float measured[6U] = { 0, 0, 0, 0, 0, 0 }; /* ax, ay, az, gx, gy, gz */
+    float stored[6U] = { imu->axbias, imu->aybias, imu->azbias, imu->gxbias, imu->gybias, imu->gzbias };
+    bool valid = true;
+
+    imu_measure_bias(imu, CALIB_CHECK_SAMPLES, measured);
+
+    for (uint8_t i = 0U; i < 6U; i++)
+    {
+        float limit = (i < 3U) ? CALIB_MAX_ACCEL_DRIFT : CALIB_MAX_GYRO_DRIFT;
+        float drift = fabsf(measured[i] - stored[i]);
+        if (drift > limit)
+        {
+            ESP_LOGW("calib_check", "Axis %u drifted %.3f %s from the stored calibration", i, drift, (i < 3U) ? "g" : "dps");
+            valid = false;
+        }
+    }
+
+    return valid;
+}
+
+esp_err_t calib_load_motor(Friction *friction)
+{
+    MotorCalibration calib = { 0 };
+    size_t size = sizeof(calib);
+    nvs_handle_t handle;
+
+    esp_err_t err = nvs_open(CALIB_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) { ESP_LOGI("calib_load_motor", "No stored motor calibration: %d", err); return err; }
+    err = nvs_get_blob(handle, CALIB_MOTOR_NVS_KEY, &calib, &size);
+    nvs_close(handle);
+    if (err != ESP_OK) { ESP_LOGI("calib_load_motor", "No stored motor calibration: %d", err); return err; }
+
+    if (size != sizeof(calib) || calib.version != CALIB_VERSION || calib.size != sizeof(calib))
+    {
+        ESP_LOGW("calib_load_motor", "Stored motor calibration has an old format (version %u)", calib.version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (calib.crc != calib_motor_crc(&calib))
+    {
+        ESP_LOGW("calib_load_motor", "Stored motor calibration is corrupted");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    friction_set(friction, calib.breakaway[0], calib.breakaway[1]);
+    return ESP_OK;
+}
+
+esp_err_t calib_store_motor(const Friction *friction)
+{
+    MotorCalibration calib = { 0 };
+    nvs_handle_t handle;
+
+    calib.version = CALIB_VERSION;
+    calib.size = sizeof(calib);
+    calib.breakaway[0] = friction->breakaway[0];
+    calib.breakaway[1] = friction->breakaway[1];
+    calib.crc = calib_motor_crc(&calib);
+
+    esp_err_t err = nvs_open(CALIB_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) { ESP_LOGE("calib_store_motor", "nvs_open failed: %d", err); return err; }
+    err = nvs_set_blob(handle, CALIB_MOTOR_NVS_KEY, &calib, sizeof(calib));
+    if (err == ESP_OK) { err = nvs_commit(handle); }
+    nvs_close(handle);
+    if (err != ESP_OK) { ESP_LOGE("calib_store_motor", "Failed to store motor calibration: %d", err); }
+
+    return err;
+}
+
+void calib_request_store_motor(const Friction *friction)
+{
+    store_breakaway[0] = friction->breakaway[0];
+    store_breakaway[1] = friction->breakaway[1];
+    __sync_synchronize();
+    store_requested = true;
+}
+
+void calib_poll_store_motor(void)
+{
+    if (!store_requested) { return; }
+    __sync_synchronize();
+    Friction friction = { 0 };
+    friction.breakaway[0] = store_breakaway[0];
+    friction.breakaway[1] = store_breakaway[1];
+    store_requested = false;
+    if (calib_store_motor(&friction) == ESP_OK) { ESP_LOGI("calib_store_motor", "Stored motor calibration"); }
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * calib.h - persistence of the imu calibration (biases, self-test ratios and the resolution they
+ * were taken at) in non volatile storage, plus the quick boot-time check that decides if the stored
+ * calibration can be reused or a full calibration is needed
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CALIB_H
+#define _CALIB_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "imu.h"
+#include "friction.h"
+
+#define CALIB_NVS_NAMESPACE      "jirachi"
+#define CALIB_NVS_KEY            "imu_calib"
+#define CALIB_MOTOR_NVS_KEY      "motor_calib"
+#define CALIB_VERSION            1U
+#define CALIB_CHECK_SAMPLES      48U    /* ~50 ms worth of samples at 1 kHz, one fifo drain */
+#define CALIB_MAX_GYRO_DRIFT     (0.5F) /* dps, per axis */
+#define CALIB_MAX_ACCEL_DRIFT    (0.03F) /* g, per axis */
+
+typedef struct {
+    uint16_t version;
+    uint16_t size;            /* sizeof(IMUCalibration), catches layout changes the version bump missed */
+    float accel_resolution;   /* the biases are only valid for the scales they were measured at */
+    float gyro_resolution;
+    float bias[6];            /* { ax, ay, az, gx, gy, gz } in g and dps */
+    float st_ratio[6];
+    uint32_t crc;             /* crc32 of everything above */
+} IMUCalibration;
+
+typedef struct {
+    uint16_t version;
+    uint16_t size;            /* sizeof(MotorCalibration) */
+    float breakaway[2];       /* counts of the 8-bit scale, { forward, reverse } */
+    uint32_t crc;             /* crc32 of everything above */
+} MotorCalibration;
+
+/* read the stored calibration and apply it to imu, fails if missing, corrupted or taken at other scales */
+esp_err_t calib_load(IMU *imu);
+/* store the biases and self-test ratios currently in imu */
+esp_err_t calib_store(const IMU *imu);
+/* measure a short burst of samples and check they agree with the biases currently in imu */
+bool calib_check(IMU *imu);
+/* read the stored breakaway duties into friction, which stays uncompensated if there are none */
+esp_err_t calib_load_motor(Friction *friction);
+esp_err_t calib_store_motor(const Friction *friction);
+/* control task: hand the breakaway duties over for storing, an nvs commit can erase a page and outlast a pass */
+void calib_request_store_motor(const Friction *friction);
+/* flash task: store a requested motor calibration, if there is one */
+void calib_poll_store_motor(void);
+
+#endif /* _CALIB_H */
\ No newline at end of file
@@ -0,0 +1,57 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * complementary.c - single axis complementary filter for the pitch
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include "fastmath.h"
+#include "complementary.h"
+
+#define RAD_TO_DEG    (180.0F / 3.14159265358979F)
+
+void complementary_init(Complementary *filter, float tau)
+{
+    filter->pitch = 0.0F;
+    filter->tau = tau;
+    filter->started = false;
+}
+
+void complementary_update(Complementary *filter, float gy, float ax, float ay, float az, float deltat)
+{
+    float norm = sqrtf(ax * ax + ay * ay + az * az);
+    if (norm <= 0.0F) { filter->pitch += gy * deltat * RAD_TO_DEG; return; }
+
+    /* the x component of gravity is -sin(pitch) whatever the roll is */
+    float accel_pitch = -fast_asin(ax / norm) * RAD_TO_DEG;
+    if (!filter->started)
+    {
+        filter->started = true;
+        filter->pitch = accel_pitch;
+        return;
+    }
+
+    float alpha = filter->tau / (filter->tau + deltat);
+    filter->pitch = alpha * (filter->pitch + gy * deltat * RAD_TO_DEG) + (1.0F - alpha) * accel_pitch;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * complementary.h - single axis complementary filter for the pitch, gyro rate high passed and
+ * accel angle low passed. cheapest estimator there is, ignores roll and yaw completely
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COMPLEMENTARY_H
+#define _COMPLEMENTARY_H
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    float pitch;            /* degrees, same sign and zero as madgwick_pitch */
+    float tau;              /* seconds, crossover between trusting the gyro and the accel */
+    bool started;           /* the first sample takes the accel angle as is */
+} Complementary;
+
+void complementary_init(Complementary *filter, float tau);
+/* gy needs to be in radians per second, accel in any unit, deltat in seconds. only the pitch axis is used */
+void complementary_update(Complementary *filter, float gy, float ax, float ay, float az, float deltat);
+
+#endif /* _COMPLEMENTARY_H */
\ No newline at end of file
@@ -0,0 +1,306 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * control.c - the sense -> estimate -> control -> actuate pipeline
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include "esp_log.h"
+#include "motor.h"
+#include "control.h"
+#include "stats.h"
+#include "sysid.h"
+#include "record.h"
+
+#define PI                       (3.14159265358979F)
+
+void control_init(Control *control, float beta, float sample_period, float setpoint)
+{
+    EstimatorConfig config;
+
+    estimator_default_config(&config, beta, sample_period);
+    estimator_init(&control->estimator, CONTROL_ESTIMATOR, &config);
+    madgwick_init(&control->filter, beta);
+    control->attitude_valid = true;
+    pid_init(&control->controller, 0.0F, 0.0F, 0.0F);
+#if CONTROL_LAW == CONTROL_LAW_PID_V2
+    /* the period settles on the batch length with the first step */
+    pid2_init(&control->controller_v2, -(float)CONTROL_MAX_DUTY_CYCLE, (float)CONTROL_MAX_DUTY_CYCLE, sample_period, PID2_WINDUP_BACK_CALCULATION);
+    pid2_set_derivative_filter(&control->controller_v2, CONTROL_RATE_FILTER_TF);
+#elif CONTROL_LAW == CONTROL_LAW_LQR
+    lqr_init(&control->controller_lqr, -(float)CONTROL_MAX_DUTY_CYCLE, (float)CONTROL_MAX_DUTY_CYCLE);
+#elif CONTROL_LAW == CONTROL_LAW_MPC
+    mpc_init(&control->controller_mpc, -(float)CONTROL_MAX_DUTY_CYCLE, (float)CONTROL_MAX_DUTY_CYCLE);
+#endif
+#if CONTROL_FIXED_POINT
+    madgwick_fx_init(&control->filter_fx, beta, 0.0F); /* the gyro scale comes with the first batch */
+    pid_fx_init(&control->controller_fx, 0.0F, 0.0F, 0.0F);
+#endif
+    timebase_init(&control->timebase, sample_period, TIMEBASE_TICK_US);
+    control->setpoint = setpoint;
+    control->setpoint_sin = sinf(setpoint * PI / 180.0F);
+    control->setpoint_cos = cosf(setpoint * PI / 180.0F);
+    control->error = 0.0F;
+    control->rate = 0.0F;
+    control->command = 0.0F;
+    control->deltat = 0.0F;
+    control->step = 0.0F;
+    control->applied = 0.0F;
+    control->fresh = true;
+    control->stopped = false;
+    friction_init(&control->friction);
+    control->passes = 0U;
+    control->missed_samples = 0U;
+}
+
+#if CONTROL_FIXED_POINT
+void control_estimate(Control *control, IMU *imu, const IMUSample *samples, uint16_t count)
+{
+    float deltat = 0.0F;
+    int32_t gyro_bias[3] = { 0, 0, 0 };
+    int32_t accel_bias[3] = { 0, 0, 0 };
+    int32_t rate_sum = 0;
+
+    if (control->stopped) { control->deltat = 0.0F; } /* only this pass's time counts once control comes back */
+    if (count == 0U) { return; }
+    record_samples(samples, count);
+
+    /* biases in counts once per batch, after this the samples never leave integers */
+    madgwick_fx_set_gyro_resolution(&control->filter_fx, imu->gyro_resolution);
+    gyro_bias[0] = (int32_t)roundf(imu->gxbias / imu->gyro_resolution);
+    gyro_bias[1] = (int32_t)roundf(imu->gybias / imu->gyro_resolution);
+    gyro_bias[2] = (int32_t)roundf(imu->gzbias / imu->gyro_resolution);
+    accel_bias[0] = (int32_t)roundf(imu->axbias / imu->accel_resolution);
+    accel_bias[1] = (int32_t)roundf(imu->aybias / imu->accel_resolution);
+    accel_bias[2] = (int32_t)roundf(imu->azbias / imu->accel_resolution);
+
+    for (uint16_t i = 0U; i < count; i++)
+    {
+        const IMUSample *sample = &samples[i];
+        deltat = timebase_update(&control->timebase, sample->timestamp);
+        control->deltat += deltat;
+        /* same axis remap as the float path */
+        STATS_BEGIN(update_start);
+        madgwick_fx_update(&control->filter_fx, sample->gy - gyro_bias[1], sample->gx - gyro_bias[0], -(sample->gz - gyro_bias[2]),
+                           sample->ay - accel_bias[1], sample->ax - accel_bias[0], -(sample->az - accel_bias[2]), (uint32_t)(deltat * 1e6F + 0.5F));
+        STATS_END(STATS_MADGWICK_UPDATE, update_start);
+        rate_sum += sample->gx - gyro_bias[0];
+        if (sysid_capturing())
+        {
+            madgwick_fx_to_float(&control->filter_fx, &control->filter);
+            sysid_record(sample->timestamp, control->applied, (float)(sample->gx - gyro_bias[0]) * imu->gyro_resolution,
+                         madgwick_pitch_fast(&control->filter) - control->setpoint);
+        }
+    }
+    madgwick_fx_to_float(&control->filter_fx, &control->filter);
+    control->rate = (float)rate_sum * imu->gyro_resolution / (float)count;
+}
+
+Madgwick *control_attitude(Control *control)
+{
+    return &control->filter;
+}
+#else
+void control_estimate(Control *control, IMU *imu, const IMUSample *samples, uint16_t count)
+{
+    float deltat = 0.0F;
+    float rate_sum = 0.0F;
+
+    if (control->stopped) { control->deltat = 0.0F; } /* only this pass's time counts once control comes back */
+    record_samples(samples, count);
+    /* integrate over the sensor's own clock so bus latency and preemption don't show up as jitter */
+    for (uint16_t i = 0U; i < count; i++)
+    {
+        imu_convert_sample(imu, &samples[i]);
+        deltat = timebase_update(&control->timebase, samples[i].timestamp);
+        control->deltat += deltat;
+        /* inputs flipped and fixed signs given the actual orientation of the imu on the board */
+        STATS_BEGIN(update_start);
+        estimator_update(&control->estimator, (imu->gy*PI/180.0F), (imu->gx*PI/180.0F), -(imu->gz*PI/180.0F), imu->ay, imu->ax, -imu->az, deltat);
+        STATS_END(STATS_MADGWICK_UPDATE, update_start);
+        rate_sum += imu->gx; /* the pitch axis after the remap above */
+        if (sysid_capturing())
+        {
+            sysid_record(samples[i].timestamp, control->applied, imu->gx - estimator_get_rate_bias(&control->estimator),
+                         estimator_get_pitch(&control->estimator) - control->setpoint);
+        }
+    }
+    if (count > 0U)
+    {
+        control->attitude_valid = false;
+        /* a bias left in the rate is a constant D term and moves the balance point, take out what the estimator found */
+        control->rate = rate_sum / (float)count - estimator_get_rate_bias(&control->estimator);
+    }
+}
+
+Madgwick *control_attitude(Control *control)
+{
+    if (!control->attitude_valid)
+    {
+        float q[4];
+        estimator_get_quat(&control->estimator, q);
+        madgwick_set_quaternion(&control->filter, q);
+        control->attitude_valid = true;
+    }
+    return &control->filter;
+}
+#endif
+
+void control_hold(Control *control, float deltat)
+{
+    record_hold(deltat);
+    if (control->stopped) { control->deltat = 0.0F; }
+    control->deltat += deltat;
+}
+
+bool control_compute(Control *control, float kp, float kd, float ki)
+{
+    /* only step the controller when new samples moved the sensor clock forward, tiny deltas blow up the D term */
+    if (control->deltat <= 0.0F) { return false; }
+    control->stopped = false;
+
+    /* only the pitch is needed, roll and yaw only get computed if the debug log is compiled in */
+    STATS_BEGIN(rpy_start);
+#if CONTROL_PITCH_MODE == CONTROL_PITCH_QUATERNION
+    control->error = madgwick_pitch_error(control_attitude(control), control->setpoint_sin, control->setpoint_cos);
+#elif CONTROL_PITCH_MODE == CONTROL_PITCH_FAST && !CONTROL_FIXED_POINT
+    control->error = control->setpoint - estimator_get_pitch(&control->estimator);
+#elif CONTROL_PITCH_MODE == CONTROL_PITCH_FAST
+    control->error = control->setpoint - madgwick_pitch_fast(&control->filter);
+#else
+    control->error = control->setpoint - madgwick_pitch(control_attitude(control));
+#endif
+    STATS_END(STATS_MADGWICK_RPY, rpy_start);
+    ESP_LOGD("control_compute", "R: %03.2f,\tP: %03.2f,\tY: %03.2f", madgwick_roll(control_attitude(control)), madgwick_pitch(control_attitude(control)),
+             madgwick_yaw(control_attitude(control)));
+#if CONTROL_FIXED_POINT
+    pid_fx_update_consts(&control->controller_fx, kp, kd, ki); /* update constants from the BLE service */
+    int32_t error = pid_fx_from_float(control->error);
+    if (control->fresh) { control->controller_fx.prev_err = error; } /* no derivative kick on the first pass */
+    STATS_BEGIN(pid_start);
+    int32_t command = pid_fx_compute(&control->controller_fx, error, 0, (uint32_t)(control->deltat * 1e6F + 0.5F));
+    STATS_END(STATS_PID, pid_start);
+    control->command = pid_fx_to_float(command);
+#elif CONTROL_LAW == CONTROL_LAW_LQR
+    STATS_BEGIN(pid_start);
+    control->command = lqr_step(&control->controller_lqr, control->error, control->rate, control->deltat);
+    STATS_END(STATS_PID, pid_start);
+#elif CONTROL_LAW == CONTROL_LAW_MPC
+    STATS_BEGIN(pid_start);
+    control->command = mpc_step(&control->controller_mpc, control->error, control->rate, control->deltat);
+    STATS_END(STATS_PID, pid_start);
+#elif CONTROL_LAW == CONTROL_LAW_PID_V2
+    pid2_set_gains(&control->controller_v2, kp, kd, ki); /* constants from the BLE service, without a bump */
+    STATS_BEGIN(pid_start);
+    control->command = pid2_step(&control->controller_v2, control->error, control->rate, control->deltat);
+    STATS_END(STATS_PID, pid_start);
+#else
+    pid_update_consts(&control->controller, kp, kd, ki); /* update constants from the BLE service */
+    if (control->fresh) { control->controller.prev_err = control->error; } /* no derivative kick on the first pass */
+    STATS_BEGIN(pid_start);
+    control->command = pid_compute(&control->controller, control->error, 0.0F, control->deltat);
+    STATS_END(STATS_PID, pid_start);
+#endif
+    record_compute(kp, kd, ki, control->error, control->command);
+    control->step = control->deltat;
+    control->deltat = 0.0F;
+    control->fresh = false;
+    ESP_LOGD("control_compute", "control_signal = %f", control->command);
+    control->passes++;
+    return true;
+}
+
+void control_actuate(Control *control)
+{
+    STATS_BEGIN(motor_start);
+
+    /* the controllers see a motor without a deadzone, the limit still applies to what comes out */
+    float requested = control->command;
+    float command = friction_compensate(&control->friction, control->command, control->step);
+    if (command > (float)CONTROL_MAX_DUTY_CYCLE) { command = (float)CONTROL_MAX_DUTY_CYCLE; }
+    if (command < -(float)CONTROL_MAX_DUTY_CYCLE) { command = -(float)CONTROL_MAX_DUTY_CYCLE; }
+    STATS_BEGIN(write_start);
+    set_motor_command(command); /* keeps the fraction, the motor profile may have more than 8 bits */
+    STATS_END(STATS_MOTOR_WRITE, write_start);
+    control->applied = command;
+    record_actuate(requested, command);
+    STATS_END(STATS_MOTOR, motor_start);
+    stats_saturation(control->command >= (float)CONTROL_MAX_DUTY_CYCLE || -control->command >= (float)CONTROL_MAX_DUTY_CYCLE);
+}
+
+static void restart(Control *control)
+{
+#if CONTROL_FIXED_POINT
+    control->controller_fx.integral = 0;
+#elif CONTROL_LAW == CONTROL_LAW_PID_V2
+    pid2_reset(&control->controller_v2, 0.0F);
+#elif CONTROL_LAW == CONTROL_LAW_LQR
+    lqr_reset(&control->controller_lqr); /* the wheel spins down while the motor is off */
+#elif CONTROL_LAW == CONTROL_LAW_MPC
+    mpc_reset(&control->controller_mpc);
+#else
+    control->controller.integral = 0.0F;
+#endif
+    control->command = 0.0F;
+    control->fresh = true;
+}
+
+void control_stop(Control *control)
+{
+    STATS_BEGIN(motor_start);
+    stop_motor();
+    STATS_END(STATS_MOTOR_WRITE, motor_start);
+    stats_saturation(false);
+    if (control->stopped) { return; } /* still off, nothing below changed since the last call */
+
+    record_stop();
+    restart(control); /* picks up from a stopped motor when control comes back */
+    control->applied = 0.0F;
+    control->deltat = 0.0F;
+    control->friction.wheel = 0.0F;
+    control->stopped = true;
+}
+
+void control_restart(Control *control)
+{
+    record_restart();
+    restart(control);
+}
+
+bool control_uses_gains(void)
+{
+    return CONTROL_FIXED_POINT || CONTROL_LAW == CONTROL_LAW_PID || CONTROL_LAW == CONTROL_LAW_PID_V2;
+}
+
+bool control_tracks_gyro_bias(void)
+{
+    return !CONTROL_FIXED_POINT && estimator_tracks_gyro_bias(CONTROL_ESTIMATOR);
+}
+
+void control_pass(Control *control, IMU *imu, const IMUSample *samples, uint16_t count, bool active, float kp, float kd, float ki)
+{
+    control_estimate(control, imu, samples, count);
+    if (!active) { control_stop(control); return; }
+    if (control_compute(control, kp, kd, ki)) { control_actuate(control); }
+}
\ No newline at end of file
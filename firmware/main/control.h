@@ -0,0 +1,125 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * control.h - the sense -> estimate -> control -> actuate pipeline, one pass per batch of imu samples.
+ * plain C without any rtos calls so the same code runs in the control task and on the host
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CONTROL_H
+#define _CONTROL_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "imu.h"
+#include "madgwick.h"
+#include "madgwick_fx.h"
+#include "estimator.h"
+#include "pid.h"
+#include "pid_fx.h"
+#include "pid2.h"
+#include "lqr.h"
+#include "mpc.h"
+#include "timebase.h"
+#include "friction.h"
+
+#define CONTROL_DESIRED_ANGLE    (-60.0F)
+#define CONTROL_MAX_DUTY_CYCLE   (200U) /* full power!!!! :P */
+#define CONTROL_PITCH_EXACT      0 /* asinf */
+#define CONTROL_PITCH_FAST       1 /* polynomial asin, within 0.004 degrees */
+#define CONTROL_PITCH_QUATERNION 2 /* sin of the error from the quaternion, no inverse trig, small angle */
+#ifndef CONTROL_PITCH_MODE
+#define CONTROL_PITCH_MODE       CONTROL_PITCH_FAST
+#endif
+#ifndef CONTROL_ESTIMATOR
+#define CONTROL_ESTIMATOR        ESTIMATOR_MADGWICK /* see imu_sim for what each one costs and how close it gets */
+#endif
+#define CONTROL_LAW_PID          0 /* pid.c */
+#define CONTROL_LAW_PID_V2       1 /* pid2.c: gyro D term, anti-windup, bumpless gain changes */
+#define CONTROL_LAW_LQR          2 /* lqr.c: state feedback with the gains in lqr_gains.h, ignores kp, kd and ki from BLE */
+#define CONTROL_LAW_MPC          3 /* mpc.c: explicit mpc from mpc_regions.h, plans around the duty limit, ignores BLE gains too */
+#ifndef CONTROL_LAW
+#define CONTROL_LAW              CONTROL_LAW_PID_V2
+#endif
+#define CONTROL_RATE_FILTER_TF   (0.0F) /* seconds, low pass on the gyro rate of the D term, 0 for none */
+#ifndef CONTROL_FIXED_POINT
+#define CONTROL_FIXED_POINT      0 /* 1 runs madgwick and pid_fx in fixed point whatever the estimator and control law, the c3 has no fpu */
+#endif
+
+typedef struct {
+    Estimator estimator;
+    Madgwick filter;       /* attitude of the last batch for the angle getters, use control_attitude */
+    bool attitude_valid;   /* filter holds the estimator's current quaternion */
+    PID controller;
+#if CONTROL_LAW == CONTROL_LAW_PID_V2
+    PID2 controller_v2;
+#elif CONTROL_LAW == CONTROL_LAW_LQR
+    LQR controller_lqr;
+#elif CONTROL_LAW == CONTROL_LAW_MPC
+    MPC controller_mpc;
+#endif
+    Timebase timebase;
+    Friction friction;     /* deadzone and friction compensation in control_actuate, off until calibrated */
+#if CONTROL_FIXED_POINT
+    MadgwickFx filter_fx;  /* replaces the estimator, filter gets its quaternion for the attitude */
+    PidFx controller_fx;
+#endif
+    float setpoint;        /* pitch, degrees */
+    float setpoint_sin;    /* for CONTROL_PITCH_QUATERNION, taken at init */
+    float setpoint_cos;
+    float error;           /* setpoint - pitch the controller saw last, degrees */
+    float rate;            /* pitch rate averaged over the last batch less the estimator's bias, dps */
+    float command;         /* last signed motor command, positive drives IN1 */
+    float applied;         /* what the motor got for it after friction compensation and the limit */
+    float deltat;          /* sensor time integrated since the last controller update, seconds */
+    float step;            /* sensor time the last command was computed over, seconds */
+    bool fresh;            /* the next computed pass starts the pid over, its derivative has no previous error yet */
+    bool stopped;          /* control_stop ran and nothing was computed since, the estimate keeps no time for it */
+    uint32_t passes;       /* passes that produced a motor command */
+    uint32_t missed_samples; /* samples that showed up late or were dropped by the imu, kept by the caller */
+} Control;
+
+void control_init(Control *control, float beta, float sample_period, float setpoint);
+/* sense + estimate: convert every sample of the batch and feed it to the filter on the sensor's own clock */
+void control_estimate(Control *control, IMU *imu, const IMUSample *samples, uint16_t count);
+/* the estimator's quaternion, only copied over when something asks for more than the pitch */
+Madgwick *control_attitude(Control *control);
+/* no samples this pass: let the controller see the time go by on the estimate it already has */
+void control_hold(Control *control, float deltat);
+/* control: attitude + one controller update over the sensor time estimated since the last one */
+/* returns false and leaves the command alone if no time went by since the last update */
+bool control_compute(Control *control, float kp, float kd, float ki);
+/* actuate: send the last command to the motor */
+void control_actuate(Control *control);
+/* motor off and forget the time accumulated for the controller. every idle pass may call it, only the first */
+/* one after a computed pass gets recorded */
+void control_stop(Control *control);
+/* the controller starts over from a 0 command, e.g. after something else drove the motor */
+void control_restart(Control *control);
+/* true if the controller built in takes kp, kd and ki, the lqr and the mpc have their gains compiled in */
+bool control_uses_gains(void);
+/* true if the estimator built in keeps estimating the gyro bias, so boot can skip measuring it */
+bool control_tracks_gyro_bias(void);
+/* one full pass, stops the motor if control is not active */
+void control_pass(Control *control, IMU *imu, const IMUSample *samples, uint16_t count, bool active, float kp, float kd, float ki);
+
+#endif /* _CONTROL_H */
\ No newline at end of file
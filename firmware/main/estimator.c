@@ -0,0 +1,199 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * estimator.c - backends of the attitude estimator interface
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include "fastmath.h"
+#include "estimator.h"
+
+#define RAD_TO_DEG                   (180.0F / 3.14159265358979F)
+#define MAHONY_DEFAULT_KP            (1.0F)
+#define MAHONY_DEFAULT_KI            (0.0F)  /* the imu bias is calibrated at boot already */
+#define COMPLEMENTARY_DEFAULT_TAU    (0.5F)
+#define KALMAN_DEFAULT_Q_ANGLE       (0.001F)
+#define KALMAN_DEFAULT_Q_BIAS        (0.003F)
+#define KALMAN_DEFAULT_R             (0.03F)
+
+static float quat_pitch(float q1, float q2, float q3, float q4)
+{
+    return -fast_asin(2.0F * (q2 * q4 - q1 * q3)) * RAD_TO_DEG;
+}
+
+/* rotation about the pitch axis alone, quat_pitch gives the same angle back */
+static void pitch_quat(float pitch, float q[4])
+{
+    float half = 0.5F * pitch / RAD_TO_DEG;
+    q[0] = cosf(half);
+    q[1] = 0.0F;
+    q[2] = sinf(half);
+    q[3] = 0.0F;
+}
+
+/* for the backends that leave the bias to the boot calibration */
+static float no_rate_bias(Estimator *estimator)
+{
+    return 0.0F;
+}
+
+/* madgwick */
+static void madgwick_backend_init(Estimator *estimator, const EstimatorConfig *config)
+{
+    madgwick_init(&estimator->state.madgwick, config->beta);
+}
+
+static void madgwick_backend_update(Estimator *estimator, float gx, float gy, float gz, float ax, float ay, float az, float deltat)
+{
+    madgwick_update(&estimator->state.madgwick, gx, gy, gz, ax, ay, az, deltat);
+}
+
+static float madgwick_backend_pitch(Estimator *estimator)
+{
+    return madgwick_pitch_fast(&estimator->state.madgwick);
+}
+
+static void madgwick_backend_quat(Estimator *estimator, float q[4])
+{
+    const Madgwick *filter = &estimator->state.madgwick;
+    q[0] = filter->q1;
+    q[1] = filter->q2;
+    q[2] = filter->q3;
+    q[3] = filter->q4;
+}
+
+/* mahony */
+static void mahony_backend_init(Estimator *estimator, const EstimatorConfig *config)
+{
+    mahony_init(&estimator->state.mahony, config->mahony_kp, config->mahony_ki);
+}
+
+static void mahony_backend_update(Estimator *estimator, float gx, float gy, float gz, float ax, float ay, float az, float deltat)
+{
+    mahony_update(&estimator->state.mahony, gx, gy, gz, ax, ay, az, deltat);
+}
+
+static float mahony_backend_pitch(Estimator *estimator)
+{
+    const Mahony *filter = &estimator->state.mahony;
+    return quat_pitch(filter->q1, filter->q2, filter->q3, filter->q4);
+}
+
+static void mahony_backend_quat(Estimator *estimator, float q[4])
+{
+    const Mahony *filter = &estimator->state.mahony;
+    q[0] = filter->q1;
+    q[1] = filter->q2;
+    q[2] = filter->q3;
+    q[3] = filter->q4;
+}
+
+/* complementary */
+static void complementary_backend_init(Estimator *estimator, const EstimatorConfig *config)
+{
+    complementary_init(&estimator->state.complementary, config->complementary_tau);
+}
+
+static void complementary_backend_update(Estimator *estimator, float gx, float gy, float gz, float ax, float ay, float az, float deltat)
+{
+    complementary_update(&estimator->state.complementary, gy, ax, ay, az, deltat);
+}
+
+static float complementary_backend_pitch(Estimator *estimator)
+{
+    return estimator->state.complementary.pitch;
+}
+
+static void complementary_backend_quat(Estimator *estimator, float q[4])
+{
+    pitch_quat(estimator->state.complementary.pitch, q);
+}
+
+/* kalman */
+static void kalman_backend_init(Estimator *estimator, const EstimatorConfig *config)
+{
+    kalman_init(&estimator->state.kalman, config->kalman_q_angle, config->kalman_q_bias, config->kalman_r, config->kalman_steady_state,
+                config->sample_period);
+}
+
+static void kalman_backend_update(Estimator *estimator, float gx, float gy, float gz, float ax, float ay, float az, float deltat)
+{
+    float norm = sqrtf(ax * ax + ay * ay + az * az);
+
+    kalman_predict(&estimator->state.kalman, gy * RAD_TO_DEG, deltat);
+    /* the x component of gravity is -sin(pitch) whatever the roll is */
+    if (norm > 0.0F) { kalman_correct(&estimator->state.kalman, -fast_asin(ax / norm) * RAD_TO_DEG); }
+}
+
+static float kalman_backend_pitch(Estimator *estimator)
+{
+    return estimator->state.kalman.x[0];
+}
+
+static void kalman_backend_quat(Estimator *estimator, float q[4])
+{
+    pitch_quat(estimator->state.kalman.x[0], q);
+}
+
+static float kalman_backend_rate_bias(Estimator *estimator)
+{
+    return estimator->state.kalman.x[1];
+}
+
+static const EstimatorOps backends[ESTIMATOR_COUNT] = {
+    [ESTIMATOR_MADGWICK] = { "madgwick", madgwick_backend_init, madgwick_backend_update, madgwick_backend_pitch, madgwick_backend_quat, no_rate_bias },
+    [ESTIMATOR_MAHONY] = { "mahony", mahony_backend_init, mahony_backend_update, mahony_backend_pitch, mahony_backend_quat, no_rate_bias },
+    [ESTIMATOR_COMPLEMENTARY] = { "complementary", complementary_backend_init, complementary_backend_update, complementary_backend_pitch, complementary_backend_quat, no_rate_bias },
+    [ESTIMATOR_KALMAN] = { "kalman", kalman_backend_init, kalman_backend_update, kalman_backend_pitch, kalman_backend_quat, kalman_backend_rate_bias },
+};
+
+void estimator_default_config(EstimatorConfig *config, float beta, float sample_period)
+{
+    config->sample_period = sample_period;
+    config->beta = beta;
+    config->mahony_kp = MAHONY_DEFAULT_KP;
+    config->mahony_ki = MAHONY_DEFAULT_KI;
+    config->complementary_tau = COMPLEMENTARY_DEFAULT_TAU;
+    config->kalman_q_angle = KALMAN_DEFAULT_Q_ANGLE;
+    config->kalman_q_bias = KALMAN_DEFAULT_Q_BIAS;
+    config->kalman_r = KALMAN_DEFAULT_R;
+    config->kalman_steady_state = true;
+}
+
+void estimator_init(Estimator *estimator, EstimatorKind kind, const EstimatorConfig *config)
+{
+    if (kind >= ESTIMATOR_COUNT) { kind = ESTIMATOR_MADGWICK; }
+    estimator->ops = &backends[kind];
+    estimator->ops->init(estimator, config);
+}
+
+const char *estimator_name(EstimatorKind kind)
+{
+    return (kind < ESTIMATOR_COUNT) ? backends[kind].name : "unknown";
+}
+
+bool estimator_tracks_gyro_bias(EstimatorKind kind)
+{
+    return kind == ESTIMATOR_KALMAN;
+}
\ No newline at end of file
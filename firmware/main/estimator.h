@@ -0,0 +1,96 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * estimator.h - common interface over the attitude estimators so one can be picked per deployment
+ * without touching the control loop. madgwick, mahony and a single axis complementary filter
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _ESTIMATOR_H
+#define _ESTIMATOR_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "madgwick.h"
+#include "mahony.h"
+#include "complementary.h"
+#include "kalman.h"
+
+typedef enum {
+    ESTIMATOR_MADGWICK = 0,
+    ESTIMATOR_MAHONY,
+    ESTIMATOR_COMPLEMENTARY,
+    ESTIMATOR_KALMAN,
+    ESTIMATOR_COUNT
+} EstimatorKind;
+
+typedef struct {
+    float sample_period;    /* seconds */
+    float beta;             /* madgwick */
+    float mahony_kp;
+    float mahony_ki;
+    float complementary_tau;
+    float kalman_q_angle;
+    float kalman_q_bias;
+    float kalman_r;
+    bool kalman_steady_state;
+} EstimatorConfig;
+
+typedef struct Estimator Estimator;
+
+typedef struct {
+    const char *name;
+    void (*init)(Estimator *estimator, const EstimatorConfig *config);
+    void (*update)(Estimator *estimator, float gx, float gy, float gz, float ax, float ay, float az, float deltat);
+    float (*get_pitch)(Estimator *estimator);
+    void (*get_quat)(Estimator *estimator, float q[4]);
+    float (*get_rate_bias)(Estimator *estimator);
+} EstimatorOps;
+
+struct Estimator {
+    const EstimatorOps *ops;
+    union {
+        Madgwick madgwick;
+        Mahony mahony;
+        Complementary complementary;
+        Kalman kalman;
+    } state;
+};
+
+void estimator_default_config(EstimatorConfig *config, float beta, float sample_period);
+void estimator_init(Estimator *estimator, EstimatorKind kind, const EstimatorConfig *config);
+/* same frame and units as madgwick_update */
+static inline void estimator_update(Estimator *estimator, float gx, float gy, float gz, float ax, float ay, float az, float deltat)
+{
+    estimator->ops->update(estimator, gx, gy, gz, ax, ay, az, deltat);
+}
+/* degrees, same convention as madgwick_pitch */
+static inline float estimator_get_pitch(Estimator *estimator) { return estimator->ops->get_pitch(estimator); }
+/* q1..q4, the complementary filter reports the pitch alone with no roll or yaw */
+static inline void estimator_get_quat(Estimator *estimator, float q[4]) { estimator->ops->get_quat(estimator, q); }
+/* dps, the gyro bias about the pitch axis the backend has estimated, 0 for the ones that don't track it */
+static inline float estimator_get_rate_bias(Estimator *estimator) { return estimator->ops->get_rate_bias(estimator); }
+const char *estimator_name(EstimatorKind kind);
+/* the backend keeps estimating the gyro bias itself, so the boot calibration can skip holding still for it */
+bool estimator_tracks_gyro_bias(EstimatorKind kind);
+
+#endif /* _ESTIMATOR_H */
\ No newline at end of file
@@ -0,0 +1,195 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * executive.c - timing supervisor of the control pipeline
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include "esp_log.h"
+#include "hal.h"
+#include "motor.h"
+#include "executive.h"
+
+/* runs from the esp_timer task (or the host clock) while the control task is stuck somewhere, */
+/* the motor gets cut right away and the control task finds out once it comes back */
+static void hang_alarm(void *arg)
+{
+    Executive *exec = (Executive *)arg;
+    exec->hung = true;
+    stop_motor();
+}
+
+static ExecAction fail(Executive *exec, ExecFault fault)
+{
+    if (exec->fault == EXEC_FAULT_NONE)
+    {
+        exec->fault = fault;
+        exec->stops++;
+        stop_motor();
+        ESP_LOGE("executive", "Fail-safe: %s, motor off until control is toggled", exec_fault_name(fault));
+    }
+    return EXEC_STOP;
+}
+
+/* one more miss, escalate to fail-safe once there were too many in a row */
+static ExecAction miss(Executive *exec, ExecFault fault)
+{
+    exec->deadline_misses++;
+    if (exec->consecutive_misses < UINT8_MAX) { exec->consecutive_misses++; }
+    if (exec->config.policy == EXEC_POLICY_FAIL_SAFE || exec->consecutive_misses > EXEC_MAX_MISSES) { return fail(exec, fault); }
+    return EXEC_SKIP;
+}
+
+void exec_default_config(ExecConfig *config, int64_t period_us)
+{
+    config->period_us = period_us;
+    config->budget_us[EXEC_STAGE_SENSE] = period_us / 2;     /* ~2.3 ms of bus time for a 5 packet batch at 400 kHz */
+    config->budget_us[EXEC_STAGE_ESTIMATE] = period_us / 5;  /* soft float filter updates */
+    config->budget_us[EXEC_STAGE_CONTROL] = period_us / 10;
+    config->budget_us[EXEC_STAGE_ACTUATE] = period_us / 20;
+    config->policy = EXEC_POLICY_DEGRADE;
+    config->fall_limit = EXEC_FALL_LIMIT;
+}
+
+void exec_init(Executive *exec, const ExecConfig *config)
+{
+    exec->config = *config;
+    exec->fault = EXEC_FAULT_NONE;
+    exec->hung = false;
+    exec->pass_start = 0;
+    exec->stage_start = 0;
+    for (uint8_t i = 0U; i < EXEC_STAGE_COUNT; i++)
+    {
+        exec->stage_worst[i] = 0;
+        exec->overruns[i] = 0U;
+    }
+    exec->passes = 0U;
+    exec->deadline_misses = 0U;
+    exec->skipped = 0U;
+    exec->held = 0U;
+    exec->stops = 0U;
+    exec->consecutive_misses = 0U;
+    exec->consecutive_held = 0U;
+    exec->late = false;
+    hal_alarm_init(hang_alarm, exec);
+}
+
+void exec_pass_begin(Executive *exec)
+{
+    exec->pass_start = hal_clock_now_us();
+    exec->stage_start = exec->pass_start;
+    hal_alarm_arm((uint32_t)(exec->config.period_us * EXEC_HANG_PERIODS));
+}
+
+void exec_stage_begin(Executive *exec)
+{
+    exec->stage_start = hal_clock_now_us();
+}
+
+void exec_stage_end(Executive *exec, ExecStage stage)
+{
+    int64_t elapsed = hal_clock_now_us() - exec->stage_start;
+
+    if (elapsed > exec->stage_worst[stage]) { exec->stage_worst[stage] = elapsed; }
+    if (elapsed > exec->config.budget_us[stage]) { exec->overruns[stage]++; }
+}
+
+ExecAction exec_after_sense(Executive *exec, uint16_t samples, uint16_t expected, float sample_period)
+{
+    if (exec->hung) { return fail(exec, EXEC_FAULT_HANG); }
+    if (exec->fault != EXEC_FAULT_NONE) { return EXEC_STOP; }
+
+    if (samples == 0U)
+    {
+        /* stall: nothing to estimate with. degrade keeps the robot up on the last estimate for a while */
+        if (exec->config.policy == EXEC_POLICY_DEGRADE)
+        {
+            exec->deadline_misses++;
+            if (++exec->consecutive_held > EXEC_MAX_HELD) { return fail(exec, EXEC_FAULT_IMU_STALL); }
+            exec->held++;
+            return EXEC_HOLD;
+        }
+        if (miss(exec, EXEC_FAULT_IMU_STALL) == EXEC_STOP) { return EXEC_STOP; }
+        exec->skipped++;
+        return EXEC_SKIP;
+    }
+    exec->consecutive_held = 0U;
+
+    /* every sample beyond the watermark is one sample period the pass started after its release */
+    int64_t lateness = (samples > expected) ? (int64_t)((float)(samples - expected) * sample_period * 1e6F) : 0;
+    if (exec->late || lateness >= exec->config.period_us)
+    {
+        exec->late = false;
+        ExecAction action = miss(exec, EXEC_FAULT_DEADLINE);
+        if (action == EXEC_STOP) { return action; }
+        if (exec->config.policy == EXEC_POLICY_SKIP) { exec->skipped++; return EXEC_SKIP; }
+        return EXEC_RUN; /* degrade: late data is still the newest data */
+    }
+
+    exec->consecutive_misses = 0U;
+    return EXEC_RUN;
+}
+
+ExecAction exec_check_fall(Executive *exec, float error)
+{
+    if (exec->config.fall_limit > 0.0F && fabsf(error) > exec->config.fall_limit) { return fail(exec, EXEC_FAULT_FALL); }
+    return (exec->fault != EXEC_FAULT_NONE) ? EXEC_STOP : EXEC_RUN;
+}
+
+void exec_pass_end(Executive *exec)
+{
+    hal_alarm_cancel();
+    /* the next pass finds out this one ran past the deadline */
+    if (hal_clock_now_us() - exec->pass_start > exec->config.period_us) { exec->late = true; }
+    exec->passes++;
+}
+
+bool exec_failed(const Executive *exec)
+{
+    return exec->fault != EXEC_FAULT_NONE;
+}
+
+void exec_rearm(Executive *exec)
+{
+    if (exec->fault == EXEC_FAULT_NONE) { return; }
+    ESP_LOGI("executive", "Rearmed after %s", exec_fault_name(exec->fault));
+    exec->fault = EXEC_FAULT_NONE;
+    exec->hung = false;
+    exec->late = false;
+    exec->consecutive_misses = 0U;
+    exec->consecutive_held = 0U;
+}
+
+const char *exec_fault_name(ExecFault fault)
+{
+    switch(fault)
+    {
+        case EXEC_FAULT_NONE:      return "none";
+        case EXEC_FAULT_DEADLINE:  return "deadline misses";
+        case EXEC_FAULT_IMU_STALL: return "imu stall";
+        case EXEC_FAULT_FALL:      return "fall";
+        case EXEC_FAULT_HANG:      return "hung pass";
+        default:                   return "unknown";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * executive.h - timing supervisor of the control pipeline. per-stage budgets and overrun counters, a
+ * deadline per pass with a skip / degrade / fail-safe miss policy, fall detection and a hang alarm that
+ * cuts the motor from outside the control task if a pass never finishes
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _EXECUTIVE_H
+#define _EXECUTIVE_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EXEC_MAX_MISSES          5U      /* consecutive deadline misses tolerated by skip and degrade before fail-safe */
+#define EXEC_MAX_HELD            10U     /* passes the degrade policy may run on a held estimate */
+#define EXEC_HANG_PERIODS        4U      /* a pass still running after this many periods trips the hang alarm */
+#define EXEC_FALL_LIMIT          (45.0F) /* degrees away from the setpoint that count as fallen over */
+
+typedef enum {
+    EXEC_STAGE_SENSE = 0,    /* fifo status, count and burst read */
+    EXEC_STAGE_ESTIMATE,     /* timebase + filter over the batch */
+    EXEC_STAGE_CONTROL,      /* attitude extraction + controller */
+    EXEC_STAGE_ACTUATE,      /* motor command */
+    EXEC_STAGE_COUNT
+} ExecStage;
+
+typedef enum {
+    EXEC_POLICY_SKIP = 0,    /* a late pass estimates but doesn't control, the previous command stays one more period */
+    EXEC_POLICY_DEGRADE,     /* keep controlling, on the last estimate if no samples came in */
+    EXEC_POLICY_FAIL_SAFE    /* motor off on the first miss */
+} ExecPolicy;
+
+typedef enum {
+    EXEC_FAULT_NONE = 0,
+    EXEC_FAULT_DEADLINE,     /* too many consecutive deadline misses */
+    EXEC_FAULT_IMU_STALL,    /* no samples for too long */
+    EXEC_FAULT_FALL,         /* pitch too far from the setpoint */
+    EXEC_FAULT_HANG          /* a pass never finished, motor cut by the alarm */
+} ExecFault;
+
+typedef enum {
+    EXEC_RUN = 0,            /* normal pass */
+    EXEC_HOLD,               /* no new samples, control on the held estimate */
+    EXEC_SKIP,               /* no control and no actuation this pass */
+    EXEC_STOP                /* fail-safe, motor off until rearmed */
+} ExecAction;
+
+typedef struct {
+    int64_t period_us;                      /* one pass per period, the deadline is the end of it */
+    int64_t budget_us[EXEC_STAGE_COUNT];
+    ExecPolicy policy;
+    float fall_limit;                       /* degrees, 0 disables fall detection */
+} ExecConfig;
+
+typedef struct {
+    ExecConfig config;
+    ExecFault fault;                        /* EXEC_FAULT_NONE unless in fail-safe */
+    volatile bool hung;                     /* set by the hang alarm */
+    int64_t pass_start;
+    int64_t stage_start;
+    int64_t stage_worst[EXEC_STAGE_COUNT];
+    uint32_t overruns[EXEC_STAGE_COUNT];    /* stage took longer than its budget */
+    uint32_t passes;
+    uint32_t deadline_misses;
+    uint32_t skipped;                       /* passes dropped by the skip policy */
+    uint32_t held;                          /* passes run on a held estimate */
+    uint32_t stops;                         /* times the fail-safe was entered */
+    uint8_t consecutive_misses;
+    uint8_t consecutive_held;
+    bool late;                              /* the last pass ran past its deadline */
+} Executive;
+
+/* 200 Hz, degrade policy and budgets that leave some headroom for ble on the single core */
+void exec_default_config(ExecConfig *config, int64_t period_us);
+/* also takes the hal alarm for the hang detection */
+void exec_init(Executive *exec, const ExecConfig *config);
+void exec_pass_begin(Executive *exec);
+void exec_stage_begin(Executive *exec);
+void exec_stage_end(Executive *exec, ExecStage stage);
+/* after sensing: samples is what came out of the fifo (0 on a notification timeout), expected is the watermark */
+ExecAction exec_after_sense(Executive *exec, uint16_t samples, uint16_t expected, float sample_period);
+/* after estimating: error is setpoint - pitch, only checked while control is active */
+ExecAction exec_check_fall(Executive *exec, float error);
+void exec_pass_end(Executive *exec);
+bool exec_failed(const Executive *exec);
+/* leave fail-safe, counters are kept */
+void exec_rearm(Executive *exec);
+const char *exec_fault_name(ExecFault fault);
+
+#endif /* _EXECUTIVE_H */
\ No newline at end of file
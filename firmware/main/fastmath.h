@@ -0,0 +1,44 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * fastmath.h - cheap approximations of libm functions for the hot path, soft float makes the real ones
+ * expensive on the c3
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _FASTMATH_H
+#define _FASTMATH_H
+#include <math.h>
+
+#define FASTMATH_HALF_PI    (1.57079632679490F)
+
+/* asin in radians after abramowitz & stegun 4.4.45, |error| <= 6.8e-5 rad over [-1, 1] */
+static inline float fast_asin(float x)
+{
+    float a = (x < 0.0F) ? -x : x;
+    if (a > 1.0F) { a = 1.0F; } /* rounding can push the argument just past 1 */
+    float r = FASTMATH_HALF_PI - sqrtf(1.0F - a) * (1.5707288F + a * (-0.2121144F + a * (0.0742610F - a * 0.0187293F)));
+    return (x < 0.0F) ? -r : r;
+}
+
+#endif /* _FASTMATH_H */
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * friction.c - motor deadzone and friction calibration and compensation
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include "esp_log.h"
+#include "friction.h"
+
+void friction_init(Friction *friction)
+{
+    friction->breakaway[0] = 0.0F;
+    friction->breakaway[1] = 0.0F;
+    friction->valid = false;
+    friction->wheel = 0.0F;
+}
+
+void friction_set(Friction *friction, float forward, float reverse)
+{
+    friction->breakaway[0] = forward;
+    friction->breakaway[1] = reverse;
+    friction->valid = true;
+}
+
+float friction_compensate(Friction *friction, float command, float deltat)
+{
+    if (!friction->valid) { return command; }
+
+    /* with the friction cancelled the wheel follows the command through its back emf lag, so that's the speed */
+    friction->wheel += (command - friction->wheel) * deltat / (FRICTION_WHEEL_TAU + deltat);
+
+    if (fabsf(friction->wheel) > FRICTION_MOVING)
+    {
+        float direction = (friction->wheel > 0.0F) ? 1.0F : -1.0F;
+        return command + direction * FRICTION_KINETIC_RATIO * friction->breakaway[(friction->wheel > 0.0F) ? 0 : 1];
+    }
+    /* standing still: jump over the deadzone, faded in so tiny commands around 0 don't chatter the motor */
+    float magnitude = fabsf(command);
+    float fade = (magnitude < FRICTION_SMOOTH_BAND) ? magnitude / FRICTION_SMOOTH_BAND : 1.0F;
+    float breakaway = friction->breakaway[(command >= 0.0F) ? 0 : 1];
+    return command + ((command >= 0.0F) ? fade : -fade) * breakaway;
+}
+
+static void settle(FrictionCal *cal)
+{
+    cal->phase = FRICTION_CAL_SETTLE;
+    cal->passes = 0U;
+    cal->rate_sum = 0.0F;
+    cal->rate_min = INFINITY;
+    cal->rate_max = -INFINITY;
+}
+
+void friction_cal_start(FrictionCal *cal)
+{
+    cal->direction = 0U;
+    cal->breakaway[0] = 0.0F;
+    cal->breakaway[1] = 0.0F;
+    settle(cal);
+}
+
+bool friction_cal_running(const FrictionCal *cal)
+{
+    return cal->phase == FRICTION_CAL_SETTLE || cal->phase == FRICTION_CAL_RAMP || cal->phase == FRICTION_CAL_SPINDOWN;
+}
+
+void friction_cal_abort(FrictionCal *cal)
+{
+    if (friction_cal_running(cal)) { cal->phase = FRICTION_CAL_FAILED; }
+}
+
+float friction_cal_step(FrictionCal *cal, float rate)
+{
+    cal->passes++;
+    switch (cal->phase)
+    {
+        case FRICTION_CAL_SETTLE:
+            cal->rate_sum += rate;
+            if (rate < cal->rate_min) { cal->rate_min = rate; }
+            if (rate > cal->rate_max) { cal->rate_max = rate; }
+            if (cal->passes >= FRICTION_SETTLE_PASSES)
+            {
+                cal->baseline = cal->rate_sum / (float)cal->passes;
+                cal->threshold = fmaxf(FRICTION_RATE_THRESHOLD, FRICTION_NOISE_FACTOR * 0.5F * (cal->rate_max - cal->rate_min));
+                cal->phase = FRICTION_CAL_RAMP;
+                cal->passes = 0U;
+                cal->duty = 0.0F;
+                cal->detected = 0U;
+            }
+            return 0.0F;
+
+        case FRICTION_CAL_RAMP:
+            if (fabsf(rate - cal->baseline) > cal->threshold) { cal->detected++; }
+            else                                              { cal->detected = 0U; }
+            if (cal->detected >= FRICTION_DETECT_PASSES)
+            {
+                /* the wheel let go when the rate first crossed, not when it was confirmed */
+                cal->breakaway[cal->direction] = cal->duty - FRICTION_RAMP_STEP * (float)(FRICTION_DETECT_PASSES - 1U);
+                ESP_LOGI("friction_cal", "Breakaway %s at %.2f counts", (cal->direction == 0U) ? "forward" : "reverse", cal->breakaway[cal->direction]);
+                cal->phase = FRICTION_CAL_SPINDOWN;
+                cal->passes = 0U;
+                return 0.0F;
+            }
+            cal->duty += FRICTION_RAMP_STEP;
+            if (cal->duty > FRICTION_RAMP_MAX)
+            {
+                ESP_LOGW("friction_cal", "The wheel never moved, is the robot free to turn?");
+                cal->phase = FRICTION_CAL_FAILED;
+                return 0.0F;
+            }
+            return (cal->direction == 0U) ? cal->duty : -cal->duty;
+
+        case FRICTION_CAL_SPINDOWN:
+            if (cal->passes >= FRICTION_SPINDOWN_PASSES)
+            {
+                if (cal->direction == 0U) { cal->direction = 1U; settle(cal); }
+                else                      { cal->phase = FRICTION_CAL_DONE; }
+            }
+            return 0.0F;
+
+        default:
+            return 0.0F;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * friction.h - motor deadzone and friction: finds the breakaway duty of the flywheel in each direction from the
+ * gyro and compensates for it in the actuation stage
+ *  
+ * for the calibration lay the robot down so it can turn freely about the wheel axis (on its side on a smooth
+ * table works), the only thing the gyro sees is the reaction of the wheel speeding up
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _FRICTION_H
+#define _FRICTION_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRICTION_SETTLE_PASSES     200U    /* 1 s at 200 Hz with the motor off to learn the resting rate */
+#define FRICTION_SPINDOWN_PASSES   600U    /* 3 s for the wheel to stop before the other direction */
+#define FRICTION_RAMP_STEP         (0.25F) /* counts per pass, 50 counts/s at 200 Hz */
+#define FRICTION_RAMP_MAX          (128.0F) /* give up past half scale, the wheel should have moved long before */
+#define FRICTION_RATE_THRESHOLD    (2.0F)  /* dps off the resting rate, at least */
+#define FRICTION_NOISE_FACTOR      (4.0F)  /* times the resting noise, if that is larger */
+#define FRICTION_DETECT_PASSES     3U      /* in a row over the threshold */
+#define FRICTION_KINETIC_RATIO     (0.8F)  /* coulomb over breakaway, not measured: the gyro only sees the wheel accelerate */
+#define FRICTION_SMOOTH_BAND       (2.0F)  /* counts, the deadzone inverse fades in below this so 0 stays 0 */
+#define FRICTION_WHEEL_TAU         (1.0F)  /* seconds, roughly the back emf time constant of the wheel */
+#define FRICTION_MOVING            (0.5F)  /* counts of lagged command above which the wheel counts as turning */
+
+typedef enum {
+    FRICTION_CAL_IDLE = 0,
+    FRICTION_CAL_SETTLE,
+    FRICTION_CAL_RAMP,
+    FRICTION_CAL_SPINDOWN,
+    FRICTION_CAL_DONE,
+    FRICTION_CAL_FAILED,
+} FrictionCalPhase;
+
+typedef struct {
+    float breakaway[2];     /* counts of the 8-bit scale to get the wheel going, [0] for positive commands */
+    bool valid;
+    float wheel;            /* command through a lag of FRICTION_WHEEL_TAU, stands in for the wheel speed */
+} Friction;
+
+typedef struct {
+    FrictionCalPhase phase;
+    uint8_t direction;      /* 0 ramps positive commands, 1 negative */
+    uint32_t passes;        /* in the current phase */
+    float rate_sum;
+    float rate_min;
+    float rate_max;
+    float baseline;         /* resting rate, dps */
+    float threshold;
+    float duty;
+    uint8_t detected;       /* passes in a row over the threshold */
+    float breakaway[2];
+} FrictionCal;
+
+/* no compensation until friction_set or a stored calibration */
+void friction_init(Friction *friction);
+void friction_set(Friction *friction, float forward, float reverse);
+/* deadzone inverse while the wheel stands still, coulomb feedforward in the direction it turns once it moves */
+float friction_compensate(Friction *friction, float command, float deltat);
+
+void friction_cal_start(FrictionCal *cal);
+bool friction_cal_running(const FrictionCal *cal);
+/* one control pass: rate is the pitch rate in dps, returns the command to send. check phase for DONE or FAILED */
+float friction_cal_step(FrictionCal *cal, float rate);
+void friction_cal_abort(FrictionCal *cal);
+
+#endif /* _FRICTION_H */
\ No newline at end of file
@@ -34,5 +34,6 @@ extern volatile float pid_kp;
 extern volatile float pid_kd;
 extern volatile float pid_ki;
 extern volatile bool control_active;
+extern volatile bool friction_calibrate; /* set over ble, the control task runs the calibration while control is off */
 
 #endif /* _GLOBALS_H */
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * hal.h - thin hardware abstraction layer between the drivers (imu, motor, rgb) and the platform.
+ * bus, gpio interrupt, pwm and clock interfaces. hal_esp.c implements it on top of ESP-IDF for the
+ * device, the host backend under host/ implements it on linux against a simulated imu
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _HAL_H
+#define _HAL_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HAL_BUS_MAX_DEVICES   2U
+#define HAL_PWM_MAX_CHANNELS  2U
+#define HAL_BUS_QUEUE_DEPTH   4U  /* transfers the bus can queue without blocking */
+
+/* code that has to keep running from an isr or with the flash cache off */
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#define HAL_IRAM_ATTR         IRAM_ATTR
+#else
+#define HAL_IRAM_ATTR
+#endif
+
+typedef struct HalBusDevice HalBusDevice; /* defined by each backend */
+typedef void (*HalIsr)(void *arg);
+typedef void (*HalAlarmCallback)(void *arg);
+
+/* bus: i2c master with one transfer in flight per device */
+bool hal_bus_init(uint8_t port, uint8_t sda_pin, uint8_t scl_pin);
+HalBusDevice *hal_bus_add_device(uint16_t address, uint32_t speed_hz);
+/* queue a write followed by a repeated start read (skipped if read_length is 0) and return right away */
+/* both buffers have to stay valid until the transfer is over, which can be after a hal_bus_wait that timed out */
+bool hal_bus_start(HalBusDevice *device, const uint8_t *write, size_t write_length, uint8_t *read, size_t read_length);
+/* block until the transfer queued on device is done, false on timeout or bus error. a timeout resets the bus */
+bool hal_bus_wait(HalBusDevice *device, uint32_t timeout_ms);
+
+/* gpio: input pin with pull-down that calls isr on every rising edge */
+bool hal_gpio_irq_init(uint8_t pin, HalIsr isr, void *arg);
+
+/* pwm: channels share one timer, so the last frequency/resolution set applies to all of them */
+bool hal_pwm_init(uint8_t channel, uint8_t pin, uint32_t frequency, uint8_t resolution_bits);
+bool hal_pwm_set(uint8_t channel, uint32_t duty);
+/* straight to the registers: no locks, no logging, in iram. the channel has to be set up and nothing else may */
+/* drive it at the same time */
+void hal_pwm_set_fast(uint8_t channel, uint32_t duty);
+
+/* alarm: one one-shot timer that runs callback outside of the task that armed it, even if that task is stuck */
+bool hal_alarm_init(HalAlarmCallback callback, void *arg);
+void hal_alarm_arm(uint32_t timeout_us); /* re-arming replaces the pending timeout */
+void hal_alarm_cancel(void);
+
+/* critical section: nothing else runs until the exit, not even an isr. a few register writes at most */
+void hal_critical_enter(void);
+void hal_critical_exit(void);
+
+/* clock */
+int64_t hal_clock_now_us(void);
+void hal_delay_us(uint32_t us); /* busy wait, for short settle times */
+void hal_delay_ms(uint32_t ms); /* yields to other tasks */
+
+/* cycle counter: wraps, only differences over short spans mean anything */
+uint32_t hal_cycle_count(void);
+uint32_t hal_cycles_per_us(void);
+
+#endif /* _HAL_H */
\ No newline at end of file
@@ -0,0 +1,275 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * hal_esp.c - ESP-IDF backend of the hardware abstraction layer. i2c master bus with asynchronous
+ * transfers, gpio interrupts, LEDC pwm channels and the esp_timer clock
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "driver/i2c_master.h"
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "hal/ledc_ll.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "hal.h"
+
+#define LEDC_TIMER            LEDC_TIMER_0
+#define LEDC_SPEED_MODE       LEDC_LOW_SPEED_MODE /* this is the only available speed mode for the esp32c3 */
+
+struct HalBusDevice {
+    i2c_master_dev_handle_t handle;
+    SemaphoreHandle_t done;                /* given from the driver isr every time a transfer finishes */
+    volatile i2c_master_event_t event;
+};
+
+static i2c_master_bus_handle_t bus = NULL;
+static HalBusDevice devices[HAL_BUS_MAX_DEVICES];
+static uint8_t device_count = 0U;
+static bool isr_service_installed = false;
+static esp_timer_handle_t alarm = NULL;
+static portMUX_TYPE critical_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool IRAM_ATTR bus_trans_done(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_data_t *evt_data, void *arg)
+{
+    HalBusDevice *device = (HalBusDevice *)arg;
+    BaseType_t task_woken = pdFALSE;
+    device->event = evt_data->event;
+    xSemaphoreGiveFromISR(device->done, &task_woken);
+    return task_woken == pdTRUE;
+}
+
+bool hal_bus_init(uint8_t port, uint8_t sda_pin, uint8_t scl_pin)
+{
+    i2c_master_bus_config_t bus_config = {
+        .i2c_port = port,
+        .sda_io_num = (gpio_num_t)sda_pin,
+        .scl_io_num = (gpio_num_t)scl_pin,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7U,
+        .trans_queue_depth = HAL_BUS_QUEUE_DEPTH, /* non zero depth + callback = asynchronous transfers */
+        .flags.enable_internal_pullup = true
+    };
+
+    esp_err_t err = i2c_new_master_bus(&bus_config, &bus);
+    if (err != ESP_OK) { ESP_LOGE("hal_bus_init", "I2C bus config failed: %d", err); return false; }
+
+    return true;
+}
+
+HalBusDevice *hal_bus_add_device(uint16_t address, uint32_t speed_hz)
+{
+    if (bus == NULL || device_count >= HAL_BUS_MAX_DEVICES) { ESP_LOGE("hal_bus_add_device", "No bus or no free device slot"); return NULL; }
+
+    HalBusDevice *device = &devices[device_count];
+    i2c_device_config_t device_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = address,
+        .scl_speed_hz = speed_hz
+    };
+
+    esp_err_t err = i2c_master_bus_add_device(bus, &device_config, &device->handle);
+    if (err != ESP_OK) { ESP_LOGE("hal_bus_add_device", "Failed to add device 0x%X: %d", address, err); return NULL; }
+
+    device->done = xSemaphoreCreateBinary();
+    device->event = I2C_EVENT_DONE;
+    i2c_master_event_callbacks_t callbacks = { .on_trans_done = bus_trans_done };
+    err = i2c_master_register_event_callbacks(device->handle, &callbacks, device);
+    if (err != ESP_OK) { ESP_LOGE("hal_bus_add_device", "Failed to register I2C callbacks: %d", err); return NULL; }
+
+    device_count++;
+    return device;
+}
+
+bool hal_bus_start(HalBusDevice *device, const uint8_t *write, size_t write_length, uint8_t *read, size_t read_length)
+{
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(device->done, 0); /* nothing is in flight here, a leftover give would end the next wait early */
+    if (read_length > 0U) { err = i2c_master_transmit_receive(device->handle, write, write_length, read, read_length, -1); }
+    else                  { err = i2c_master_transmit(device->handle, write, write_length, -1); }
+    if (err != ESP_OK) { ESP_LOGE("hal_bus_start", "Failed to queue I2C transfer: %d", err); return false; }
+
+    return true;
+}
+
+bool hal_bus_wait(HalBusDevice *device, uint32_t timeout_ms)
+{
+    /* every transfer gives the semaphore exactly once */
+    if (xSemaphoreTake(device->done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)
+    {
+        /* the transfer is still queued: get the bus unstuck, let the driver finish or drop it, then throw away the */
+        /* completion it gives late so it can't be taken for the next transfer's */
+        ESP_LOGE("hal_bus_wait", "I2C transfer timed out, resetting the bus");
+        i2c_master_bus_reset(bus);
+        i2c_master_bus_wait_all_done(bus, (int)timeout_ms);
+        xSemaphoreTake(device->done, 0);
+        return false;
+    }
+    if (device->event != I2C_EVENT_DONE)
+    {
+        ESP_LOGE("hal_bus_wait", "I2C transfer failed, event: %d", device->event);
+        return false;
+    }
+    return true;
+}
+
+bool hal_gpio_irq_init(uint8_t pin, HalIsr isr, void *arg)
+{
+    gpio_reset_pin((gpio_num_t)pin);
+    gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT);
+    gpio_pullup_dis((gpio_num_t)pin);
+    gpio_pulldown_en((gpio_num_t)pin);
+    gpio_set_intr_type((gpio_num_t)pin, GPIO_INTR_POSEDGE);
+    if (!isr_service_installed)
+    {
+        gpio_install_isr_service(0U);
+        isr_service_installed = true;
+    }
+
+    esp_err_t err = gpio_isr_handler_add((gpio_num_t)pin, isr, arg);
+    if (err != ESP_OK) { ESP_LOGE("hal_gpio_irq_init", "Failed to add isr on pin %u: %d", pin, err); return false; }
+    gpio_intr_enable((gpio_num_t)pin);
+
+    return true;
+}
+
+bool hal_pwm_init(uint8_t channel, uint8_t pin, uint32_t frequency, uint8_t resolution_bits)
+{
+    /* configure PWM timer */
+    ledc_timer_config_t timer_config = {
+        .speed_mode = LEDC_SPEED_MODE,
+        .duty_resolution = (ledc_timer_bit_t)resolution_bits,
+        .timer_num = LEDC_TIMER,
+        .freq_hz = frequency,
+        .clk_cfg = LEDC_AUTO_CLK
+    };
+
+    esp_err_t err = ledc_timer_config(&timer_config);
+    if (err != ESP_OK) { ESP_LOGE("hal_pwm_init", "Timer config failed: %d", err); return false; }
+
+    /* configure PWM channel */
+    ledc_channel_config_t channel_config = {
+        .gpio_num = pin,
+        .speed_mode = LEDC_SPEED_MODE,
+        .channel = (ledc_channel_t)channel,
+        .timer_sel = LEDC_TIMER,
+        .duty = 0U, /* start with 0% duty cycle */
+        .hpoint = 0U
+    };
+
+    err = ledc_channel_config(&channel_config);
+    if (err != ESP_OK) { ESP_LOGE("hal_pwm_init", "Channel %u config failed: %d", channel, err); return false; }
+
+    return true;
+}
+
+bool hal_pwm_set(uint8_t channel, uint32_t duty)
+{
+    esp_err_t err = ledc_set_duty(LEDC_SPEED_MODE, (ledc_channel_t)channel, duty);
+    if (err == ESP_OK) { err = ledc_update_duty(LEDC_SPEED_MODE, (ledc_channel_t)channel); }
+    if (err != ESP_OK) { ESP_LOGE("hal_pwm_set", "Failed to set channel %u duty: %d", channel, err); return false; }
+
+    return true;
+}
+
+/* what ledc_set_duty + ledc_update_duty end up doing, minus the lock, the argument checks and the fade setup */
+/* that ledc_channel_config already left at a single step */
+void IRAM_ATTR hal_pwm_set_fast(uint8_t channel, uint32_t duty)
+{
+    ledc_dev_t *hw = LEDC_LL_GET_HW();
+    ledc_ll_set_duty_int_part(hw, LEDC_SPEED_MODE, (ledc_channel_t)channel, duty);
+    ledc_ll_set_duty_start(hw, LEDC_SPEED_MODE, (ledc_channel_t)channel, true);
+    ledc_ll_ls_channel_update(hw, LEDC_SPEED_MODE, (ledc_channel_t)channel);
+}
+
+bool hal_alarm_init(HalAlarmCallback callback, void *arg)
+{
+    esp_timer_create_args_t alarm_config = {
+        .callback = callback,
+        .arg = arg,
+        .dispatch_method = ESP_TIMER_TASK, /* the esp_timer task outranks every application task */
+        .name = "hal_alarm"
+    };
+
+    esp_err_t err = esp_timer_create(&alarm_config, &alarm);
+    if (err != ESP_OK) { ESP_LOGE("hal_alarm_init", "Failed to create alarm: %d", err); return false; }
+
+    return true;
+}
+
+void hal_alarm_arm(uint32_t timeout_us)
+{
+    if (alarm == NULL) { return; }
+    esp_timer_stop(alarm); /* fails harmlessly if it wasn't running */
+    esp_timer_start_once(alarm, timeout_us);
+}
+
+void hal_alarm_cancel(void)
+{
+    if (alarm == NULL) { return; }
+    esp_timer_stop(alarm);
+}
+
+/* the _SAFE variants pick the isr or task version themselves, the motor calls are made from both */
+void IRAM_ATTR hal_critical_enter(void)
+{
+    portENTER_CRITICAL_SAFE(&critical_lock);
+}
+
+void IRAM_ATTR hal_critical_exit(void)
+{
+    portEXIT_CRITICAL_SAFE(&critical_lock);
+}
+
+int64_t hal_clock_now_us(void)
+{
+    return esp_timer_get_time();
+}
+
+void hal_delay_us(uint32_t us)
+{
+    esp_rom_delay_us(us);
+}
+
+void hal_delay_ms(uint32_t ms)
+{
+    TickType_t ticks = pdMS_TO_TICKS(ms);
+    if (ticks == 0U && ms > 0U) { ticks = 1U; } /* anything shorter than a tick still has to wait */
+    vTaskDelay(ticks);
+}
+
+uint32_t hal_cycle_count(void)
+{
+    return (uint32_t)esp_cpu_get_cycle_count();
+}
+
+uint32_t hal_cycles_per_us(void)
+{
+    return esp_rom_get_cpu_ticks_per_us();
+}
\ No newline at end of file
@@ -28,92 +28,62 @@
  */
 
 #include <math.h>
-#include "driver/i2c.h"
+#include <string.h>
 #include "esp_log.h"
+#include "hal.h"
 #include "imu.h"
 
+static HalBusDevice *imu_device = NULL;
+static uint8_t async_register = 0x00;                      /* async transfers read from these after the caller returned */
+static uint8_t async_buffer[FIFO_SIZE];
+static size_t async_length = 0U;
+static uint8_t sync_write[2U];                             /* so do the blocking ones, a transfer that timed out may */
+static uint8_t sync_read[14U];                             /* still be queued and land after its caller gave up. 14 is */
+                                                           /* the longest blocking read, temperature + accel + gyro */
+
 void init_i2c(void)
 {
-    i2c_port_t i2c_master_port = (i2c_port_t)I2C_PORT_NUM;
-    i2c_config_t conf;
-    conf.mode = I2C_MODE_MASTER;
-    conf.sda_io_num = (gpio_num_t)I2C_MASTER_SDA_IO;
-    conf.scl_io_num = (gpio_num_t)I2C_MASTER_SCL_IO;
-    conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
-    conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
-    conf.master.clk_speed = I2C_MASTER_FREQ_HZ;
-    conf.clk_flags = 0;
-
-    esp_err_t err = i2c_param_config(i2c_master_port, &conf);
-    if (err != ESP_OK) { ESP_LOGE("init_i2c", "I2C bus config failed: %d", err); }
-
-    err = i2c_driver_install(i2c_master_port, conf.mode,
-                             I2C_MASTER_RX_BUF_DISABLE,
-                             I2C_MASTER_TX_BUF_DISABLE, 0);
-    if (err != ESP_OK) { ESP_LOGE("init_i2c", "Failed to install I2C driver: %d", err); }
+    if (!hal_bus_init(I2C_PORT_NUM, I2C_MASTER_SDA_IO, I2C_MASTER_SCL_IO)) { ESP_LOGE("init_i2c", "I2C bus config failed"); return; }
+
+    imu_device = hal_bus_add_device(ICM42688_ADDR, I2C_MASTER_FREQ_HZ);
+    if (imu_device == NULL) { ESP_LOGE("init_i2c", "Failed to add IMU to the I2C bus"); }
 }
 
 static void set_register(uint8_t register_address, uint8_t set_value)
 {
-    register_address = register_address & 0x007F; /* clamp address range from 0 - 127 */
-
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-
-    esp_err_t err = i2c_master_start(cmd);                                                    // send start bit
-    if (err != ESP_OK) { ESP_LOGE("set_register", "i2c_master_start failed: %d", err); }
-
-    err = i2c_master_write_byte(cmd, (ICM42688_ADDR << 1) | WRITE_BIT, ACK_CHECK_EN);         // IMU 7-bit address + write bit
-    if (err != ESP_OK) { ESP_LOGE("set_register", "i2c_master_write_byte failed: %d", err); }
-
-    err = i2c_master_write_byte(cmd, register_address, ACK_CHECK_EN);                         // target register
-    if (err != ESP_OK) { ESP_LOGE("set_register", "i2c_master_write_byte failed: %d", err); }
-
-    err = i2c_master_write_byte(cmd, set_value, ACK_CHECK_EN);                                // target value
-    if (err != ESP_OK) { ESP_LOGE("set_register", "i2c_master_write_byte failed: %d", err); }
+    sync_write[0] = register_address & 0x007F; /* clamp address range from 0 - 127 */
+    sync_write[1] = set_value;
 
-    err = i2c_master_stop(cmd);                                                               // send stop bit
-    if (err != ESP_OK) { ESP_LOGE("set_register", "i2c_master_stop failed: %d", err); }
+    if (!hal_bus_start(imu_device, sync_write, 2U, NULL, 0U)) { return; } /* start + address + register + value + stop */
+    hal_bus_wait(imu_device, I2C_TIMEOUT_MS);
+}
 
-    err = i2c_master_cmd_begin((i2c_port_t)I2C_PORT_NUM, cmd, 1000U / portTICK_PERIOD_MS);     // send all queued commands
-    if (err != ESP_OK) { ESP_LOGE("set_register", "i2c_master_cmd_begin failed: %d", err); }
+/* buffer is left alone if the transfer fails */
+static void read_registers(uint8_t register_address, uint8_t *buffer, size_t length)
+{
+    if (length == 0U || length > sizeof(sync_read)) { return; }
+    sync_write[0] = register_address & 0x007F; /* clamp address range from 0 - 127 */
 
-    i2c_cmd_link_delete(cmd);
+    /* the imu auto-increments the register address, so the whole block goes in one repeated start transaction */
+    if (!hal_bus_start(imu_device, sync_write, 1U, sync_read, length)) { return; }
+    if (hal_bus_wait(imu_device, I2C_TIMEOUT_MS)) { memcpy(buffer, sync_read, length); }
 }
 
 static uint8_t read_register(uint8_t register_address)
 {
     uint8_t data = 0x00;
-    register_address = register_address & 0x007F; /* clamp address range from 0 - 127 */
-
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-
-    esp_err_t err = i2c_master_start(cmd);                                                     // send start bit
-    if (err != ESP_OK) { ESP_LOGE("read_register", "i2c_master_start failed: %d", err); }
-
-    err = i2c_master_write_byte(cmd, (ICM42688_ADDR << 1) | WRITE_BIT, ACK_CHECK_EN);          // IMU 7-bit address + write bit
-    if (err != ESP_OK) { ESP_LOGE("read_register", "i2c_master_write_byte failed: %d", err); }
-
-    err = i2c_master_write_byte(cmd, register_address, ACK_CHECK_EN);                          // register to be read
-    if (err != ESP_OK) { ESP_LOGE("read_register", "i2c_master_write_byte failed: %d", err); }
-
-    err = i2c_master_start(cmd);                                                               // resend start bit
-    if (err != ESP_OK) { ESP_LOGE("read_register", "i2c_master_start failed: %d", err); }
-
-    err = i2c_master_write_byte(cmd, (ICM42688_ADDR << 1) | READ_BIT, ACK_CHECK_EN);           // IMU 7-bit address + read bit
-    if (err != ESP_OK) { ESP_LOGE("read_register", "i2c_master_write_byte failed: %d", err); }
-
-    err = i2c_master_read_byte(cmd, &data, I2C_MASTER_NACK);                                   // read into data buffer
-    if (err != ESP_OK) { ESP_LOGE("read_register", "i2c_master_read_byte failed: %d", err); }
-
-    err = i2c_master_stop(cmd);                                                                // send stop bit
-    if (err != ESP_OK) { ESP_LOGE("read_register", "i2c_master_stop failed: %d", err); }
-
-    err = i2c_master_cmd_begin((i2c_port_t)I2C_PORT_NUM, cmd, 1000U / portTICK_PERIOD_MS);      // send all queued commands
-    if (err != ESP_OK) { ESP_LOGE("read_register", "i2c_master_cmd_begin failed: %d", err); }
+    read_registers(register_address, &data, 1U);
+    return data;
+}
 
-    i2c_cmd_link_delete(cmd);
+/* queue a block read and return right away, the result lands in async_buffer */
+static bool read_registers_async(uint8_t register_address, size_t length)
+{
+    if (length == 0U || length > sizeof(async_buffer)) { return false; }
 
-    return data;
+    async_register = register_address & 0x007F; /* clamp address range from 0 - 127 */
+    async_length = length;
+    return hal_bus_start(imu_device, &async_register, 1U, async_buffer, length);
 }
 
 static void set_accel_resolution(IMU *imu, uint8_t scale)
@@ -168,38 +138,87 @@ static void set_gyro_resolution(IMU *imu, uint8_t scale)
 
 static void get_accel_data_into_buffer(int16_t *buffer)
 {
-    uint8_t raw_data = 0x00U;
-
-    raw_data = read_register(ICM42688_ACCEL_DATA_X1);
-    buffer[0] = (int16_t)raw_data << 8U;
-    raw_data = read_register(ICM42688_ACCEL_DATA_X0);
-    buffer[0] |= raw_data;
-    raw_data = read_register(ICM42688_ACCEL_DATA_Y1);
-    buffer[1] = (int16_t)raw_data << 8U;
-    raw_data = read_register(ICM42688_ACCEL_DATA_Y0);
-    buffer[1] |= raw_data;
-    raw_data = read_register(ICM42688_ACCEL_DATA_Z1);
-    buffer[2] = (int16_t)raw_data << 8U;
-    raw_data = read_register(ICM42688_ACCEL_DATA_Z0);
-    buffer[2] |= raw_data;
+    uint8_t raw_data[6U] = { 0 };
+
+    read_registers(ICM42688_ACCEL_DATA_X1, raw_data, sizeof(raw_data));
+    buffer[0] = (int16_t)((raw_data[0] << 8U) | raw_data[1]);
+    buffer[1] = (int16_t)((raw_data[2] << 8U) | raw_data[3]);
+    buffer[2] = (int16_t)((raw_data[4] << 8U) | raw_data[5]);
 }
 
 static void get_gyro_data_into_buffer(int16_t *buffer)
 {
-    uint8_t raw_data = 0x00U;
-
-    raw_data = read_register(ICM42688_GYRO_DATA_X1);
-    buffer[0] = (int16_t)raw_data << 8U;
-    raw_data = read_register(ICM42688_GYRO_DATA_X0);
-    buffer[0] |= raw_data;
-    raw_data = read_register(ICM42688_GYRO_DATA_Y1);
-    buffer[1] = (int16_t)raw_data << 8U;
-    raw_data = read_register(ICM42688_GYRO_DATA_Y0);
-    buffer[1] |= raw_data;
-    raw_data = read_register(ICM42688_GYRO_DATA_Z1);
-    buffer[2] = (int16_t)raw_data << 8U;
-    raw_data = read_register(ICM42688_GYRO_DATA_Z0);
-    buffer[2] |= raw_data;
+    uint8_t raw_data[6U] = { 0 };
+
+    read_registers(ICM42688_GYRO_DATA_X1, raw_data, sizeof(raw_data));
+    buffer[0] = (int16_t)((raw_data[0] << 8U) | raw_data[1]);
+    buffer[1] = (int16_t)((raw_data[2] << 8U) | raw_data[3]);
+    buffer[2] = (int16_t)((raw_data[4] << 8U) | raw_data[5]);
+}
+
+/* the sensor data block starts at TEMP_DATA1 when the temperature is read too */
+#if IMU_READ_TEMPERATURE
+#define SENSOR_DATA_START   ICM42688_TEMP_DATA1
+#define SENSOR_DATA_LENGTH  14U
+#else
+#define SENSOR_DATA_START   ICM42688_ACCEL_DATA_X1
+#define SENSOR_DATA_LENGTH  12U
+#endif
+
+/* buffer layout is { ax, ay, az, gx, gy, gz, temp }, temp is only filled when IMU_READ_TEMPERATURE is set */
+static void decode_sensor_data(const uint8_t *raw_data, int16_t *buffer)
+{
+#if IMU_READ_TEMPERATURE
+    buffer[6] = (int16_t)((raw_data[0] << 8U) | raw_data[1]);
+    raw_data = &raw_data[2];
+#endif
+
+    for (uint8_t i = 0U; i < 6U; i++)
+    {
+        buffer[i] = (int16_t)((raw_data[2U * i] << 8U) | raw_data[2U * i + 1U]);
+    }
+}
+
+/* single burst over the contiguous data registers so accel and gyro always come from the same sample */
+static void get_sensor_data_into_buffer(int16_t *buffer)
+{
+    uint8_t raw_data[SENSOR_DATA_LENGTH] = { 0 };
+    read_registers(SENSOR_DATA_START, raw_data, sizeof(raw_data));
+    decode_sensor_data(raw_data, buffer);
+}
+
+/* poll INT_STATUS until any of the bits in mask shows up, reading it clears the bits */
+static bool poll_status(uint8_t mask, uint32_t timeout_ms)
+{
+    int64_t deadline = hal_clock_now_us() + (int64_t)timeout_ms * 1000;
+
+    while (hal_clock_now_us() < deadline)
+    {
+        if (read_register(ICM42688_INT_STATUS) & mask) { return true; }
+        hal_delay_us(IMU_POLL_INTERVAL_US);
+    }
+
+    return false;
+}
+
+static float odr_to_period(uint8_t odr)
+{
+    switch(odr)
+    {
+        case GODR_32kHz:  return 1.0F / 32000.0F;
+        case GODR_16kHz:  return 1.0F / 16000.0F;
+        case GODR_8kHz:   return 1.0F / 8000.0F;
+        case GODR_4kHz:   return 1.0F / 4000.0F;
+        case GODR_2kHz:   return 1.0F / 2000.0F;
+        case GODR_1kHz:   return 1.0F / 1000.0F;
+        case GODR_500Hz:  return 1.0F / 500.0F;
+        case GODR_200Hz:  return 1.0F / 200.0F;
+        case GODR_100Hz:  return 1.0F / 100.0F;
+        case GODR_50Hz:   return 1.0F / 50.0F;
+        case GODR_25Hz:   return 1.0F / 25.0F;
+        case GODR_12_5Hz: return 1.0F / 12.5F;
+        default:          return 1.0F / 1000.0F; /* default ODR */
+    }
 }
 
 static void imu_self_test(IMU *imu, uint8_t st_accel_scale, uint8_t st_gyro_scale)
@@ -221,22 +240,22 @@ static void imu_self_test(IMU *imu, uint8_t st_accel_scale, uint8_t st_gyro_scal
 
     set_register(ICM42688_REG_BANK_SEL, 0x00); /* go to register bank 0 */
     set_register(ICM42688_PWR_MGMT0, 0x0F); /* turn on accel and gyro in low noise mode */
-    vTaskDelay(1U / portTICK_PERIOD_MS); /* as per the datasheet, wait at least 200us after turning on accel and gyro */
+    hal_delay_us(IMU_PWR_SETTLE_US); /* as per the datasheet, wait at least 200us after turning on accel and gyro */
 
     set_register(ICM42688_ACCEL_CONFIG0, st_accel_scale << 5U | AODR_1kHz); /* FS = 2 */
     set_register(ICM42688_GYRO_CONFIG0, st_gyro_scale << 5U | GODR_1kHz); /* FS = 3 */
     set_register(ICM42688_GYRO_ACCEL_CONFIG0, 0x44); /* set gyro and accel bandwith to ODR/10 */
-    vTaskDelay(100U / portTICK_PERIOD_MS); /* wait for readings to stabilize */
+    hal_delay_ms(100U); /* wait for readings to stabilize */
 
     get_accel_data_into_buffer(accel_nominal);
     get_gyro_data_into_buffer(gyro_nominal);
 
     set_register(ICM42688_SELF_TEST_CONFIG, 0x78); /* set accel self test */
-    vTaskDelay(100U / portTICK_PERIOD_MS); /* let accel respond */
+    hal_delay_ms(100U); /* let accel respond */
     get_accel_data_into_buffer(accel_self_test);
 
     set_register(ICM42688_SELF_TEST_CONFIG, 0x07); /* set gyro self test */
-    vTaskDelay(100U / portTICK_PERIOD_MS); /* let gyro respond */
+    hal_delay_ms(100U); /* let gyro respond */
     get_gyro_data_into_buffer(gyro_self_test);
 
     set_register(ICM42688_SELF_TEST_CONFIG, 0x00); /* go back to normal mode */
@@ -273,6 +292,7 @@ static void imu_self_test(IMU *imu, uint8_t st_accel_scale, uint8_t st_gyro_scal
     ratio[3] = ((float)gyro_diff[0]) / (2620.0F * powf(1.01F, (float)st_manufacturer[3] - 1.0F) + 0.5F); 
     ratio[4] = ((float)gyro_diff[1]) / (2620.0F * powf(1.01F, (float)st_manufacturer[4] - 1.0F) + 0.5F); 
     ratio[5] = ((float)gyro_diff[2]) / (2620.0F * powf(1.01F, (float)st_manufacturer[5] - 1.0F) + 0.5F); 
+    for (uint8_t i = 0U; i < 6U; i++) { imu->st_ratio[i] = ratio[i]; }
 
     set_register(ICM42688_REG_BANK_SEL, 0x00); /* go to register bank 0 */
 
@@ -304,7 +324,7 @@ static void imu_self_test(IMU *imu, uint8_t st_accel_scale, uint8_t st_gyro_scal
 
 }
 
-void imu_init(IMU *imu, uint8_t accel_scale, uint8_t gyro_scale, uint8_t accel_odr, uint8_t gyro_odr, uint8_t accel_mode, uint8_t gyro_mode, bool clock_in)
+void imu_init(IMU *imu, uint8_t accel_scale, uint8_t gyro_scale, uint8_t accel_odr, uint8_t gyro_odr, uint8_t accel_mode, uint8_t gyro_mode, bool clock_in, bool self_test)
 {
     imu->axbias = 0.0F;
     imu->aybias = 0.0F;
@@ -318,15 +338,22 @@ void imu_init(IMU *imu, uint8_t accel_scale, uint8_t gyro_scale, uint8_t accel_o
     imu->gx = 0.0F;
     imu->gy = 0.0F;
     imu->gz = 0.0F;
+    imu->temperature = 0.0F;
     imu->accel_resolution = 0.0F;
     imu->gyro_resolution = 0.0F;
+    imu->sample_period = odr_to_period(gyro_odr);
+    imu->fifo_overflows = 0U;
+    imu->fifo_lost_packets = 0U;
+    imu->fifo_lost_last = 0U;
 
     set_register(ICM42688_REG_BANK_SEL, 0x00); /* go to register bank 0 */
     set_register(ICM42688_DEVICE_CONFIG, 0x01); /* set bit 0 to 1 to issue soft reset */
-    vTaskDelay(1U / portTICK_PERIOD_MS); /* wait for registers to reset */
+    hal_delay_us(IMU_RESET_DELAY_US); /* the imu doesn't answer on the bus while resetting */
+    if (!poll_status(INT_STATUS_RESET_DONE, IMU_READY_TIMEOUT_MS)) { ESP_LOGE("imu_init", "IMU soft reset did not complete"); }
 
-    /* default the self test with accel scale set to 4g and gyro scale set to 250 dps, not necessary but recommended, can be commented out */
-    imu_self_test(imu, AFS_4G, GFS_250DPS); 
+    /* default the self test with accel scale set to 4g and gyro scale set to 250 dps, not necessary but recommended */
+    /* skipped when the result of a previous run is reused from the stored calibration */
+    if (self_test) { imu_self_test(imu, AFS_4G, GFS_250DPS); }
 
     /* update imu strut with scale resolutions */
     set_accel_resolution(imu, accel_scale);
@@ -334,17 +361,18 @@ void imu_init(IMU *imu, uint8_t accel_scale, uint8_t gyro_scale, uint8_t accel_o
 
     set_register(ICM42688_REG_BANK_SEL, 0x00); /* go to register bank 0 */
     set_register(ICM42688_PWR_MGMT0, gyro_mode << 2U | accel_mode); /* set desired accel and gyro modes */
-    vTaskDelay(1U / portTICK_PERIOD_MS); /* wait for at least 200us according to datasheet */
+    hal_delay_us(IMU_PWR_SETTLE_US); /* wait for at least 200us according to datasheet */
     set_register(ICM42688_ACCEL_CONFIG0, accel_scale << 5U | accel_odr); /* set accel Full Scale (FS) and Output Data Rate (ODR) */
     set_register(ICM42688_GYRO_CONFIG0, gyro_scale << 5U | gyro_odr); /* set gyro FS and ODR */
     set_register(ICM42688_GYRO_ACCEL_CONFIG0, 0x44); /* set accel and gyro bandwith to ODR/10 */
-    vTaskDelay(100U / portTICK_PERIOD_MS); /* wait for registers to stabilize */
+    read_register(ICM42688_INT_STATUS); /* clear a stale data ready flag so the poll below sees a fresh sample */
+    if (!poll_status(INT_STATUS_DATA_RDY, IMU_READY_TIMEOUT_MS)) { ESP_LOGE("imu_init", "IMU sensors did not start"); } /* gyro takes ~30 ms to start */
 
     /* configure interrupt handling */
     set_register(ICM42688_INT_CONFIG, 0x18 | 0x03); /* push-pull, pulsed, active HIGH interrupts */
     uint8_t temp = read_register(ICM42688_INT_CONFIG1); /* read current interrupt config */
     set_register(ICM42688_INT_CONFIG1, temp & ~(0x10)); /* clear bit 4 to allow async interrupt reset (required for proper interrupt operation) */
-    set_register(ICM42688_INT_SOURCE0, 0x08); /* route data ready interrupt to INT1 pin */
+    set_register(ICM42688_INT_SOURCE0, INT1_UI_DRDY_EN); /* route data ready interrupt to INT1 pin */
 
     /* use external clock source? */
     if (clock_in)
@@ -358,40 +386,69 @@ void imu_init(IMU *imu, uint8_t accel_scale, uint8_t gyro_scale, uint8_t accel_o
     set_register(ICM42688_REG_BANK_SEL, 0x00); /* go to register bank 0 */
 }
 
-void imu_calculate_bias(IMU *imu)
+void imu_measure_bias(IMU *imu, uint16_t samples, float *bias)
 {
-    int16_t temp[3U] = { 0, 0, 0 }; /* x, y, z */
+    static IMUSample batch[FIFO_MAX_PACKETS]; /* too big for the task stack */
     int32_t sum[6U] = { 0, 0, 0, 0, 0, 0 }; /* ax, ay, az, gx, gy, gz */
+    uint16_t collected = 0U;
+    uint16_t count = 0U;
+    int32_t timeout = (int32_t)IMU_MEASURE_TIMEOUT_MS;
+
+    /* drain the fifo about every half a fifo worth of samples so we get every sample at the full ODR */
+    uint32_t drain_ms = (uint32_t)(imu->sample_period * 1000.0F) * (FIFO_MAX_PACKETS / 2U);
+    if (drain_ms == 0U) { drain_ms = 1U; }
 
-    /* fetch accel and gyro readings over 128 samples and sum them */
-    for (int i = 0; i < 128; i++)
+    imu_fifo_enable(imu, FIFO_MAX_PACKETS); /* nobody is listening to INT1 yet, the watermark doesn't matter */
+    while (collected < samples && timeout > 0)
     {
-        get_accel_data_into_buffer(temp);
-        sum[0U] += temp[0U];
-        sum[1U] += temp[1U];
-        sum[2U] += temp[2U];
-        get_gyro_data_into_buffer(temp);
-        sum[3U] += temp[0U];
-        sum[4U] += temp[1U];
-        sum[5U] += temp[2U];
-        vTaskDelay(50U / portTICK_PERIOD_MS);
+        hal_delay_ms(drain_ms);
+        timeout -= (int32_t)drain_ms;
+        count = imu_fifo_read(imu, batch, samples - collected);
+        for (uint16_t i = 0U; i < count; i++)
+        {
+            sum[0U] += batch[i].ax;
+            sum[1U] += batch[i].ay;
+            sum[2U] += batch[i].az;
+            sum[3U] += batch[i].gx;
+            sum[4U] += batch[i].gy;
+            sum[5U] += batch[i].gz;
+        }
+        collected += count;
+    }
+
+    if (collected == 0U)
+    {
+        ESP_LOGE("imu_measure_bias", "No samples came out of the IMU FIFO");
+        for (uint8_t i = 0U; i < 6U; i++) { bias[i] = 0.0F; }
+        return;
     }
 
     /* calculate average of the past readings */
-    imu->axbias = ((float)sum[0] * imu->accel_resolution / 128.0F);
-    imu->aybias = ((float)sum[1] * imu->accel_resolution / 128.0F);
-    imu->azbias = ((float)sum[2] * imu->accel_resolution / 128.0F);
-    imu->gxbias = ((float)sum[3] * imu->gyro_resolution / 128.0F);
-    imu->gybias = ((float)sum[4] * imu->gyro_resolution / 128.0F);
-    imu->gzbias = ((float)sum[5] * imu->gyro_resolution / 128.0F);
+    for (uint8_t i = 0U; i < 3U; i++)
+    {
+        bias[i] = ((float)sum[i] * imu->accel_resolution / (float)collected);
+        bias[i + 3U] = ((float)sum[i + 3U] * imu->gyro_resolution / (float)collected);
+    }
 
     /* remove gravity from the axis currently experiencing the gravitational acceleration */
-    if (imu->axbias >  0.8F) { imu->axbias -= 1.0F; }
-    if (imu->axbias < -0.8F) { imu->axbias += 1.0F; }
-    if (imu->aybias >  0.8F) { imu->aybias -= 1.0F; }
-    if (imu->aybias < -0.8F) { imu->aybias += 1.0F; }
-    if (imu->azbias >  0.8F) { imu->azbias -= 1.0F; }
-    if (imu->azbias < -0.8F) { imu->azbias += 1.0F; }
+    for (uint8_t i = 0U; i < 3U; i++)
+    {
+        if (bias[i] >  0.8F) { bias[i] -= 1.0F; }
+        if (bias[i] < -0.8F) { bias[i] += 1.0F; }
+    }
+}
+
+void imu_calculate_bias(IMU *imu)
+{
+    float bias[6U] = { 0, 0, 0, 0, 0, 0 }; /* ax, ay, az, gx, gy, gz */
+
+    imu_measure_bias(imu, IMU_BIAS_SAMPLES, bias);
+    imu->axbias = bias[0];
+    imu->aybias = bias[1];
+    imu->azbias = bias[2];
+    imu->gxbias = bias[3];
+    imu->gybias = bias[4];
+    imu->gzbias = bias[5];
 
     /* log output to the console */
     ESP_LOGI("imu_calculate_bias", "-----------------------");
@@ -406,19 +463,155 @@ void imu_calculate_bias(IMU *imu)
     ESP_LOGI("imu_calculate_bias", "-----------------------");
 }
 
-void imu_read(IMU *imu)
+static void convert_sensor_data(IMU *imu, const int16_t *temp)
 {
-    int16_t temp[3U] = { 0, 0, 0 }; /* x, y, z */
-    get_accel_data_into_buffer(temp);
     /* reading in g (g force) */
     imu->ax = ((float)temp[0] * imu->accel_resolution) - imu->axbias;
     imu->ay = ((float)temp[1] * imu->accel_resolution) - imu->aybias;
     imu->az = ((float)temp[2] * imu->accel_resolution) - imu->azbias;
-    get_gyro_data_into_buffer(temp);
     /* reading in dps (degrees per second) */
-    imu->gx = ((float)temp[0] * imu->gyro_resolution) - imu->gxbias;
-    imu->gy = ((float)temp[1] * imu->gyro_resolution) - imu->gybias;
-    imu->gz = ((float)temp[2] * imu->gyro_resolution) - imu->gzbias;
+    imu->gx = ((float)temp[3] * imu->gyro_resolution) - imu->gxbias;
+    imu->gy = ((float)temp[4] * imu->gyro_resolution) - imu->gybias;
+    imu->gz = ((float)temp[5] * imu->gyro_resolution) - imu->gzbias;
+#if IMU_READ_TEMPERATURE
+    /* reading in degrees celsius, as per the datasheet */
+    imu->temperature = ((float)temp[6] / 132.48F) + 25.0F;
+#endif
+}
+
+void imu_read(IMU *imu)
+{
+    int16_t temp[7U] = { 0, 0, 0, 0, 0, 0, 0 }; /* ax, ay, az, gx, gy, gz, temperature */
+    get_sensor_data_into_buffer(temp);
+    convert_sensor_data(imu, temp);
+}
+
+bool imu_read_start(void)
+{
+    return read_registers_async(SENSOR_DATA_START, SENSOR_DATA_LENGTH);
+}
+
+bool imu_read_finish(IMU *imu)
+{
+    int16_t temp[7U] = { 0, 0, 0, 0, 0, 0, 0 }; /* ax, ay, az, gx, gy, gz, temperature */
+    if (!hal_bus_wait(imu_device, I2C_TIMEOUT_MS)) { return false; }
+    decode_sensor_data(async_buffer, temp);
+    convert_sensor_data(imu, temp);
+    return true;
+}
+
+void imu_fifo_enable(IMU *imu, uint16_t watermark)
+{
+    if (watermark == 0U) { watermark = 1U; }
+    if (watermark > FIFO_MAX_PACKETS) { watermark = FIFO_MAX_PACKETS; }
+
+    set_register(ICM42688_REG_BANK_SEL, 0x00); /* go to register bank 0 */
+    set_register(ICM42688_FIFO_CONFIG, FIFO_MODE_BYPASS); /* keep the fifo off while configuring it */
+    uint8_t temp = read_register(ICM42688_INTF_CONFIG0);
+    set_register(ICM42688_INTF_CONFIG0, temp | FIFO_COUNT_REC); /* count in packets, big endian data stays as is */
+    temp = read_register(ICM42688_TMST_CONFIG);
+    set_register(ICM42688_TMST_CONFIG, (temp & ~(TMST_DELTA_EN | TMST_RES_16US)) | TMST_EN); /* absolute timestamps, 1 us resolution */
+    set_register(ICM42688_FIFO_CONFIG1, FIFO_TMST_FSYNC_EN | FIFO_TEMP_EN | FIFO_GYRO_EN | FIFO_ACCEL_EN); /* 16 byte packet 3 */
+    set_register(ICM42688_FIFO_CONFIG2, (uint8_t)(watermark & 0xFF)); /* watermark [7:0] */
+    set_register(ICM42688_FIFO_CONFIG3, (uint8_t)((watermark >> 8U) & 0x0F)); /* watermark [11:8] */
+    set_register(ICM42688_INT_SOURCE0, INT1_FIFO_THS_EN | INT1_FIFO_FULL_EN); /* route watermark and full interrupts to INT1 instead of data ready */
+    set_register(ICM42688_SIGNAL_PATH_RESET, FIFO_FLUSH); /* start from an empty fifo */
+    set_register(ICM42688_FIFO_CONFIG, FIFO_MODE_STREAM);
+
+    imu->fifo_overflows = 0U;
+    imu->fifo_lost_packets = 0U;
+    imu->fifo_lost_last = 0U;
+}
+
+uint16_t imu_fifo_read_start(IMU *imu, uint16_t max_samples)
+{
+    uint8_t count_data[2U] = { 0 };
+    uint16_t count = 0U;
+
+    if (max_samples > FIFO_MAX_PACKETS) { max_samples = FIFO_MAX_PACKETS; }
+
+    /* reading the status also clears the watermark and full interrupts */
+    uint8_t status = read_register(ICM42688_INT_STATUS);
+    if (status & INT_STATUS_FIFO_FULL)
+    {
+        imu->fifo_overflows++;
+        read_registers(ICM42688_FIFO_LOST_PKT0, count_data, sizeof(count_data));
+        uint16_t lost = (uint16_t)((count_data[1] << 8U) | count_data[0]); /* this one is little endian */
+        imu->fifo_lost_packets += (uint16_t)(lost - imu->fifo_lost_last);
+        imu->fifo_lost_last = lost;
+    }
+
+    read_registers(ICM42688_FIFO_COUNTH, count_data, sizeof(count_data));
+    count = (uint16_t)((count_data[0] << 8U) | count_data[1]); /* in packets cause of FIFO_COUNT_REC */
+    if (count > max_samples) { count = max_samples; }
+    if (count == 0U) { return 0U; }
+
+    /* FIFO_DATA does not auto-increment, every byte of the burst pops the fifo */
+    if (!read_registers_async(ICM42688_FIFO_DATA, (size_t)count * FIFO_PACKET_SIZE)) { return 0U; }
+
+    return count;
+}
+
+uint16_t imu_fifo_read_finish(IMU *imu, IMUSample *samples)
+{
+    uint16_t count = (uint16_t)(async_length / FIFO_PACKET_SIZE);
+    uint16_t valid = 0U;
+
+    if (!hal_bus_wait(imu_device, I2C_TIMEOUT_MS)) { return 0U; }
+
+    for (uint16_t i = 0U; i < count; i++)
+    {
+        uint8_t *packet = &async_buffer[i * FIFO_PACKET_SIZE];
+        if (packet[0] & FIFO_HEADER_MSG) { break; } /* fifo ran empty */
+
+        IMUSample *sample = &samples[valid];
+        sample->ax = (int16_t)((packet[1] << 8U) | packet[2]);
+        sample->ay = (int16_t)((packet[3] << 8U) | packet[4]);
+        sample->az = (int16_t)((packet[5] << 8U) | packet[6]);
+        sample->gx = (int16_t)((packet[7] << 8U) | packet[8]);
+        sample->gy = (int16_t)((packet[9] << 8U) | packet[10]);
+        sample->gz = (int16_t)((packet[11] << 8U) | packet[12]);
+        sample->temperature = (int8_t)packet[13];
+        sample->timestamp = (uint16_t)((packet[14] << 8U) | packet[15]);
+
+        if (sample->ax == FIFO_INVALID_SAMPLE || sample->gx == FIFO_INVALID_SAMPLE) { continue; } /* sensor not ready yet */
+        valid++;
+    }
+
+    return valid;
+}
+
+uint16_t imu_fifo_read(IMU *imu, IMUSample *samples, uint16_t max_samples)
+{
+    if (imu_fifo_read_start(imu, max_samples) == 0U) { return 0U; }
+    return imu_fifo_read_finish(imu, samples);
+}
+
+void imu_convert_sample(IMU *imu, const IMUSample *sample)
+{
+    /* reading in g (g force) */
+    imu->ax = ((float)sample->ax * imu->accel_resolution) - imu->axbias;
+    imu->ay = ((float)sample->ay * imu->accel_resolution) - imu->aybias;
+    imu->az = ((float)sample->az * imu->accel_resolution) - imu->azbias;
+    /* reading in dps (degrees per second) */
+    imu->gx = ((float)sample->gx * imu->gyro_resolution) - imu->gxbias;
+    imu->gy = ((float)sample->gy * imu->gyro_resolution) - imu->gybias;
+    imu->gz = ((float)sample->gz * imu->gyro_resolution) - imu->gzbias;
+    /* fifo temperature is 8-bit, degrees celsius as per the datasheet */
+    imu->temperature = ((float)sample->temperature / 2.07F) + 25.0F;
+}
+
+bool imu_wait_ready(uint32_t timeout_ms)
+{
+    int64_t deadline = hal_clock_now_us() + (int64_t)timeout_ms * 1000;
+
+    while (hal_clock_now_us() < deadline)
+    {
+        if (read_register(ICM42688_WHO_AM_I) == ICM42688_ID) { return true; }
+        hal_delay_us(IMU_POLL_INTERVAL_US);
+    }
+
+    return false;
 }
 
 uint8_t imu_get_id(void)
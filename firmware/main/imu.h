@@ -38,13 +38,16 @@
 #define I2C_MASTER_SDA_IO                  1                /* GPIO_NUM_1 */
 #define IMU_INT1                           6                /* GPIO_NUM_6 */
 #define I2C_MASTER_FREQ_HZ                 400000           /* 400 khz max freq for esp32c3 */
-#define I2C_MASTER_TX_BUF_DISABLE          0
-#define I2C_MASTER_RX_BUF_DISABLE          0
+#define I2C_TIMEOUT_MS                     1000             /* per transfer */
 #define ICM42688_ADDR                      0x68             /* 0b1101000 (7-bit address) cause AP_AD0 = LOW */
 #define ICM42688_ID                        0x47
-#define WRITE_BIT                          I2C_MASTER_WRITE
-#define READ_BIT                           I2C_MASTER_READ
-#define ACK_CHECK_EN                       1
+#define IMU_BIAS_SAMPLES                   512U             /* samples averaged by imu_calculate_bias, taken at the full ODR */
+#define IMU_MEASURE_TIMEOUT_MS             2000U
+#define IMU_READY_TIMEOUT_MS               100U             /* max wait for the imu to answer, reset or start its sensors */
+#define IMU_POLL_INTERVAL_US               100U
+#define IMU_RESET_DELAY_US                 1000U            /* datasheet: 1 ms after soft reset before touching registers */
+#define IMU_PWR_SETTLE_US                  200U             /* datasheet: 200 us after PWR_MGMT0 before any register write */
+#define IMU_READ_TEMPERATURE               0                /* set to 1 to also fetch the die temperature on every imu_read (14 instead of 12 bytes) */
 
 /* User Bank 0 */
 #define ICM42688_DEVICE_CONFIG             0x11
@@ -161,6 +164,33 @@
 #define ICM42688_OFFSET_USER7              0x7E
 #define ICM42688_OFFSET_USER8              0x7F
 
+/* fifo configuration */
+#define FIFO_MODE_BYPASS                   0x00
+#define FIFO_MODE_STREAM                   0x40 /* stream-to-FIFO */
+#define FIFO_ACCEL_EN                      0x01
+#define FIFO_GYRO_EN                       0x02
+#define FIFO_TEMP_EN                       0x04
+#define FIFO_TMST_FSYNC_EN                 0x08
+#define FIFO_COUNT_REC                     0x40 /* INTF_CONFIG0, report FIFO count and watermark in records instead of bytes */
+#define FIFO_FLUSH                         0x02 /* SIGNAL_PATH_RESET */
+#define FIFO_HEADER_MSG                    0x80 /* set when the FIFO is empty and the packet is not valid */
+#define FIFO_PACKET_SIZE                   16U  /* packet 3: header + accel + gyro + temperature + timestamp */
+#define FIFO_SIZE                          2048U
+#define FIFO_MAX_PACKETS                   (FIFO_SIZE / FIFO_PACKET_SIZE)
+#define FIFO_INVALID_SAMPLE                (-32768)
+/* timestamp configuration (TMST_CONFIG) */
+#define TMST_EN                            0x01
+#define TMST_DELTA_EN                      0x04 /* stamp the delta since the last ODR tick instead of the absolute counter */
+#define TMST_RES_16US                      0x08 /* 16 us resolution instead of 1 us */
+/* interrupt status and sources */
+#define INT_STATUS_RESET_DONE              0x10
+#define INT_STATUS_DATA_RDY                0x08
+#define INT_STATUS_FIFO_THS                0x04
+#define INT_STATUS_FIFO_FULL               0x02
+#define INT1_UI_DRDY_EN                    0x08
+#define INT1_FIFO_THS_EN                   0x04
+#define INT1_FIFO_FULL_EN                  0x02
+
 /* accelerometer scale */
 #define AFS_2G                             0x03
 #define AFS_4G                             0x02
@@ -232,12 +262,49 @@ typedef struct {
     float gx;
     float gy;
     float gz;
+    float temperature; /* in degrees celsius, only updated when IMU_READ_TEMPERATURE is set or when reading from the fifo */
+    float st_ratio[6]; /* self-test response vs factory trim { ax, ay, az, gx, gy, gz }, 1.0 = nominal */
+    float sample_period; /* seconds between samples given the gyro ODR */
+    uint32_t fifo_overflows; /* times the fifo was found full when draining it */
+    uint32_t fifo_lost_packets; /* packets dropped by the imu because the fifo was full */
+    uint16_t fifo_lost_last; /* last raw value of the FIFO_LOST_PKT counter */
 } IMU;
 
+/* raw fifo packet, decoded but not scaled so a whole batch stays small */
+typedef struct {
+    int16_t ax;
+    int16_t ay;
+    int16_t az;
+    int16_t gx;
+    int16_t gy;
+    int16_t gz;
+    int8_t temperature;
+    uint16_t timestamp; /* sensor clock, 1 us per count, rolls over every ~65 ms */
+} IMUSample;
+
 void init_i2c(void);
 uint8_t imu_get_id(void);
-void imu_init(IMU *imu, uint8_t accel_scale, uint8_t gyro_scale, uint8_t accel_odr, uint8_t gyro_odr, uint8_t accel_mode, uint8_t gyro_mode, bool clock_in);
+/* poll WHO_AM_I until the imu answers, returns false on timeout */
+bool imu_wait_ready(uint32_t timeout_ms);
+void imu_init(IMU *imu, uint8_t accel_scale, uint8_t gyro_scale, uint8_t accel_odr, uint8_t gyro_odr, uint8_t accel_mode, uint8_t gyro_mode, bool clock_in, bool self_test);
+/* average samples readings taken from the fifo at the full ODR, gravity removed, { ax, ay, az, gx, gy, gz } in g and dps */
+/* leaves the fifo enabled */
+void imu_measure_bias(IMU *imu, uint16_t samples, float *bias);
 void imu_calculate_bias(IMU *imu);
 void imu_read(IMU *imu);
+/* switch the imu to stream-to-fifo mode, INT1 fires once watermark samples are queued (and when the fifo is full) */
+/* every packet carries the absolute 16-bit sensor timestamp at 1 us resolution */
+void imu_fifo_enable(IMU *imu, uint16_t watermark);
+/* drain up to max_samples packets in a single burst, returns the amount of valid samples written into samples */
+uint16_t imu_fifo_read(IMU *imu, IMUSample *samples, uint16_t max_samples);
+/* non-blocking variants of imu_read and imu_fifo_read. the _start call only queues the bus transfer and returns, */
+/* the matching _finish call blocks until the data arrived and decodes it. only one transfer can be in flight */
+bool imu_read_start(void);
+bool imu_read_finish(IMU *imu);
+/* returns the amount of packets queued for reading, 0 if there was nothing to read */
+uint16_t imu_fifo_read_start(IMU *imu, uint16_t max_samples);
+uint16_t imu_fifo_read_finish(IMU *imu, IMUSample *samples);
+/* scale a raw sample into the ax..gz fields of the imu struct, same units as imu_read */
+void imu_convert_sample(IMU *imu, const IMUSample *sample);
 
 #endif /* _IMU_H */
\ No newline at end of file
@@ -0,0 +1,109 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * kalman.c - two state pitch kalman filter, the matrices are small enough to write out by hand
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "kalman.h"
+
+/* F = [1 -dt; 0 1], Q = diag(q_angle, q_bias) * dt */
+static void predict_covariance(Kalman *filter, float deltat)
+{
+    float (*P)[KALMAN_STATES] = filter->P;
+
+    P[0][0] += deltat * (deltat * P[1][1] - P[0][1] - P[1][0] + filter->q_angle);
+    P[0][1] -= deltat * P[1][1];
+    P[1][0] -= deltat * P[1][1];
+    P[1][1] += filter->q_bias * deltat;
+}
+
+/* H = [1 0] */
+static void update_covariance(Kalman *filter)
+{
+    float (*P)[KALMAN_STATES] = filter->P;
+    float s = P[0][0] + filter->r;
+    float p00 = P[0][0];
+    float p01 = P[0][1];
+
+    filter->K[0] = P[0][0] / s;
+    filter->K[1] = P[1][0] / s;
+    P[0][0] -= filter->K[0] * p00;
+    P[0][1] -= filter->K[0] * p01;
+    P[1][0] -= filter->K[1] * p00;
+    P[1][1] -= filter->K[1] * p01;
+}
+
+void kalman_init(Kalman *filter, float q_angle, float q_bias, float r, bool steady_state, float nominal_deltat)
+{
+    filter->x[0] = 0.0F;
+    filter->x[1] = 0.0F;
+    filter->P[0][0] = 0.0F;
+    filter->P[0][1] = 0.0F;
+    filter->P[1][0] = 0.0F;
+    filter->P[1][1] = 0.0F;
+    filter->K[0] = 0.0F;
+    filter->K[1] = 0.0F;
+    filter->q_angle = q_angle;
+    filter->q_bias = q_bias;
+    filter->r = r;
+    filter->steady_state = steady_state;
+    filter->started = false;
+
+    /* the gain only depends on the noise and the sample period, run the riccati recursion until it settles */
+    if (steady_state)
+    {
+        for (uint16_t i = 0U; i < KALMAN_STEADY_ITERATIONS; i++)
+        {
+            predict_covariance(filter, nominal_deltat);
+            update_covariance(filter);
+        }
+    }
+}
+
+void kalman_predict(Kalman *filter, float rate, float deltat)
+{
+    filter->x[0] += deltat * (rate - filter->x[1]);
+    if (!filter->steady_state) { predict_covariance(filter, deltat); }
+}
+
+void kalman_correct(Kalman *filter, float accel_pitch)
+{
+    if (!filter->started)
+    {
+        filter->started = true;
+        filter->x[0] = accel_pitch;
+        return;
+    }
+
+    if (!filter->steady_state) { update_covariance(filter); }
+    float innovation = accel_pitch - filter->x[0];
+    filter->x[0] += filter->K[0] * innovation;
+    filter->x[1] += filter->K[1] * innovation;
+}
+
+void kalman_update(Kalman *filter, float rate, float accel_pitch, float deltat)
+{
+    kalman_predict(filter, rate, deltat);
+    kalman_correct(filter, accel_pitch);
+}
\ No newline at end of file
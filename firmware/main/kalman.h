@@ -0,0 +1,56 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * kalman.h - two state kalman filter for the pitch axis, [pitch, gyro bias], with the accel angle as the
+ * measurement. keeps estimating the gyro bias while running so the boot calibration stops mattering
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _KALMAN_H
+#define _KALMAN_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#define KALMAN_STATES              2U
+#define KALMAN_STEADY_ITERATIONS   4000U /* riccati steps at init for the steady state gain, 4 s of filter time at 1 kHz */
+
+typedef struct {
+    float x[KALMAN_STATES];                 /* pitch in degrees, gyro bias in dps */
+    float P[KALMAN_STATES][KALMAN_STATES];  /* error covariance */
+    float K[KALMAN_STATES];                 /* gain, fixed when steady_state */
+    float q_angle;                          /* process noise density of the pitch, deg^2/s */
+    float q_bias;                           /* process noise density of the bias, (deg/s)^2/s */
+    float r;                                /* accel angle variance, deg^2 */
+    bool steady_state;                      /* skip the covariance update and use the gain from init */
+    bool started;                           /* the first sample takes the accel angle as is */
+} Kalman;
+
+/* nominal_deltat is only used to find the steady state gain */
+void kalman_init(Kalman *filter, float q_angle, float q_bias, float r, bool steady_state, float nominal_deltat);
+/* rate in dps around the pitch axis, deltat in seconds */
+void kalman_predict(Kalman *filter, float rate, float deltat);
+/* accel_pitch in degrees, the first one just sets the pitch */
+void kalman_correct(Kalman *filter, float accel_pitch);
+void kalman_update(Kalman *filter, float rate, float accel_pitch, float deltat);
+
+#endif /* _KALMAN_H */
\ No newline at end of file
@@ -0,0 +1,80 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * lqr.c - full state feedback balance controller, gains from host/tools/lqr_synth.c
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "lqr.h"
+
+static const float lqr_gains[LQR_STATES] = LQR_GAINS;
+static const float lqr_wheel_a[LQR_STATES] = LQR_WHEEL_A;
+
+void lqr_init(LQR *controller, float out_min, float out_max)
+{
+    for (int i = 0; i < LQR_STATES; i++)
+    {
+        controller->k[i] = lqr_gains[i];
+        controller->wheel_a[i] = lqr_wheel_a[i];
+    }
+    controller->wheel_b = LQR_WHEEL_B;
+    controller->integral_decay = LQR_INTEGRAL_DECAY;
+    controller->out_min = out_min;
+    controller->out_max = out_max;
+    lqr_reset(controller);
+}
+
+void lqr_reset(LQR *controller)
+{
+    controller->wheel_speed = 0.0F;
+    controller->integral = 0.0F;
+    controller->output = 0.0F;
+    controller->saturated = false;
+}
+
+float lqr_step(LQR *controller, float error, float rate, float deltat)
+{
+    /* the model's pitch grows away from the balance point, the error grows the other way */
+    float x[LQR_STATES] = { -error, rate, controller->wheel_speed, controller->integral };
+    float unclamped = 0.0F;
+    for (int i = 0; i < LQR_STATES; i++) { unclamped -= controller->k[i] * x[i]; }
+
+    float output = unclamped;
+    if (output > controller->out_max) { output = controller->out_max; }
+    if (output < controller->out_min) { output = controller->out_min; }
+    controller->saturated = (output != unclamped);
+
+    /* predict the wheel with the duty that actually went out, scaled when a batch came late or early */
+    float predicted = controller->wheel_b * output;
+    for (int i = 0; i < LQR_STATES; i++) { predicted += controller->wheel_a[i] * x[i]; }
+    controller->wheel_speed += (predicted - controller->wheel_speed) * (deltat / LQR_PERIOD);
+
+    /* conditional integration: hold the integral while saturated and it would push further in */
+    if (!controller->saturated || (unclamped > output) != (error > 0.0F))
+    {
+        controller->integral = controller->integral * controller->integral_decay - error * deltat;
+    }
+
+    controller->output = output;
+    return output;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * lqr.h - full state feedback balance controller, gains from host/tools/lqr_synth.c
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _LQR_H
+#define _LQR_H
+#include <stdbool.h>
+#include "lqr_gains.h"
+
+typedef struct {
+    float k[LQR_STATES];          /* duty per unit of each state, see lqr_gains.h */
+    float wheel_a[LQR_STATES];    /* one period of the wheel speed model */
+    float wheel_b;
+    float integral_decay;
+    float out_min;
+    float out_max;
+    /* state */
+    float wheel_speed;            /* rad/s, predicted from the duty sent, there is no encoder */
+    float integral;               /* leaky integral of pitch - balance, deg s */
+    float output;                 /* last output, after the limits */
+    bool saturated;
+} LQR;
+
+void lqr_init(LQR *controller, float out_min, float out_max);
+/* start over with the wheel stopped, e.g. after the motor was off */
+void lqr_reset(LQR *controller);
+/* error = set point - pitch in degrees, rate = pitch rate from the gyro in dps. same signs as pid2_step */
+float lqr_step(LQR *controller, float error, float rate, float deltat);
+
+#endif /* _LQR_H */
\ No newline at end of file
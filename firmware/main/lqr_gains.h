@@ -0,0 +1,24 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * lqr_gains.h - generated by host/tools/lqr_synth.c, don't edit, run it again
+ * mass 0.3 kg, com 0.05 m, inertia 0.0012 kgm2, wheel inertia 1.5e-05 kgm2, kt 0.005, ke 0.005, resistance 2 ohm, vbat 3.7 V
+ * period 0.005 s, leak 2 s, q 100,1,0.0001,10, r 0.0001
+ * closed loop spectral radius 0.9975
+ */
+
+#ifndef _LQR_GAINS_H
+#define _LQR_GAINS_H
+
+#define LQR_STATES    4
+#define LQR_PERIOD    (0.00500000F) /* seconds */
+
+/* duty = -K x, x = [pitch - balance (deg), pitch rate (dps), wheel speed (rad/s, positive the way positive duty spins it), */
+/* integral of pitch - balance (deg s)] */
+#define LQR_GAINS     { 170.474883F, 15.4305354F, -1.34028053F, 0.0602994630F }
+/* discrete model row of the wheel speed, the firmware has no encoder and predicts it from the duty it sent */
+#define LQR_WHEEL_A   { 0.0106803214F, 2.67127455e-05F, 0.995790110F, 0.00000000F }
+#define LQR_WHEEL_B   (0.0122169361F)
+/* the pitch integral decays by this much every period */
+#define LQR_INTEGRAL_DECAY (0.997500000F)
+
+#endif /* _LQR_GAINS_H */
\ No newline at end of file
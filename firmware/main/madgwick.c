@@ -28,6 +28,9 @@
 
 #include <math.h>
 #include "madgwick.h"
+#include "fastmath.h"
+
+#define RAD_TO_DEG    (180.0F / 3.14159265358979F)
 
 void madgwick_init(Madgwick *filter, float beta)
 {
@@ -39,6 +42,7 @@ void madgwick_init(Madgwick *filter, float beta)
     filter->roll = 0.0F;
     filter->pitch = 0.0F;
     filter->yaw = 0.0F;
+    filter->fresh = 0U;
     filter->last_update = 0;
 }
 
@@ -120,20 +124,76 @@ void madgwick_update(Madgwick *filter, float gx, float gy, float gz, float ax, f
     filter->q2 /= norm;
     filter->q3 /= norm;
     filter->q4 /= norm;
+    filter->fresh = 0U;
 }
 
 
+void madgwick_set_quaternion(Madgwick *filter, const float q[4])
+{
+    filter->q1 = q[0];
+    filter->q2 = q[1];
+    filter->q3 = q[2];
+    filter->q4 = q[3];
+    filter->fresh = 0U;
+}
+
 void madgwick_get_rpy(Madgwick *filter)
 {
-    float a12 = 2.0f * (filter->q2 * filter->q3 + filter->q1 * filter->q4);
-    float a22 = filter->q1 * filter->q1 + filter->q2 * filter->q2 - filter->q3 * filter->q3 - filter->q4 * filter->q4;
+    madgwick_roll(filter);
+    madgwick_pitch(filter);
+    madgwick_yaw(filter);
+}
+
+float madgwick_roll(Madgwick *filter)
+{
+    if (filter->fresh & MADGWICK_ROLL) { return filter->roll; }
+
     float a31 = 2.0f * (filter->q1 * filter->q2 + filter->q3 * filter->q4);
-    float a32 = 2.0f * (filter->q2 * filter->q4 - filter->q1 * filter->q3);
     float a33 = filter->q1 * filter->q1 - filter->q2 * filter->q2 - filter->q3 * filter->q3 + filter->q4 * filter->q4;
+    filter->roll = atan2f(a31, a33) * RAD_TO_DEG;
+    filter->fresh |= MADGWICK_ROLL;
+    return filter->roll;
+}
+
+float madgwick_pitch(Madgwick *filter)
+{
+    if (filter->fresh & MADGWICK_PITCH) { return filter->pitch; }
+
+    float a32 = 2.0f * (filter->q2 * filter->q4 - filter->q1 * filter->q3);
+    filter->pitch = -asinf(a32) * RAD_TO_DEG;
+    filter->fresh |= MADGWICK_PITCH | MADGWICK_PITCH_FAST; /* the exact one does for the fast one too */
+    return filter->pitch;
+}
+
+float madgwick_yaw(Madgwick *filter)
+{
+    if (filter->fresh & MADGWICK_YAW) { return filter->yaw; }
 
-    filter->roll = atan2f(a31, a33) * 180.0F / 3.14159265358979F;
-    filter->pitch = -asinf(a32) * 180.0F / 3.14159265358979F;
-    filter->yaw = atan2f(a12, a22) * 180.0F / 3.14159265358979F;
+    float a12 = 2.0f * (filter->q2 * filter->q3 + filter->q1 * filter->q4);
+    float a22 = filter->q1 * filter->q1 + filter->q2 * filter->q2 - filter->q3 * filter->q3 - filter->q4 * filter->q4;
+    filter->yaw = atan2f(a12, a22) * RAD_TO_DEG;
     filter->yaw += 13.8F;
     if (filter->yaw < 0) { filter->yaw += 360.0F; }
+    filter->fresh |= MADGWICK_YAW;
+    return filter->yaw;
+}
+
+float madgwick_pitch_fast(Madgwick *filter)
+{
+    if (filter->fresh & MADGWICK_PITCH_FAST) { return filter->pitch; }
+
+    float a32 = 2.0f * (filter->q2 * filter->q4 - filter->q1 * filter->q3);
+    filter->pitch = -fast_asin(a32) * RAD_TO_DEG;
+    filter->fresh |= MADGWICK_PITCH_FAST;
+    return filter->pitch;
+}
+
+float madgwick_pitch_error(const Madgwick *filter, float setpoint_sin, float setpoint_cos)
+{
+    /* sin and cos of the pitch are the gravity row of the rotation matrix, cos is positive away from +-90 */
+    float sin_pitch = -2.0f * (filter->q2 * filter->q4 - filter->q1 * filter->q3);
+    float cos_squared = 1.0F - sin_pitch * sin_pitch;
+    float cos_pitch = (cos_squared > 0.0F) ? sqrtf(cos_squared) : 0.0F;
+
+    return (setpoint_sin * cos_pitch - setpoint_cos * sin_pitch) * RAD_TO_DEG;
 }
\ No newline at end of file
@@ -31,17 +31,34 @@
 #include <stdint.h>
 
 
+#define MADGWICK_ROLL          (1U << 0U)
+#define MADGWICK_PITCH         (1U << 1U)
+#define MADGWICK_YAW           (1U << 2U)
+#define MADGWICK_PITCH_FAST    (1U << 3U)
+
 typedef struct {
     float q1, q2, q3, q4;   /* quaternion components */
     float beta;             /* gain for gradient descent */
-    float roll, pitch, yaw; /* in degrees */
+    float roll, pitch, yaw; /* in degrees, as of the last getter that computed them */
+    uint8_t fresh;          /* MADGWICK_* angles already computed from the current quaternion */
     int64_t last_update;    /* last time filter was updated */
 } Madgwick;
 
 void madgwick_init(Madgwick *filter, float beta);
 /* gx, gy, and gz need to be in radians per second, deltat needs to be in seconds */
 void madgwick_update(Madgwick *filter, float gx, float gy, float gz, float ax, float ay, float az, float deltat);
+/* take a quaternion from somewhere else, e.g. another estimator, for the angle getters */
+void madgwick_set_quaternion(Madgwick *filter, const float q[4]);
 /* get roll, pitch and yaw in degrees */
 void madgwick_get_rpy(Madgwick *filter);
+/* single angles in degrees, each computed at most once per quaternion update */
+float madgwick_roll(Madgwick *filter);
+float madgwick_pitch(Madgwick *filter);
+float madgwick_yaw(Madgwick *filter);
+/* pitch with a polynomial asin instead of asinf, within 0.004 degrees of madgwick_pitch */
+float madgwick_pitch_fast(Madgwick *filter);
+/* sin(setpoint - pitch) in degrees straight from the quaternion, no inverse trig. it is the small angle */
+/* approximation of the pitch error: within 1% up to 14 degrees off, reads 10% low at 45 */
+float madgwick_pitch_error(const Madgwick *filter, float setpoint_sin, float setpoint_cos);
 
 #endif /* _MADGWICK_H */
\ No newline at end of file
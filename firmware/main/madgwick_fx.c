@@ -0,0 +1,153 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * madgwick_fx.c - fixed-point madgwick filter, a line by line port of madgwick_update with integer
+ * normalizations. products of two Q30 values are taken in 64 bits and shifted back
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "madgwick_fx.h"
+
+#define FX_ONE          ((int64_t)1 << MADGWICK_FX_Q)
+#define PI              (3.14159265358979F)
+#define RSQRT_NEWTON    3U  /* ~6% seed error -> 2e-9 */
+
+/* 1/sqrt of the middle of each quarter of [1, 4), Q30, indexed by the top 4 bits of a [2^60, 2^62) value */
+static const int64_t rsqrt_seed[16] = {
+    0, 0, 0, 0, 0x3C56FBBC, 0x36945278, 0x3234AAC3, 0x2EBD2E8D,
+    0x2BE754CE, 0x298757D2, 0x27806CA2, 0x25BEC18C, 0x243430A4, 0x22D651EB, 0x219D4C63, 0x20831490
+};
+
+/* m in [2^60, 2^62) read as a Q60 number x in [1, 4), returns 1/sqrt(x) in Q30 */
+static int64_t rsqrt(uint64_t m)
+{
+    int64_t x = (int64_t)(m >> 30);
+    int64_t r = rsqrt_seed[m >> 58];
+
+    /* newton on 1/r^2 - x, never overshoots so r stays below 2^30 */
+    for (uint8_t i = 0U; i < RSQRT_NEWTON; i++) { r = (r * ((3 * FX_ONE) - ((x * ((r * r) >> 30)) >> 30))) >> 31; }
+    return r;
+}
+
+/* scales v to unit length in Q30 whatever its scale is, false for a zero vector */
+static bool normalize(int64_t *v, uint8_t n)
+{
+    uint64_t peak = 0U;
+    uint64_t sum = 0U;
+    int8_t shift = 0;
+    uint8_t extra = 0U;
+
+    for (uint8_t i = 0U; i < n; i++) { peak |= (uint64_t)((v[i] < 0) ? -v[i] : v[i]); }
+    if (peak == 0U) { return false; }
+
+    /* bring the largest component to [2^29, 2^30): four squares can't overflow and small vectors keep their bits */
+    shift = (int8_t)(63 - __builtin_clzll(peak) - 29);
+    for (uint8_t i = 0U; i < n; i++)
+    {
+        v[i] = (shift > 0) ? (v[i] >> shift) : (v[i] * ((int64_t)1 << -shift));
+        sum += (uint64_t)(v[i] * v[i]);
+    }
+    /* sum is in [2^58, 2^62), rsqrt wants [2^60, 2^62), an even shift keeps the square root exact */
+    if (sum < ((uint64_t)1 << 60)) { sum <<= 2; extra = 1U; }
+
+    int64_t r = rsqrt(sum);
+    for (uint8_t i = 0U; i < n; i++) { v[i] = (v[i] * r) >> (30 - extra); }
+    return true;
+}
+
+void madgwick_fx_init(MadgwickFx *filter, float beta, float gyro_resolution)
+{
+    filter->q[0] = (int32_t)FX_ONE;
+    filter->q[1] = 0;
+    filter->q[2] = 0;
+    filter->q[3] = 0;
+    filter->beta_step = (int64_t)(beta * 1e-6F * 1125899906842624.0F); /* 2^50 */
+    filter->gyro_step = 0;
+    filter->gyro_resolution = 0.0F;
+    madgwick_fx_set_gyro_resolution(filter, gyro_resolution);
+}
+
+void madgwick_fx_set_gyro_resolution(MadgwickFx *filter, float gyro_resolution)
+{
+    if (gyro_resolution == filter->gyro_resolution) { return; }
+    filter->gyro_resolution = gyro_resolution;
+    filter->gyro_step = (int32_t)(gyro_resolution * (PI / 180.0F) * 0.5e-6F * 18014398509481984.0F); /* 2^54 */
+}
+
+void madgwick_fx_update(MadgwickFx *filter, int32_t gx, int32_t gy, int32_t gz, int32_t ax, int32_t ay, int32_t az, uint32_t deltat_us)
+{
+    int64_t q1 = filter->q[0];
+    int64_t q2 = filter->q[1];
+    int64_t q3 = filter->q[2];
+    int64_t q4 = filter->q[3];
+    int64_t a[3] = { ax, ay, az };
+    int64_t gradient[4] = { 0, 0, 0, 0 };
+    int64_t q[4] = { 0, 0, 0, 0 };
+
+    /* half the rotation over the step, Q30 */
+    int64_t hx = ((int64_t)gx * filter->gyro_step * (int64_t)deltat_us) >> 24;
+    int64_t hy = ((int64_t)gy * filter->gyro_step * (int64_t)deltat_us) >> 24;
+    int64_t hz = ((int64_t)gz * filter->gyro_step * (int64_t)deltat_us) >> 24;
+
+    /* quaternion derivative measured by gyroscopes, already integrated over the step */
+    q[0] = q1 + ((-q2 * hx - q3 * hy - q4 * hz) >> 30);
+    q[1] = q2 + (( q1 * hx + q3 * hz - q4 * hy) >> 30);
+    q[2] = q3 + (( q1 * hy - q2 * hz + q4 * hx) >> 30);
+    q[3] = q4 + (( q1 * hz + q2 * hy - q3 * hx) >> 30);
+
+    /* a zero accel vector has no direction to correct towards, the float filter would turn into NaN here */
+    if (normalize(a, 3U))
+    {
+        /* objective, each element within +-2 for a unit quaternion */
+        int64_t f_1 = ((q2 * q4 - q1 * q3) >> 29) - a[0];
+        int64_t f_2 = ((q1 * q2 + q3 * q4) >> 29) - a[1];
+        int64_t f_3 = FX_ONE - ((q2 * q2 + q3 * q3) >> 29) - a[2];
+
+        /* jacobian^T * f with the common factor of 2 left out, the normalization below takes care of it */
+        gradient[0] = ((q2 * f_2) >> 30) - ((q3 * f_1) >> 30);
+        gradient[1] = ((q4 * f_1) >> 30) + ((q1 * f_2) >> 30) - ((q2 * f_3) >> 29);
+        gradient[2] = ((q4 * f_2) >> 30) - ((q3 * f_3) >> 29) - ((q1 * f_1) >> 30);
+        gradient[3] = ((q2 * f_1) >> 30) + ((q3 * f_2) >> 30);
+
+        if (normalize(gradient, 4U))
+        {
+            int64_t step = (filter->beta_step * (int64_t)deltat_us) >> 20; /* beta * deltat, Q30 */
+            for (uint8_t i = 0U; i < 4U; i++) { q[i] -= (step * gradient[i]) >> 30; }
+        }
+    }
+
+    /* normalize the quaternion */
+    normalize(q, 4U);
+    for (uint8_t i = 0U; i < 4U; i++) { filter->q[i] = (int32_t)q[i]; }
+}
+
+void madgwick_fx_to_float(const MadgwickFx *filter, Madgwick *out)
+{
+    const float scale = 1.0F / (float)FX_ONE;
+
+    out->q1 = (float)filter->q[0] * scale;
+    out->q2 = (float)filter->q[1] * scale;
+    out->q3 = (float)filter->q[2] * scale;
+    out->q4 = (float)filter->q[3] * scale;
+    out->fresh = 0U;
+}
\ No newline at end of file
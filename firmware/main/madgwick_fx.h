@@ -0,0 +1,52 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * madgwick_fx.h - fixed-point madgwick filter for targets without an fpu, same algorithm as madgwick.c
+ * in Q30 on raw imu counts
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _MADGWICK_FX_H
+#define _MADGWICK_FX_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "madgwick.h"
+
+#define MADGWICK_FX_Q    30 /* quaternion and unit vectors: 1.0 == 1 << 30 */
+
+typedef struct {
+    int32_t q[4];           /* quaternion, Q30 */
+    int64_t beta_step;      /* beta per microsecond, Q50 */
+    int32_t gyro_step;      /* half a gyro count times a microsecond in radians, Q54 */
+    float gyro_resolution;  /* dps per count gyro_step was made for */
+} MadgwickFx;
+
+void madgwick_fx_init(MadgwickFx *filter, float beta, float gyro_resolution);
+/* only recomputes the scale if the full scale range changed */
+void madgwick_fx_set_gyro_resolution(MadgwickFx *filter, float gyro_resolution);
+/* raw imu counts with the bias already taken out, accel scale doesn't matter since it gets normalized */
+void madgwick_fx_update(MadgwickFx *filter, int32_t gx, int32_t gy, int32_t gz, int32_t ax, int32_t ay, int32_t az, uint32_t deltat_us);
+/* hand the quaternion over to a float filter for madgwick_get_rpy */
+void madgwick_fx_to_float(const MadgwickFx *filter, Madgwick *out);
+
+#endif /* _MADGWICK_FX_H */
\ No newline at end of file
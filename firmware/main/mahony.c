@@ -0,0 +1,98 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * mahony.c - Mahony's nonlinear complementary filter
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include "mahony.h"
+
+void mahony_init(Mahony *filter, float kp, float ki)
+{
+    filter->q1 = 1.0F;
+    filter->q2 = 0.0F;
+    filter->q3 = 0.0F;
+    filter->q4 = 0.0F;
+    filter->kp = kp;
+    filter->ki = ki;
+    filter->integral[0] = 0.0F;
+    filter->integral[1] = 0.0F;
+    filter->integral[2] = 0.0F;
+}
+
+void mahony_update(Mahony *filter, float gx, float gy, float gz, float ax, float ay, float az, float deltat)
+{
+    float q1 = filter->q1;
+    float q2 = filter->q2;
+    float q3 = filter->q3;
+    float q4 = filter->q4;
+    float norm = sqrtf(ax * ax + ay * ay + az * az);
+
+    /* a zero accel vector has no direction to correct towards, just integrate the gyro */
+    if (norm > 0.0F)
+    {
+        ax /= norm;
+        ay /= norm;
+        az /= norm;
+
+        /* estimated direction of gravity, the same rows the madgwick objective uses */
+        float vx = 2.0F * (q2 * q4 - q1 * q3);
+        float vy = 2.0F * (q1 * q2 + q3 * q4);
+        float vz = q1 * q1 - q2 * q2 - q3 * q3 + q4 * q4;
+
+        /* error is the cross product between measured and estimated gravity */
+        float ex = ay * vz - az * vy;
+        float ey = az * vx - ax * vz;
+        float ez = ax * vy - ay * vx;
+
+        if (filter->ki > 0.0F)
+        {
+            filter->integral[0] += filter->ki * ex * deltat;
+            filter->integral[1] += filter->ki * ey * deltat;
+            filter->integral[2] += filter->ki * ez * deltat;
+            gx += filter->integral[0];
+            gy += filter->integral[1];
+            gz += filter->integral[2];
+        }
+        gx += filter->kp * ex;
+        gy += filter->kp * ey;
+        gz += filter->kp * ez;
+    }
+
+    /* integrate the corrected rate */
+    gx *= 0.5F * deltat;
+    gy *= 0.5F * deltat;
+    gz *= 0.5F * deltat;
+    filter->q1 += -q2 * gx - q3 * gy - q4 * gz;
+    filter->q2 +=  q1 * gx + q3 * gz - q4 * gy;
+    filter->q3 +=  q1 * gy - q2 * gz + q4 * gx;
+    filter->q4 +=  q1 * gz + q2 * gy - q3 * gx;
+
+    /* normalize the quaternion */
+    norm = sqrtf(filter->q1 * filter->q1 + filter->q2 * filter->q2 + filter->q3 * filter->q3 + filter->q4 * filter->q4);
+    filter->q1 /= norm;
+    filter->q2 /= norm;
+    filter->q3 /= norm;
+    filter->q4 /= norm;
+}
\ No newline at end of file
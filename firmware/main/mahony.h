@@ -0,0 +1,44 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * mahony.h - Mahony's nonlinear complementary filter, a PI correction of the gyro rate towards the
+ * gravity direction. same quaternion convention as the madgwick filter
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _MAHONY_H
+#define _MAHONY_H
+#include <stdint.h>
+
+typedef struct {
+    float q1, q2, q3, q4;   /* quaternion components */
+    float kp;               /* proportional gain, rad/s per unit of error */
+    float ki;               /* integral gain, 0 turns the gyro bias estimate off */
+    float integral[3];      /* gyro bias estimate, rad/s */
+} Mahony;
+
+void mahony_init(Mahony *filter, float kp, float ki);
+/* gx, gy, and gz need to be in radians per second, deltat needs to be in seconds */
+void mahony_update(Mahony *filter, float gx, float gy, float gz, float ax, float ay, float az, float deltat);
+
+#endif /* _MAHONY_H */
\ No newline at end of file
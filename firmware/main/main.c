@@ -29,19 +29,27 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/gpio.h"
-#include "esp_timer.h"
 #include "esp_log.h"
+#include "esp_task_wdt.h"
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include "globals.h"
+#include "hal.h"
 #include "rgb.h"
 #include "motor.h"
 #include "imu.h"
-#include "madgwick.h"
-#include "pid.h"
+#include "calib.h"
+#include "control.h"
+#include "executive.h"
+#include "stats.h"
+#include "autotune.h"
+#include "sysid.h"
+#include "record.h"
+#include "record_flash.h"
+#include "telemetry.h"
 #include "ble.h"
+#include "boot.h"
 
 #define COLOR_SEQUENCE_SIZE      3U
 #define PI                       (3.14159265358979F)
@@ -51,128 +59,305 @@
                                                             /*         it inside the docs/ folder                                                              */
 #define BETA(x)                  (sqrtf(3.0F / 4.0F) * (x)) /* compute beta for madgwick filter >w<!! */
 
-#define DESIRED_ANGLE            (-60.0F)
 #define DEFAULT_PID_KP           (3500.0F)
 #define DEFAULT_PID_KD           (63.0F)
 #define DEFAULT_PID_KI           (10.0F)
-#define MAX_DUTY_CYCLE           (200U) /* full power!!!! :P */
+#define IMU_FIFO_WATERMARK       (5U)   /* 1 kHz ODR / 5 samples per batch -> 200 Hz interrupt and control rate */
+#define BOOT_NVS_TIMEOUT_MS      (2000U)
+#define LATENCY_REPORT_BATCHES   (1000U) /* log read + loop latency every n batches, 0 to disable */
+#define CONTROL_TASK_PRIORITY    (configMAX_PRIORITIES - 3U) /* above the nimble host and ble_task, below the ble controller */
+#define CONTROL_TASK_STACK       (4096U)
+#define CONTROL_NOTIFY_TIMEOUT_MS (20U) /* 2 ticks, 4 batches without a watermark interrupt is an imu stall */
+#define ERROR_TICK_MS            (10U)  /* led updates in the imu error loop, which has to let the idle task feed the watchdog */
 
-volatile bool imu_data_ready = false;
 volatile bool control_active = false;
+volatile bool friction_calibrate = false;
 volatile float pid_kp = DEFAULT_PID_KP;
 volatile float pid_kd = DEFAULT_PID_KD;
 volatile float pid_ki = DEFAULT_PID_KI;
 
-static void IRAM_ATTR imu_isr_handler()
+/* everything the control task touches lives here instead of on the app_main stack, which goes away after boot */
+static IMU imu = { 0 };
+static Control control = { 0 };
+static Executive executive = { 0 };
+static FrictionCal friction_cal = { 0 };
+static Morph morph = { 0 }; /* lightshow morph/blender manager for addressable LED */
+static IMUSample imu_samples[FIFO_MAX_PACKETS]; /* fifo batch, static to keep it off the task stack */
+static RGB control_sequence[COLOR_SEQUENCE_SIZE] = { { .hex = HOT_PINK },  { .hex = SORA_BLUE  }, { .hex = KUROMI_PURPLE } };
+static RGB error_sequence[COLOR_SEQUENCE_SIZE]   = { { .hex = PLAIN_RED }, { .hex = SOSO_BLACK }, { .hex = PLAIN_RED     } };
+
+/* all the isr does is wake the control task, which is in arg */
+static void IRAM_ATTR imu_isr_handler(void *arg)
 {
-    gpio_intr_disable(IMU_INT1);
-    gpio_isr_handler_remove(IMU_INT1);
-    imu_data_ready = true;
-    gpio_isr_handler_add(IMU_INT1, imu_isr_handler, NULL);
-    gpio_intr_enable(IMU_INT1);
+    BaseType_t task_woken = pdFALSE;
+    vTaskNotifyGiveFromISR((TaskHandle_t)arg, &task_woken);
+    portYIELD_FROM_ISR(task_woken);
+}
+
+/* one sense -> estimate -> control -> actuate pass per watermark interrupt, blocked the rest of the time */
+/* the executive times every stage, decides what a late or empty pass does and owns the fail-safe */
+static void control_task(void *arg)
+{
+    uint32_t notifications = 0U;
+    uint16_t sample_count = 0U;
+    uint32_t fifo_overflows = 0U;
+    uint32_t fifo_lost = 0U;
+    ExecAction action = EXEC_RUN;
+    ExecFault shown_fault = EXEC_FAULT_NONE;
+    bool was_active = false;
+    int64_t now = 0;
+    int64_t bus_wait = 0;
+    int64_t latency_sum[2U] = { 0, 0 }; /* { bus wait, interrupt to motor command } */
+    int64_t latency_max[2U] = { 0, 0 };
+    uint32_t latency_batches = 0U;
+
+    esp_task_wdt_add(NULL); /* a control task that stops coming back is worth a reset */
+
+    while (1)
+    {
+        notifications = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONTROL_NOTIFY_TIMEOUT_MS));
+        esp_task_wdt_reset();
+        exec_pass_begin(&executive);
+        stats_pass();
+
+        /* sense */
+        sample_count = 0U;
+        if (notifications > 0U)
+        {
+            STATS_BEGIN(read_start);
+            sample_count = imu_fifo_read_start(&imu, FIFO_MAX_PACKETS); /* INT1 cleared on the status read BTW :p */
+            if (sample_count > 0U)
+            {
+                STATS_BEGIN(morph_start);
+                morph_tick(&morph); /* led housekeeping runs while the fifo burst is still moving on the bus */
+                STATS_END(STATS_MORPH, morph_start);
+                STATS_BEGIN(finish_start);
+                now = hal_clock_now_us();
+                sample_count = imu_fifo_read_finish(&imu, imu_samples);
+                bus_wait = hal_clock_now_us() - now;
+                STATS_END(STATS_IMU_READ, finish_start - (morph_start - read_start)); /* start + finish, not the led work in between */
+            }
+        }
+        exec_stage_end(&executive, EXEC_STAGE_SENSE);
+        action = exec_after_sense(&executive, sample_count, IMU_FIFO_WATERMARK, imu.sample_period);
+
+        /* a recorded session starts here, before the estimate, with a snapshot of everything the replay needs */
+        record_poll(control_active, &control, &imu);
+
+        /* estimate, even on a skipped pass so the filter never loses sensor time */
+        exec_stage_begin(&executive);
+        if (action == EXEC_HOLD) { control_hold(&control, imu.sample_period * (float)IMU_FIFO_WATERMARK); }
+        else                     { control_estimate(&control, &imu, imu_samples, sample_count); }
+        exec_stage_end(&executive, EXEC_STAGE_ESTIMATE);
+
+        /* a fail-safe stays until control is switched on again over ble */
+        if (control_active && !was_active) { exec_rearm(&executive); }
+        was_active = control_active;
+
+        /* the friction calibration drives the motor itself while control is off, one ramp step per pass */
+        if (friction_calibrate && !control_active && !friction_cal_running(&friction_cal)) { friction_cal_start(&friction_cal); }
+        friction_calibrate = false;
+        if (friction_cal_running(&friction_cal) && (control_active || action == EXEC_STOP))
+        {
+            friction_cal_abort(&friction_cal);
+            ESP_LOGW("control_task", "friction calibration aborted");
+        }
+
+        /* the relay autotuner takes over from the controller while control is on, its gains wait for a confirmation */
+        float tuned[3];
+        if (autotune_poll(control_active && action != EXEC_STOP, &tuned[0], &tuned[1], &tuned[2]))
+        {
+            pid_kp = tuned[0]; /* control_compute hands them to the controller on the next pass */
+            pid_kd = tuned[1];
+            pid_ki = tuned[2];
+            ESP_LOGI("control_task", "autotuned gains in use: kp %.2f kd %.2f ki %.2f", tuned[0], tuned[1], tuned[2]);
+        }
+
+        /* a sysid capture rides on top of the controller, which keeps the robot up around the set point */
+        sysid_poll(control_active && action != EXEC_STOP && !autotune_running());
+
+        /* control + actuate */
+        if (friction_cal_running(&friction_cal))
+        {
+            if (action != EXEC_SKIP) { set_motor_command(friction_cal_step(&friction_cal, control.rate)); }
+            if (friction_cal.phase == FRICTION_CAL_DONE)
+            {
+                stop_motor();
+                friction_set(&control.friction, friction_cal.breakaway[0], friction_cal.breakaway[1]);
+                calib_request_store_motor(&control.friction); /* the record task writes it to nvs, off this pass */
+                ESP_LOGI("control_task", "friction calibration: breakaway %.1f / %.1f counts", friction_cal.breakaway[0], friction_cal.breakaway[1]);
+            }
+            else if (friction_cal.phase == FRICTION_CAL_FAILED)
+            {
+                stop_motor();
+                ESP_LOGW("control_task", "friction calibration failed, the wheel never moved the body");
+            }
+        }
+        else if (!control_active || action == EXEC_STOP || action == EXEC_SKIP)
+        {
+            if (action != EXEC_SKIP) { control_stop(&control); }
+        }
+        else
+        {
+            exec_stage_begin(&executive);
+            bool computed = control_compute(&control, pid_kp, pid_kd, pid_ki);
+            if (computed && autotune_running())
+            {
+                control.command = autotune_step(control.error, control.rate, control.step);
+                if (!autotune_running()) { control_restart(&control); } /* the controller carries on from the balance point */
+            }
+            else if (computed && sysid_capturing()) { control.command += sysid_excitation(control.step); }
+            exec_stage_end(&executive, EXEC_STAGE_CONTROL);
+            if (computed && exec_check_fall(&executive, control.error) != EXEC_STOP)
+            {
+                exec_stage_begin(&executive);
+                control_actuate(&control);
+                exec_stage_end(&executive, EXEC_STAGE_ACTUATE);
+            }
+        }
+        exec_pass_end(&executive);
+
+        /* telemetry: raw copies into the ring, the ble host task packs and sends them */
+        STATS_BEGIN(telemetry_start);
+        uint8_t flags = 0U;
+        if (control_active)                                                   { flags |= TELEMETRY_FLAG_ACTIVE; }
+        if (fabsf(control.command) >= (float)CONTROL_MAX_DUTY_CYCLE)          { flags |= TELEMETRY_FLAG_SATURATED; }
+        if (action == EXEC_HOLD)                                              { flags |= TELEMETRY_FLAG_HOLD; }
+        if (action == EXEC_STOP || executive.fault != EXEC_FAULT_NONE)        { flags |= TELEMETRY_FLAG_STOP; }
+        if (autotune_running())                                               { flags |= TELEMETRY_FLAG_AUTOTUNE; }
+        if (sysid_capturing())                                                { flags |= TELEMETRY_FLAG_SYSID; }
+        if (record_phase() == RECORD_RECORDING)                               { flags |= TELEMETRY_FLAG_RECORDING; }
+        if (friction_cal_running(&friction_cal))                              { flags |= TELEMETRY_FLAG_FRICTION; }
+        telemetry_push((uint32_t)executive.pass_start, control.setpoint - control.error, control.rate, control.command, control.applied, flags);
+        STATS_END(STATS_TELEMETRY, telemetry_start);
+
+        if (executive.fault != shown_fault)
+        {
+            shown_fault = executive.fault;
+            if (shown_fault != EXEC_FAULT_NONE) { morph_set_sequence(&morph, error_sequence, COLOR_SEQUENCE_SIZE, 2000); }
+            else                                { morph_set_sequence(&morph, control_sequence, COLOR_SEQUENCE_SIZE, 2000); }
+        }
+        if (sample_count == 0U) { morph_tick(&morph); continue; }
+
+        /* anything beyond one watermark worth of samples waited for a pass that didn't happen in time */
+        if (sample_count > IMU_FIFO_WATERMARK) { control.missed_samples += sample_count - IMU_FIFO_WATERMARK; }
+        control.missed_samples += imu.fifo_lost_packets - fifo_lost;
+        fifo_lost = imu.fifo_lost_packets;
+        if (imu.fifo_overflows != fifo_overflows)
+        {
+            fifo_overflows = imu.fifo_overflows;
+            ESP_LOGW("control_task", "IMU FIFO overflow #%lu, %lu packets lost so far", (unsigned long)imu.fifo_overflows, (unsigned long)imu.fifo_lost_packets);
+        }
+
+        if (LATENCY_REPORT_BATCHES > 0U)
+        {
+            now = hal_clock_now_us() - executive.pass_start;
+            latency_sum[0] += bus_wait;
+            latency_sum[1] += now;
+            if (bus_wait > latency_max[0]) { latency_max[0] = bus_wait; }
+            if (now > latency_max[1]) { latency_max[1] = now; }
+            bus_wait = 0;
+            if (++latency_batches >= LATENCY_REPORT_BATCHES)
+            {
+                ESP_LOGI("control_task", "bus wait avg %lld us max %lld us, loop latency avg %lld us max %lld us",
+                         (long long)(latency_sum[0] / latency_batches), (long long)latency_max[0],
+                         (long long)(latency_sum[1] / latency_batches), (long long)latency_max[1]);
+                ESP_LOGI("control_task", "sample period jitter %.2f us (max %.2f us), %lu outliers, %lu missed samples",
+                         timebase_jitter(&control.timebase) * 1000000.0F, control.timebase.jitter_max * 1000000.0F,
+                         (unsigned long)control.timebase.outliers, (unsigned long)control.missed_samples);
+                ESP_LOGI("control_task", "deadline misses %lu, skipped %lu, held %lu, stops %lu, overruns %lu/%lu/%lu/%lu",
+                         (unsigned long)executive.deadline_misses, (unsigned long)executive.skipped, (unsigned long)executive.held,
+                         (unsigned long)executive.stops, (unsigned long)executive.overruns[EXEC_STAGE_SENSE],
+                         (unsigned long)executive.overruns[EXEC_STAGE_ESTIMATE], (unsigned long)executive.overruns[EXEC_STAGE_CONTROL],
+                         (unsigned long)executive.overruns[EXEC_STAGE_ACTUATE]);
+                timebase_reset_stats(&control.timebase);
+                latency_sum[0] = latency_sum[1] = latency_max[0] = latency_max[1] = 0;
+                latency_batches = 0U;
+            }
+        }
+    }
 }
 
 void app_main(void)
 {
+    boot_init();
+    boot_mark("app_main");
 
     /* sadly esp32c3 is single core so we need to do this in a different thread rather than a different core */
     /* might have some impact on active control?? need to stress test the app i guess */
+    /* the ble task also brings up the non volatile storage and flags BOOT_NVS_READY, so it runs in parallel with */
+    /* the peripheral and imu bring-up below until the stored calibration is needed */
     xTaskCreate((TaskFunction_t)ble_task, "ble_task", 4096, NULL, 1, NULL); /* start BLE task */
 
     /* set up color sequences for rgb led */
     RGB setup_state = { .hex = SUNSET_ORANGE };
-    RGB control_sequence[COLOR_SEQUENCE_SIZE] = { { .hex = HOT_PINK },  { .hex = SORA_BLUE  }, { .hex = KUROMI_PURPLE } };
-    RGB error_sequence[COLOR_SEQUENCE_SIZE]   = { { .hex = PLAIN_RED }, { .hex = SOSO_BLACK }, { .hex = PLAIN_RED     } };
-    Morph morph = { 0 }; /* lightshow morph/blender manager for addressable LED */
-    IMU imu = { 0 };
-    Madgwick filter = { 0 };
-    PID controller = { 0 };
-    float control_signal = 0.0F;
-    float deltat = 0.0F;
-    int64_t now = 0.0F;
-    uint8_t duty_cycle = 0U;
-
-    pid_init(&controller, pid_kp, pid_kd, pid_ki);
+    TaskHandle_t control_handle = NULL;
 
     /* initialize peripherals */
     init_rmt();
     set_led_rgb(setup_state); /* init state */
+    boot_mark("led");
     init_pwm();
+    boot_mark("pwm");
     init_i2c();
-    vTaskDelay(1000U / portTICK_PERIOD_MS);
+    boot_mark("i2c");
 
     setup_state.hex = EVA_GREEN;
     set_led_rgb(setup_state); /* imu config state */
 
-    /* check imu presence */
-    uint8_t imu_id = imu_get_id();
-    if (imu_id != ICM42688_ID)
+    /* check imu presence, polling until it answers instead of sleeping a fixed time */
+    if (!imu_wait_ready(IMU_READY_TIMEOUT_MS))
     { 
+        uint8_t imu_id = imu_get_id();
         ESP_LOGE("main", "Critical error: IMU not connected or bad response. IMU_ID from response: 0x%X, should be 0x%X.", imu_id, ICM42688_ID);
         morph_set_sequence(&morph, error_sequence, COLOR_SEQUENCE_SIZE, 2000);
-        while(1) { morph_tick(&morph); } /* show error sequence on led */
+        while(1) { morph_tick(&morph); hal_delay_ms(ERROR_TICK_MS); } /* show error sequence on led */
     }
-    /* initialize imu struct + basic device config */
-    imu_init(&imu, AFS_2G, GFS_500DPS, AODR_200Hz, GODR_200Hz, aMode_LN, gMode_LN, false);
-    /* not necessary but helps with accuracy, the bias calculation can be commented out */
-    ESP_LOGI("main", "CALCULATING ACCELEROMETER AND GYROSCOPE BIAS");
-    ESP_LOGI("main", "KEEP DEVICE FLAT AND STABLE RELATIVE TO ONE AXIS ONLY");
-    vTaskDelay(1000U / portTICK_PERIOD_MS);
-    imu_calculate_bias(&imu);
-    madgwick_init(&filter, BETA(GYRO_MEASURE_ERROR));
-
-    /* configure IMU_INT1 pin for data ready interrupts coming from imu */
-    gpio_reset_pin(IMU_INT1);
-    gpio_set_direction(IMU_INT1, GPIO_MODE_INPUT);
-    gpio_pullup_dis(IMU_INT1);
-    gpio_pulldown_en(IMU_INT1);
-    gpio_set_intr_type(IMU_INT1, GPIO_INTR_POSEDGE);
-    gpio_install_isr_service(0U);
-    gpio_isr_handler_add(IMU_INT1, imu_isr_handler, NULL);
-    gpio_intr_enable(IMU_INT1);
-
-    /* set lightshow to signal user control is active */
-    morph_set_sequence(&morph, control_sequence, COLOR_SEQUENCE_SIZE, 2000);
-
-    while (1)
+    /* initialize imu struct + basic device config, the self-test result comes from the stored calibration if there is one */
+    boot_mark("imu probe");
+    imu_init(&imu, AFS_2G, GFS_500DPS, AODR_1kHz, GODR_1kHz, aMode_LN, gMode_LN, false, false);
+    boot_mark("imu init");
+    if (!boot_wait_ready(BOOT_NVS_READY, BOOT_NVS_TIMEOUT_MS)) { ESP_LOGW("main", "NVS not ready, stored calibration unavailable"); }
+    /* reuse the stored calibration unless the biases drifted away from it, which takes ~100 ms instead of seconds */
+    if (calib_load(&imu) == ESP_OK && calib_check(&imu))
     {
-        if (imu_data_ready)
-        {
-            imu_data_ready = false;
-            imu_read(&imu); /* INT1 cleared on any read BTW :p */
-            now = esp_timer_get_time();
-            deltat = ((float)(now - filter.last_update)) / 1000000.0F; /* calculate deltat and convert from us to s */
-            filter.last_update = now;
-            /* inputs flipped and fixed signs given the actual orientation of the imu on the board */
-            madgwick_update(&filter, (imu.gy*PI/180.0F), (imu.gx*PI/180.0F), -(imu.gz*PI/180.0F), imu.ay, imu.ax, -imu.az, deltat);
-        }
-        madgwick_get_rpy(&filter);
-        ESP_LOGD("main", "R: %03.2f,\tP: %03.2f,\tY: %03.2f", filter.roll, filter.pitch, filter.yaw);
+        ESP_LOGI("main", "Using stored IMU calibration");
+    }
+    else if (control_tracks_gyro_bias())
+    {
+        /* the estimator keeps up with the gyro bias on its own so there is no need to hold still, reset + self-test only. */
+        /* accel bias stays 0 and nothing gets stored, the next boot without this estimator still calibrates */
+        imu_init(&imu, AFS_2G, GFS_500DPS, AODR_1kHz, GODR_1kHz, aMode_LN, gMode_LN, false, true);
+        ESP_LOGI("main", "No stored IMU calibration, the %s estimator tracks the gyro bias", estimator_name(CONTROL_ESTIMATOR));
+    }
+    else
+    {
+        /* full calibration: reset + self-test, then the biases at the full ODR, and remember them for the next boot */
+        imu_init(&imu, AFS_2G, GFS_500DPS, AODR_1kHz, GODR_1kHz, aMode_LN, gMode_LN, false, true);
+        ESP_LOGI("main", "CALCULATING ACCELEROMETER AND GYROSCOPE BIAS");
+        ESP_LOGI("main", "KEEP DEVICE FLAT AND STABLE RELATIVE TO ONE AXIS ONLY");
+        vTaskDelay(1000U / portTICK_PERIOD_MS);
+        imu_calculate_bias(&imu);
+        calib_store(&imu);
+    }
+    boot_mark("imu calibration");
+    control_init(&control, BETA(GYRO_MEASURE_ERROR), imu.sample_period, CONTROL_DESIRED_ANGLE);
+    calib_load_motor(&control.friction); /* uncompensated until the friction calibration ran once */
+    stats_init();
+    ExecConfig exec_config;
+    exec_default_config(&exec_config, (int64_t)(imu.sample_period * 1000000.0F) * IMU_FIFO_WATERMARK);
+    exec_init(&executive, &exec_config);
 
-        /* controller */
-        /* pid control to make pitch = ~-60 degrees */
-        if (control_active)
-        {
-            pid_update_consts(&controller, pid_kp, pid_kd, pid_ki); /* update constants from the BLE service */
-            now = esp_timer_get_time();
-            deltat = ((float)(now - controller.last_update)) / 1000000.0F;
-            controller.last_update = now;
-            control_signal = pid_compute(&controller, DESIRED_ANGLE, filter.pitch, deltat);
-            ESP_LOGD("main", "control_signal = %f", control_signal);
-
-            if (control_signal > 0.0F)
-            {
-                duty_cycle = (uint8_t)(control_signal > (float)MAX_DUTY_CYCLE ? MAX_DUTY_CYCLE : control_signal);
-                set_motor_pwm(duty_cycle, 0U);
-            }
-            else
-            {
-                duty_cycle = (uint8_t)(-control_signal > (float)MAX_DUTY_CYCLE ? MAX_DUTY_CYCLE : -control_signal);
-                set_motor_pwm(0U, duty_cycle);
-            }
-        } else { set_motor_pwm(0U, 0U); }
+    /* set lightshow to signal user control is active, the control task ticks it from now on */
+    morph_set_sequence(&morph, control_sequence, COLOR_SEQUENCE_SIZE, 2000);
+    xTaskCreate(control_task, "control_task", CONTROL_TASK_STACK, NULL, CONTROL_TASK_PRIORITY, &control_handle);
+    xTaskCreate(record_flash_task, "record_task", RECORD_FLASH_TASK_STACK, NULL, RECORD_FLASH_TASK_PRIORITY, NULL);
 
-        
-        morph_tick(&morph);
-    }
+    /* configure IMU_INT1 pin for fifo watermark interrupts coming from imu, they notify the control task */
+    hal_gpio_irq_init(IMU_INT1, imu_isr_handler, control_handle);
+    imu_fifo_enable(&imu, IMU_FIFO_WATERMARK); /* interrupts now come from the fifo watermark instead of data ready */
+    boot_set_ready(BOOT_IMU_READY);
+    boot_mark("control ready");
+    boot_report();
+    /* app_main returning just deletes the main task, control and ble carry on in their own tasks */
 }
\ No newline at end of file
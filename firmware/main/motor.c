@@ -25,81 +25,100 @@
  * SOFTWARE.
  */
 
-#include "driver/ledc.h"
 #include "esp_log.h"
+#include "hal.h"
 #include "motor.h"
 
-void init_pwm(void)
+typedef struct {
+    uint32_t frequency;
+    uint8_t resolution_bits;
+} ProfileConfig;
+
+static const ProfileConfig profiles[MOTOR_PROFILE_COUNT] = {
+    [MOTOR_PROFILE_8BIT_250KHZ] = { 250000U, 8U },
+    [MOTOR_PROFILE_10BIT_62KHZ] = { 62500U, 10U },
+    [MOTOR_PROFILE_12BIT_19KHZ] = { 19000U, 12U },
+};
+
+static MotorDecay decay_mode = MOTOR_DECAY;
+static uint32_t full_duty = 255U;           /* 2^resolution - 1 of the profile in use */
+static float counts_per_command = 1.0F;     /* profile counts per 8-bit count */
+static uint32_t channel_duty[HAL_PWM_MAX_CHANNELS];
+static MotorStats stats;
+
+/* callers hold the critical section, the hang alarm's stop_motor can land in the middle of the control task's write */
+static HAL_IRAM_ATTR void write_channel(uint8_t channel, uint32_t duty)
 {
-    /* configure PWM timer */
-    ledc_timer_config_t timer_config = {
-        .speed_mode = LEDC_SPEED_MODE,
-        .duty_resolution = PWM_DUTY_RESOLUTION,
-        .timer_num = LEDC_TIMER,
-        .freq_hz = PWM_FREQUENCY,
-        .clk_cfg = LEDC_AUTO_CLK
-    };
+    if (channel_duty[channel] == duty) { stats.skipped++; return; }
+    channel_duty[channel] = duty;
+    hal_pwm_set_fast(channel, duty);
+    stats.writes++;
+}
 
-    esp_err_t err = ledc_timer_config(&timer_config);
-    if (err != ESP_OK)
+bool motor_set_profile(MotorProfile profile)
+{
+    if (profile >= MOTOR_PROFILE_COUNT) { return false; }
+    const ProfileConfig *config = &profiles[profile];
+
+    /* channels share the timer, both get set up again and start from 0 */
+    if (!hal_pwm_init(PWM_IN1_CHANNEL, IN1_GPIO_PIN, config->frequency, config->resolution_bits))
     {
-        ESP_LOGE("init_pwm", "Timer config failed: %d", err);
+        ESP_LOGE("motor_set_profile", "IN1 channel config failed");
+        return false;
     }
-
-    /* configure PWM channel for IN1 */
-    ledc_channel_config_t channel_in1 = {
-        .gpio_num = IN1_GPIO_PIN,
-        .speed_mode = LEDC_SPEED_MODE,
-        .channel = LEDC_IN1_CHANNEL,
-        .timer_sel = LEDC_TIMER,
-        .duty = 0U, /* start with 0% duty cycle */
-        .hpoint = 0U
-    };
-
-    err = ledc_channel_config(&channel_in1);
-    if (err != ESP_OK)
+    if (!hal_pwm_init(PWM_IN2_CHANNEL, IN2_GPIO_PIN, config->frequency, config->resolution_bits))
     {
-        ESP_LOGE("init_pwm", "IN1 channel config failed: %d", err);
+        ESP_LOGE("motor_set_profile", "IN2 channel config failed");
+        return false;
     }
+    full_duty = (1U << config->resolution_bits) - 1U;
+    counts_per_command = (float)full_duty / MOTOR_COMMAND_FULL_SCALE;
+    channel_duty[PWM_IN1_CHANNEL] = 0U;
+    channel_duty[PWM_IN2_CHANNEL] = 0U;
+    return true;
+}
 
-    /* configure PWM channel for IN2 */
-    ledc_channel_config_t channel_in2 = {
-        .gpio_num = IN2_GPIO_PIN,
-        .speed_mode = LEDC_SPEED_MODE,
-        .channel = LEDC_IN2_CHANNEL,
-        .timer_sel = LEDC_TIMER,
-        .duty = 0U, /* start with 0% duty cycle */
-        .hpoint = 0U
-    };
+void init_pwm(void)
+{
+    motor_set_decay(MOTOR_DECAY);
+    motor_set_profile(MOTOR_PROFILE);
+}
 
-    err = ledc_channel_config(&channel_in2);
-    if (err != ESP_OK)
-    {
-        ESP_LOGE("init_pwm", "IN2 channel config failed: %d", err);
-    }
+void motor_set_decay(MotorDecay decay)
+{
+    decay_mode = decay;
 }
 
-void set_motor_pwm(uint8_t duty_cycle_in1, uint8_t duty_cycle_in2)
+HAL_IRAM_ATTR void set_motor_duty(int32_t duty)
 {
-    /* set duty cycle for IN1 */
-    esp_err_t err = ledc_set_duty(LEDC_SPEED_MODE, LEDC_IN1_CHANNEL, (uint32_t)duty_cycle_in1);
-    if (err == ESP_OK)
-    {
-        ledc_update_duty(LEDC_SPEED_MODE, LEDC_IN1_CHANNEL);
-    }
-    else
-    {
-        ESP_LOGE("set_motor_pwm", "Failed to set IN1 duty: %d", err);
-    }
+    uint32_t magnitude = (uint32_t)((duty < 0) ? -duty : duty);
+    if (magnitude > full_duty) { magnitude = full_duty; }
 
-    /* set duty cycle for IN2 */
-    err = ledc_set_duty(LEDC_SPEED_MODE, LEDC_IN2_CHANNEL, (uint32_t)duty_cycle_in2);
-    if (err == ESP_OK)
-    {
-        ledc_update_duty(LEDC_SPEED_MODE, LEDC_IN2_CHANNEL);
-    }
-    else
-    {
-        ESP_LOGE("set_motor_pwm", "Failed to set IN2 duty: %d", err);
-    }
+    /* coast pulses the driven input with the other one low. brake keeps the driven input high and pulses the */
+    /* other one low instead, both high is the brake state */
+    uint32_t driven = (decay_mode == MOTOR_DECAY_BRAKE) ? full_duty : magnitude;
+    uint32_t other = (decay_mode == MOTOR_DECAY_BRAKE) ? full_duty - magnitude : 0U;
+    hal_critical_enter();
+    write_channel(PWM_IN1_CHANNEL, (duty >= 0) ? driven : other);
+    write_channel(PWM_IN2_CHANNEL, (duty >= 0) ? other : driven);
+    hal_critical_exit();
+}
+
+void set_motor_command(float command)
+{
+    float counts = command * counts_per_command;
+    set_motor_duty((int32_t)(counts + ((counts >= 0.0F) ? 0.5F : -0.5F)));
+}
+
+HAL_IRAM_ATTR void stop_motor(void)
+{
+    hal_critical_enter();
+    write_channel(PWM_IN1_CHANNEL, 0U);
+    write_channel(PWM_IN2_CHANNEL, 0U);
+    hal_critical_exit();
+}
+
+const MotorStats *motor_stats(void)
+{
+    return &stats;
 }
\ No newline at end of file
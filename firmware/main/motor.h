@@ -28,18 +28,52 @@
 #ifndef _MOTOR_H
 #define _MOTOR_H
 #include <stdint.h>
+#include <stdbool.h>
 
-#define IN1_GPIO_PIN          GPIO_NUM_3
-#define IN2_GPIO_PIN          GPIO_NUM_4
-#define PWM_FREQUENCY         250000U          /* 250 kHz */
-#define PWM_DUTY_RESOLUTION   LEDC_TIMER_8_BIT /* 8-bit resolution (0-255 duty cycle) */
+#define IN1_GPIO_PIN          3U               /* GPIO_NUM_3 */
+#define IN2_GPIO_PIN          4U               /* GPIO_NUM_4 */
 
-#define LEDC_IN1_CHANNEL      LEDC_CHANNEL_0
-#define LEDC_IN2_CHANNEL      LEDC_CHANNEL_1
-#define LEDC_TIMER            LEDC_TIMER_0
-#define LEDC_SPEED_MODE       LEDC_LOW_SPEED_MODE /* this is the only available speed mode for the esp32c3 */
+#define PWM_IN1_CHANNEL       0U
+#define PWM_IN2_CHANNEL       1U
 
+/* commands are in counts of the original 8-bit pwm whatever the profile, so the gains don't depend on it */
+#define MOTOR_COMMAND_FULL_SCALE  (255.0F)
+
+/* the ledc runs off the 80 MHz APB clock, frequency * 2^resolution can't go past that */
+typedef enum {
+    MOTOR_PROFILE_8BIT_250KHZ = 0,   /* the original one */
+    MOTOR_PROFILE_10BIT_62KHZ,
+    MOTOR_PROFILE_12BIT_19KHZ,       /* finest steps, right at the edge of hearing */
+    MOTOR_PROFILE_COUNT
+} MotorProfile;
+
+typedef enum {
+    MOTOR_DECAY_COAST = 0,  /* pwm one input, the other low: the current decays through the body diodes, fast */
+    MOTOR_DECAY_BRAKE,      /* other input high, inverted pwm: the bridge shorts the winding between pulses, slow */
+} MotorDecay;
+
+#ifndef MOTOR_PROFILE
+#define MOTOR_PROFILE         MOTOR_PROFILE_10BIT_62KHZ
+#endif
+#ifndef MOTOR_DECAY
+#define MOTOR_DECAY           MOTOR_DECAY_COAST
+#endif
+
+typedef struct {
+    uint32_t writes;        /* channel writes that reached the ledc */
+    uint32_t skipped;       /* channel writes saved because the duty didn't change */
+} MotorStats;
+
+/* sets up both channels with MOTOR_PROFILE and MOTOR_DECAY */
 void init_pwm(void);
-void set_motor_pwm(uint8_t duty_cycle_in1, uint8_t duty_cycle_in2);
+bool motor_set_profile(MotorProfile profile);
+void motor_set_decay(MotorDecay decay);
+/* signed command, positive drives IN1, clamped to full scale. only writes the channels whose duty changed */
+void set_motor_command(float command);
+/* same in counts of the profile's resolution, no floats, safe from an isr or with the flash cache off */
+void set_motor_duty(int32_t duty);
+/* both inputs low whatever the decay mode, the motor coasts. safe from an isr too */
+void stop_motor(void);
+const MotorStats *motor_stats(void);
 
 #endif /* _MOTOR_H */
\ No newline at end of file
@@ -0,0 +1,86 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * mpc.c - explicit model predictive balance controller, laws and terms from host/tools/mpc_synth.c
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mpc.h"
+
+static const MpcLaw mpc_laws[MPC_LAW_COUNT] = MPC_LAWS;
+static const uint32_t mpc_terms[MPC_TERM_COUNT] = MPC_TERMS;
+static const float mpc_wheel_a[MPC_STATES] = MPC_WHEEL_A;
+
+void mpc_init(MPC *controller, float out_min, float out_max)
+{
+    controller->out_min = out_min;
+    controller->out_max = out_max;
+    mpc_reset(controller);
+}
+
+void mpc_reset(MPC *controller)
+{
+    controller->wheel_speed = 0.0F;
+    controller->integral = 0.0F;
+    controller->output = 0.0F;
+    controller->saturated = false;
+}
+
+float mpc_step(MPC *controller, float error, float rate, float deltat)
+{
+    float x[MPC_STATES] = { -error, rate, controller->wheel_speed, controller->integral };
+    float law[MPC_LAW_COUNT];
+
+    for (int i = 0; i < MPC_LAW_COUNT; i++)
+    {
+        law[i] = mpc_laws[i].offset;
+        for (int j = 0; j < MPC_STATES; j++) { law[i] += mpc_laws[i].k[j] * x[j]; }
+    }
+    /* lattice form: max over the terms of the min over the laws in each term, starting at the limits clamps on the way */
+    float unclamped = -MPC_MAX_DUTY;
+    for (int t = 0; t < MPC_TERM_COUNT; t++)
+    {
+        float lowest = MPC_MAX_DUTY;
+        for (int i = 0; i < MPC_LAW_COUNT; i++)
+        {
+            if ((mpc_terms[t] & (1U << i)) && law[i] < lowest) { lowest = law[i]; }
+        }
+        if (lowest > unclamped) { unclamped = lowest; }
+    }
+
+    float output = unclamped;
+    if (output > controller->out_max) { output = controller->out_max; }
+    if (output < controller->out_min) { output = controller->out_min; }
+    controller->saturated = (output != unclamped);
+
+    /* predict the wheel with the duty that actually went out, scaled when a batch came late or early */
+    float predicted = MPC_WHEEL_B * output;
+    for (int i = 0; i < MPC_STATES; i++) { predicted += mpc_wheel_a[i] * x[i]; }
+    controller->wheel_speed += (predicted - controller->wheel_speed) * (deltat / MPC_PERIOD);
+
+    /* the mpc plans around the limit on its own, only the integral can still wind up against it */
+    if (output > controller->out_min && output < controller->out_max) { controller->integral = controller->integral * MPC_INTEGRAL_DECAY - error * deltat; }
+
+    controller->output = output;
+    return output;
+}
\ No newline at end of file
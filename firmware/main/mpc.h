@@ -0,0 +1,57 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * mpc.h - explicit model predictive balance controller. the constrained problem is solved offline by
+ * host/tools/mpc_synth.c, here it is a handful of affine laws combined with min and max, no qp online
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _MPC_H
+#define _MPC_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "mpc_regions.h"
+
+typedef struct {
+    float k[MPC_STATES];
+    float offset;
+} MpcLaw;
+
+typedef struct {
+    float out_min;
+    float out_max;
+    /* state */
+    float wheel_speed;            /* rad/s, predicted from the duty sent, there is no encoder */
+    float integral;               /* leaky integral of pitch - balance, deg s */
+    float output;                 /* last output, after the limits */
+    bool saturated;
+} MPC;
+
+void mpc_init(MPC *controller, float out_min, float out_max);
+/* start over with the wheel stopped, e.g. after the motor was off */
+void mpc_reset(MPC *controller);
+/* error = set point - pitch in degrees, rate = pitch rate from the gyro in dps. same signs as pid2_step */
+/* MPC_LAW_COUNT * MPC_STATES multiply-adds and MPC_TERM_COUNT * MPC_LAW_COUNT compares, whatever the state */
+float mpc_step(MPC *controller, float error, float rate, float deltat);
+
+#endif /* _MPC_H */
\ No newline at end of file
@@ -0,0 +1,34 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * mpc_regions.h - generated by host/tools/mpc_synth.c, don't edit, run it again
+ * mass 0.3 kg, com 0.05 m, inertia 0.0012 kgm2, wheel inertia 1.5e-05 kgm2, kt 0.005, ke 0.005, resistance 2 ohm, vbat 3.7 V
+ * period 0.005 s, leak 2 s, q 100,1,0.0001,10, r 0.0001
+ * horizon 10, max duty 200, sampled over 3 deg, 90 dps, 400 rad/s, 2 deg s, 23 regions
+ * first move against the qp: rms 0.003 max 1.244 duty counts
+ */
+
+#ifndef _MPC_REGIONS_H
+#define _MPC_REGIONS_H
+
+#define MPC_STATES    4
+#define MPC_PERIOD    (0.00500000F) /* seconds */
+#define MPC_MAX_DUTY  (200.000F)
+/* x = [pitch - balance (deg), pitch rate (dps), wheel speed (rad/s), integral of pitch - balance (deg s)] */
+#define MPC_WHEEL_A   { 0.0106803214F, 2.67127455e-05F, 0.995790110F, 0.00000000F }
+#define MPC_WHEEL_B   (0.0122169361F)
+#define MPC_INTEGRAL_DECAY (0.997500000F)
+
+/* { { k }, offset }: duty = k x + offset */
+#define MPC_LAW_COUNT 5
+#define MPC_LAWS      { \
+    { { 0.00000000F, 0.00000000F, 0.00000000F, 0.00000000F }, 200.000000F }, \
+    { { -170.474883F, -15.4305354F, 1.34028053F, -0.0602994630F }, -0.00000000F }, \
+    { { 0.00000000F, 0.00000000F, 0.00000000F, 0.00000000F }, -200.000000F }, \
+    { { -206.802002F, -18.7142354F, 1.55356506F, -0.0656400354F }, -70.2017186F }, \
+    { { -206.802002F, -18.7142354F, 1.55356506F, -0.0656400354F }, 70.2017186F }, \
+}
+/* duty = max over the terms of the min over the laws whose bit is set */
+#define MPC_TERM_COUNT 3
+#define MPC_TERMS     { 0x00000013U, 0x00000005U, 0x00000019U }
+
+#endif /* _MPC_REGIONS_H */
\ No newline at end of file
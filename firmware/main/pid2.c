@@ -0,0 +1,127 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * pid2.c - discrete pid controller, second take
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include "pid2.h"
+
+static void compute_coefficients(PID2 *controller)
+{
+    float period = controller->period;
+
+    controller->ci = controller->ki * period;
+    controller->cd = (controller->derivative_tf > 0.0F) ? period / (controller->derivative_tf + period) : 1.0F;
+
+    /* tracking time after astrom & hagglund, sqrt(Ti * Td), or Ti without a D term */
+    controller->ct = 0.0F;
+    if (controller->ki > 0.0F)
+    {
+        float tracking = (controller->kd > 0.0F) ? sqrtf(controller->kd / controller->ki) : controller->kp / controller->ki;
+        controller->ct = (tracking > period) ? period / tracking : 1.0F;
+    }
+}
+
+static float clamp(const PID2 *controller, float value)
+{
+    if (value > controller->out_max) { return controller->out_max; }
+    if (value < controller->out_min) { return controller->out_min; }
+    return value;
+}
+
+void pid2_init(PID2 *controller, float out_min, float out_max, float period, PID2Windup windup)
+{
+    controller->kp = 0.0F;
+    controller->ki = 0.0F;
+    controller->kd = 0.0F;
+    controller->period = period;
+    controller->derivative_tf = 0.0F;
+    controller->out_min = out_min;
+    controller->out_max = out_max;
+    controller->windup = windup;
+    compute_coefficients(controller);
+    pid2_reset(controller, 0.0F);
+}
+
+void pid2_set_gains(PID2 *controller, float kp, float kd, float ki)
+{
+    if (kp == controller->kp && kd == controller->kd && ki == controller->ki) { return; }
+
+    /* move the difference of the P and D terms into the integral so the output stays where it was */
+    controller->integral += (controller->kp - kp) * controller->error - (controller->kd - kd) * controller->rate;
+    controller->integral = clamp(controller, controller->integral);
+    controller->kp = kp;
+    controller->kd = kd;
+    controller->ki = ki;
+    compute_coefficients(controller);
+}
+
+void pid2_set_period(PID2 *controller, float period)
+{
+    controller->period = period;
+    compute_coefficients(controller);
+}
+
+void pid2_set_derivative_filter(PID2 *controller, float tf)
+{
+    controller->derivative_tf = tf;
+    compute_coefficients(controller);
+}
+
+void pid2_reset(PID2 *controller, float output)
+{
+    controller->integral = clamp(controller, output);
+    controller->rate = 0.0F;
+    controller->error = 0.0F;
+    controller->output = controller->integral;
+    controller->saturated = false;
+}
+
+float pid2_step(PID2 *controller, float error, float rate, float deltat)
+{
+    if (fabsf(deltat - controller->period) > PID2_PERIOD_TOLERANCE * controller->period) { pid2_set_period(controller, deltat); }
+
+    controller->rate += controller->cd * (rate - controller->rate);
+    controller->error = error;
+
+    /* derivative on the measurement: no kick when the set point moves, and the gyro is cleaner than a differentiated angle */
+    float unclamped = controller->kp * error + controller->integral - controller->kd * controller->rate;
+    float output = clamp(controller, unclamped);
+    controller->saturated = (output != unclamped);
+
+    if (controller->windup == PID2_WINDUP_BACK_CALCULATION)
+    {
+        controller->integral += controller->ci * error + controller->ct * (output - unclamped);
+    }
+    else if (!controller->saturated || (unclamped > output) != (error > 0.0F))
+    {
+        controller->integral += controller->ci * error;
+    }
+    /* the integral alone never needs more than the whole output range */
+    controller->integral = clamp(controller, controller->integral);
+
+    controller->output = output;
+    return output;
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * pid2.h - discrete pid controller, second take. coefficients precomputed for the sample period,
+ * derivative on the measured rate, output limits with anti-windup and bumpless gain changes
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _PID2_H
+#define _PID2_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PID2_PERIOD_TOLERANCE    (0.1F) /* coefficients get recomputed when deltat moves further than this from the period */
+
+typedef enum {
+    PID2_WINDUP_CONDITIONAL = 0,   /* stop integrating while saturated and the error pushes further into it */
+    PID2_WINDUP_BACK_CALCULATION,  /* bleed the integral by how far the output got clipped */
+} PID2Windup;
+
+typedef struct {
+    float kp;
+    float ki;
+    float kd;
+    float period;           /* seconds the coefficients below were made for */
+    float derivative_tf;    /* seconds, first order filter on the rate, 0 for none */
+    float out_min;
+    float out_max;
+    PID2Windup windup;
+    /* discrete coefficients */
+    float ci;               /* ki * T */
+    float ct;               /* T / tracking time, back calculation only */
+    float cd;               /* T / (Tf + T), 1 without a filter */
+    /* state */
+    float integral;         /* in output units, so changing ki doesn't move the output */
+    float rate;             /* filtered measured rate */
+    float error;            /* last error, for bumpless kp changes */
+    float output;           /* last output, after the limits */
+    bool saturated;
+} PID2;
+
+void pid2_init(PID2 *controller, float out_min, float out_max, float period, PID2Windup windup);
+/* takes effect without a step in the output, does nothing if the gains didn't change */
+void pid2_set_gains(PID2 *controller, float kp, float kd, float ki);
+void pid2_set_period(PID2 *controller, float period);
+void pid2_set_derivative_filter(PID2 *controller, float tf);
+/* start over from output, e.g. 0 after the motor was off */
+void pid2_reset(PID2 *controller, float output);
+/* error = set point - measured, rate = d(measured)/dt from the gyro. no divisions unless deltat is far off the period */
+float pid2_step(PID2 *controller, float error, float rate, float deltat);
+
+#endif /* _PID2_H */
\ No newline at end of file
@@ -0,0 +1,72 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * pid_fx.c - fixed-point pid controller
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pid_fx.h"
+
+#define FX_ONE          ((float)(1 << PID_FX_Q))
+#define US_TO_Q28       (4503599627ULL) /* 2^28 / 10^6 in Q24, deltat_us * this >> 24 is seconds in Q28 */
+
+void pid_fx_init(PidFx *controller, float kp, float kd, float ki)
+{
+    controller->integral = 0;
+    controller->prev_err = 0;
+    pid_fx_update_consts(controller, kp, kd, ki);
+}
+
+void pid_fx_update_consts(PidFx *controller, float kp, float kd, float ki)
+{
+    controller->kp = pid_fx_from_float(kp);
+    controller->kd = pid_fx_from_float(kd);
+    controller->ki = pid_fx_from_float(ki);
+}
+
+int32_t pid_fx_compute(PidFx *controller, int32_t set_point, int32_t measured, uint32_t deltat_us)
+{
+    int64_t deltat = (int64_t)(((uint64_t)deltat_us * US_TO_Q28) >> 24); /* seconds, Q28 */
+    int32_t error = set_point - measured;
+
+    if (deltat == 0) { deltat = 1; } /* same as the float one, the caller keeps this from happening */
+    controller->integral += (((int64_t)error * deltat) + ((int64_t)1 << 27)) >> 28; /* rounded, a floor would wind up a bias */
+    int64_t derivative = ((int64_t)(error - controller->prev_err) * ((int64_t)1 << 28)) / deltat; /* the one division */
+    int64_t output = ((int64_t)controller->kp * error) + (((int64_t)controller->ki * controller->integral)) + ((int64_t)controller->kd * derivative);
+    controller->prev_err = error;
+
+    output >>= PID_FX_Q;
+    if (output > INT32_MAX) { return INT32_MAX; }
+    if (output < INT32_MIN) { return INT32_MIN; }
+    return (int32_t)output;
+}
+
+int32_t pid_fx_from_float(float value)
+{
+    return (int32_t)(value * FX_ONE);
+}
+
+float pid_fx_to_float(int32_t value)
+{
+    return (float)value * (1.0F / FX_ONE);
+}
\ No newline at end of file
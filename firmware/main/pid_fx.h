@@ -0,0 +1,49 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * pid_fx.h - fixed-point pid controller for targets without an fpu, same control law as pid.c in Q16
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _PID_FX_H
+#define _PID_FX_H
+#include <stdint.h>
+
+#define PID_FX_Q    16 /* errors, gains and output: 1.0 == 1 << 16 */
+
+typedef struct {
+    int32_t kp;         /* Q16 */
+    int32_t ki;
+    int32_t kd;
+    int32_t prev_err;   /* Q16 */
+    int64_t integral;   /* error * seconds, Q16 */
+} PidFx;
+
+void pid_fx_init(PidFx *controller, float kp, float kd, float ki);
+void pid_fx_update_consts(PidFx *controller, float kp, float kd, float ki);
+/* set_point and measured in Q16, returns the output in Q16 */
+int32_t pid_fx_compute(PidFx *controller, int32_t set_point, int32_t measured, uint32_t deltat_us);
+int32_t pid_fx_from_float(float value);
+float pid_fx_to_float(int32_t value);
+
+#endif /* _PID_FX_H */
\ No newline at end of file
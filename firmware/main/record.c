@@ -0,0 +1,396 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * record.c - session recorder, see record.h for the format
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "record.h"
+
+#define BLOCK(field)    { offsetof(Control, field), sizeof(((Control *)0)->field) }
+#define EVENT_MAX       (2U + FIFO_MAX_PACKETS * RECORD_SAMPLE_SIZE)
+
+typedef struct {
+    uint16_t offset;
+    uint16_t size;
+} Block;
+
+/* the parts of Control the replay needs to carry on exactly where the session started, everything but the */
+/* estimator's ops pointer. offsets differ between the c3 and a 64 bit host, the sizes don't */
+static const Block blocks[] = {
+    BLOCK(estimator.state), BLOCK(filter), BLOCK(attitude_valid), BLOCK(controller),
+#if CONTROL_LAW == CONTROL_LAW_PID_V2
+    BLOCK(controller_v2),
+#elif CONTROL_LAW == CONTROL_LAW_LQR
+    BLOCK(controller_lqr),
+#elif CONTROL_LAW == CONTROL_LAW_MPC
+    BLOCK(controller_mpc),
+#endif
+    BLOCK(timebase), BLOCK(friction),
+#if CONTROL_FIXED_POINT
+    BLOCK(filter_fx), BLOCK(controller_fx),
+#endif
+    BLOCK(setpoint), BLOCK(setpoint_sin), BLOCK(setpoint_cos), BLOCK(error), BLOCK(rate), BLOCK(command),
+    BLOCK(applied), BLOCK(deltat), BLOCK(step), BLOCK(fresh), BLOCK(stopped), BLOCK(passes),
+};
+#define BLOCK_COUNT     (sizeof(blocks) / sizeof(blocks[0]))
+
+/* single producer (control task), single consumer (storage side). each index is written by one side only */
+static uint8_t ring[RECORD_RING_SIZE];
+static volatile uint32_t head = 0U;
+static volatile uint32_t tail = 0U;
+static volatile RecordPhase phase = RECORD_IDLE;
+static volatile int32_t requested = -1;     /* seconds asked for over ble, -1 for none */
+static volatile uint32_t prepared = 0U;     /* room the storage side made for the pending request */
+static uint32_t wanted = 0U;                /* bytes of the pending request */
+static uint32_t capacity = 0U;
+static uint32_t written = 0U;               /* bytes of the session so far */
+static uint32_t samples = 0U;
+static float sample_period = 0.0F;
+static bool overflowed = false;
+static float gains[3];
+static bool gains_known = false;
+
+static uint8_t *put(uint8_t *out, const void *value, size_t size)
+{
+    memcpy(out, value, size);
+    return out + size;
+}
+
+static const uint8_t *get(const uint8_t *in, void *value, size_t size)
+{
+    memcpy(value, in, size);
+    return in + size;
+}
+
+static void finish(bool overflow)
+{
+    overflowed = overflow;
+    phase = RECORD_FLUSHING;
+    if (overflow) { ESP_LOGW("record", "Ring full, session cut after %lu bytes", (unsigned long)written); }
+    else          { ESP_LOGI("record", "Session complete, %lu bytes", (unsigned long)written); }
+}
+
+/* whole events or nothing, so the consumer never stops in the middle of one */
+static void emit(const uint8_t *data, size_t size)
+{
+    if (phase != RECORD_RECORDING) { return; }
+    if (written + size >= capacity) { finish(false); return; } /* at least one 0xFF byte left to end it */
+    uint32_t at = head;
+    if (RECORD_RING_SIZE - (at - tail) < size) { finish(true); return; }
+
+    for (size_t i = 0U; i < size; i++) { ring[(at + i) % RECORD_RING_SIZE] = data[i]; }
+    head = at + (uint32_t)size;
+    written += (uint32_t)size;
+}
+
+static void write_floats(RecordTag tag, const float *values, size_t count)
+{
+    uint8_t event[1U + 3U * sizeof(float)];
+    event[0] = (uint8_t)tag;
+    memcpy(&event[1], values, count * sizeof(float));
+    emit(event, 1U + count * sizeof(float));
+}
+
+void record_request(uint32_t seconds)
+{
+    requested = (int32_t)((seconds < RECORD_MAX_SECONDS) ? seconds : RECORD_MAX_SECONDS);
+}
+
+RecordPhase record_phase(void)
+{
+    return phase;
+}
+
+uint32_t record_erase_request(void)
+{
+    return (phase == RECORD_ERASING && prepared == 0U) ? wanted : 0U;
+}
+
+void record_prepared(uint32_t room)
+{
+    prepared = room;
+}
+
+size_t record_drain(uint8_t *buffer, size_t size)
+{
+    uint32_t at = tail;
+    uint32_t available = head - at;
+    size_t count = (available < size) ? available : size;
+
+    for (size_t i = 0U; i < count; i++) { buffer[i] = ring[(at + i) % RECORD_RING_SIZE]; }
+    tail = at + (uint32_t)count;
+    if (phase == RECORD_FLUSHING && head == tail) { phase = RECORD_DONE; }
+    return count;
+}
+
+void record_poll(bool active, const Control *control, const IMU *imu)
+{
+    int32_t seconds = requested;
+    requested = -1;
+
+    if (seconds == 0)
+    {
+        if (phase == RECORD_RECORDING) { finish(false); }
+        else if (phase == RECORD_ERASING || phase == RECORD_ARMED) { phase = RECORD_IDLE; }
+    }
+    else if (seconds > 0 && (phase == RECORD_IDLE || phase == RECORD_DONE))
+    {
+        wanted = (uint32_t)seconds * RECORD_BYTES_PER_SECOND + RECORD_HEADER_MAX;
+        prepared = 0U;
+        phase = RECORD_ERASING;
+    }
+
+    if (phase == RECORD_ERASING && prepared > 0U)
+    {
+        capacity = prepared;
+        phase = RECORD_ARMED;
+    }
+    if (phase != RECORD_ARMED || !active) { return; }
+
+    /* header and snapshot, the stream is empty at this point so it always fits */
+    uint8_t header[RECORD_HEADER_MAX];
+    uint8_t *out = header;
+    uint32_t magic = RECORD_MAGIC;
+    uint16_t version = RECORD_VERSION;
+    uint8_t config[4] = { CONTROL_LAW, CONTROL_ESTIMATOR, CONTROL_FIXED_POINT, CONTROL_PITCH_MODE };
+    float calibration[8] = { imu->accel_resolution, imu->gyro_resolution, imu->axbias, imu->aybias, imu->azbias,
+                             imu->gxbias, imu->gybias, imu->gzbias };
+    uint8_t count = (uint8_t)BLOCK_COUNT;
+
+    out = put(out, &magic, sizeof(magic));
+    out = put(out, &version, sizeof(version));
+    out = put(out, config, sizeof(config));
+    out = put(out, &imu->sample_period, sizeof(float));
+    out = put(out, calibration, sizeof(calibration));
+    out = put(out, &count, sizeof(count));
+    for (size_t i = 0U; i < BLOCK_COUNT; i++)
+    {
+        out = put(out, &blocks[i].size, sizeof(uint16_t));
+        out = put(out, (const uint8_t *)control + blocks[i].offset, blocks[i].size);
+    }
+
+    written = 0U;
+    samples = 0U;
+    sample_period = imu->sample_period;
+    overflowed = false;
+    gains_known = false;
+    phase = RECORD_RECORDING;
+    emit(header, (size_t)(out - header));
+    ESP_LOGI("record", "Session started, %lu bytes of room", (unsigned long)capacity);
+}
+
+void record_samples(const IMUSample *batch, uint16_t count)
+{
+    uint8_t event[EVENT_MAX];
+    uint8_t *out = event;
+
+    if (phase != RECORD_RECORDING || count == 0U) { return; }
+    if (count > FIFO_MAX_PACKETS) { count = FIFO_MAX_PACKETS; }
+    *out++ = (uint8_t)RECORD_SAMPLES;
+    *out++ = (uint8_t)count;
+    for (uint16_t i = 0U; i < count; i++)
+    {
+        const IMUSample *sample = &batch[i];
+        int16_t axes[6] = { sample->ax, sample->ay, sample->az, sample->gx, sample->gy, sample->gz };
+        out = put(out, &sample->timestamp, sizeof(uint16_t));
+        out = put(out, axes, sizeof(axes));
+    }
+    emit(event, (size_t)(out - event));
+    samples += count;
+}
+
+void record_hold(float deltat)
+{
+    if (phase != RECORD_RECORDING) { return; }
+    write_floats(RECORD_HOLD, &deltat, 1U);
+}
+
+void record_compute(float kp, float kd, float ki, float error, float command)
+{
+    float values[3] = { kp, kd, ki };
+
+    if (phase != RECORD_RECORDING) { return; }
+    /* gains only when they changed, compared as bits so the replay gets exactly these */
+    if (!gains_known || memcmp(values, gains, sizeof(gains)) != 0)
+    {
+        write_floats(RECORD_GAINS, values, 3U);
+        memcpy(gains, values, sizeof(gains));
+        gains_known = true;
+    }
+    values[0] = error;
+    values[1] = command;
+    write_floats(RECORD_COMPUTE, values, 2U);
+}
+
+void record_actuate(float command, float applied)
+{
+    float values[2] = { command, applied };
+
+    if (phase != RECORD_RECORDING) { return; }
+    write_floats(RECORD_ACTUATE, values, 2U);
+}
+
+void record_stop(void)
+{
+    uint8_t tag = (uint8_t)RECORD_STOP;
+    emit(&tag, 1U);
+}
+
+void record_restart(void)
+{
+    uint8_t tag = (uint8_t)RECORD_RESTART;
+    emit(&tag, 1U);
+}
+
+size_t record_string(char *buffer, size_t size)
+{
+    int length = 0;
+    float seconds = (float)samples * sample_period;
+
+    switch (phase)
+    {
+    case RECORD_ERASING:   length = snprintf(buffer, size, "erasing %lu bytes", (unsigned long)wanted); break;
+    case RECORD_ARMED:     length = snprintf(buffer, size, "armed, waiting for control"); break;
+    case RECORD_RECORDING: length = snprintf(buffer, size, "recording %.1f s, %lu/%lu bytes", seconds, (unsigned long)written, (unsigned long)capacity); break;
+    case RECORD_FLUSHING:  length = snprintf(buffer, size, "flushing %.1f s", seconds); break;
+    case RECORD_DONE:      length = snprintf(buffer, size, "%s %.1f s, %lu bytes", overflowed ? "overflow after" : "done", seconds, (unsigned long)written); break;
+    default:               length = snprintf(buffer, size, "idle"); break;
+    }
+
+    if (length < 0) { return 0U; }
+    return ((size_t)length < size) ? (size_t)length : size - 1U;
+}
+
+int record_decode_header(const uint8_t *data, size_t length, RecordHeader *header)
+{
+    const uint8_t *in = data;
+    uint32_t magic = 0U;
+    uint16_t version = 0U;
+    size_t fixed = sizeof(magic) + sizeof(version) + 4U + 9U * sizeof(float) + 1U;
+
+    if (length < fixed) { return 0; }
+    in = get(in, &magic, sizeof(magic));
+    in = get(in, &version, sizeof(version));
+    if (magic != RECORD_MAGIC || version != RECORD_VERSION) { return -1; }
+    header->control_law = *in++;
+    header->estimator = *in++;
+    header->fixed_point = *in++;
+    header->pitch_mode = *in++;
+    in = get(in, &header->sample_period, sizeof(float));
+    in = get(in, header->calibration, sizeof(header->calibration));
+    header->blocks = *in++;
+    if (header->blocks > sizeof(header->block_size) / sizeof(header->block_size[0])) { return -1; }
+
+    header->snapshot_size = 0U;
+    for (uint8_t i = 0U; i < header->blocks; i++)
+    {
+        uint16_t size = 0U;
+        if ((size_t)(in - data) + sizeof(size) > length) { return 0; }
+        in = get(in, &size, sizeof(size));
+        if (header->snapshot_size + size > RECORD_HEADER_MAX) { return -1; }
+        if ((size_t)(in - data) + size > length) { return 0; }
+        in = get(in, &header->snapshot[header->snapshot_size], size);
+        header->block_size[i] = size;
+        header->snapshot_size += size;
+    }
+    return (int)(in - data);
+}
+
+bool record_restore(const RecordHeader *header, Control *control, IMU *imu)
+{
+    imu->sample_period = header->sample_period;
+    imu->accel_resolution = header->calibration[0];
+    imu->gyro_resolution = header->calibration[1];
+    imu->axbias = header->calibration[2];
+    imu->aybias = header->calibration[3];
+    imu->azbias = header->calibration[4];
+    imu->gxbias = header->calibration[5];
+    imu->gybias = header->calibration[6];
+    imu->gzbias = header->calibration[7];
+
+    if (header->control_law != CONTROL_LAW || header->estimator != CONTROL_ESTIMATOR ||
+        header->fixed_point != CONTROL_FIXED_POINT || header->pitch_mode != CONTROL_PITCH_MODE) { return false; }
+    if (header->blocks != BLOCK_COUNT) { return false; }
+    for (size_t i = 0U; i < BLOCK_COUNT; i++)
+    {
+        if (header->block_size[i] != blocks[i].size) { return false; }
+    }
+
+    const uint8_t *in = header->snapshot;
+    for (size_t i = 0U; i < BLOCK_COUNT; i++)
+    {
+        in = get(in, (uint8_t *)control + blocks[i].offset, blocks[i].size);
+    }
+    return true;
+}
+
+int record_decode(const uint8_t *data, size_t length, RecordEvent *event)
+{
+    size_t floats = 0U;
+
+    if (length < 1U) { return 0; }
+    event->tag = (RecordTag)data[0];
+    switch (event->tag)
+    {
+    case RECORD_SAMPLES:
+    {
+        if (length < 2U) { return 0; }
+        event->count = data[1];
+        if (event->count == 0U || event->count > FIFO_MAX_PACKETS) { return -1; }
+        size_t size = 2U + (size_t)event->count * RECORD_SAMPLE_SIZE;
+        if (length < size) { return 0; }
+        const uint8_t *in = &data[2];
+        for (uint8_t i = 0U; i < event->count; i++)
+        {
+            IMUSample *sample = &event->samples[i];
+            int16_t axes[6];
+            in = get(in, &sample->timestamp, sizeof(uint16_t));
+            in = get(in, axes, sizeof(axes));
+            sample->ax = axes[0];
+            sample->ay = axes[1];
+            sample->az = axes[2];
+            sample->gx = axes[3];
+            sample->gy = axes[4];
+            sample->gz = axes[5];
+            sample->temperature = 0;
+        }
+        return (int)size;
+    }
+    case RECORD_HOLD:    floats = 1U; break;
+    case RECORD_GAINS:   floats = 3U; break;
+    case RECORD_COMPUTE: floats = 2U; break;
+    case RECORD_ACTUATE: floats = 2U; break;
+    case RECORD_STOP:
+    case RECORD_RESTART:
+    case RECORD_END:     return 1;
+    default:             return -1;
+    }
+
+    if (length < 1U + floats * sizeof(float)) { return 0; }
+    memcpy(event->values, &data[1], floats * sizeof(float));
+    return (int)(1U + floats * sizeof(float));
+}
\ No newline at end of file
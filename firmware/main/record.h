@@ -0,0 +1,127 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * record.h - session recorder: the raw imu samples of every pass, the gains and what the controller and the motor
+ * got out of them, in a compact binary stream that host/tools/replay.c feeds back through control.c and diffs bit for bit.
+ * the control task writes into a ring, the storage side (record_flash.c on the robot) drains it
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RECORD_H
+#define _RECORD_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "imu.h"
+#include "control.h"
+
+/*
+ * session layout, little endian like the c3 and any host replaying it, no padding:
+ *   header   u32 RECORD_MAGIC, u16 RECORD_VERSION, u8 control law, estimator, fixed point, pitch mode,
+ *            f32 imu sample period, accel and gyro resolution, ax ay az gx gy gz bias,
+ *            u8 block count, then per block u16 size and the bytes of that part of Control (see record.c)
+ *   events   u8 tag and its payload, until a tag of 0xFF which is also what erased flash reads as
+ */
+#define RECORD_MAGIC             0x3153524AUL /* "JRS1" */
+#define RECORD_VERSION           3U
+#define RECORD_RING_SIZE         16384U  /* ~0.9 s of balancing, the storage side has to keep up */
+#define RECORD_BYTES_PER_SECOND  20000U  /* 1 kHz of samples plus 200 Hz of passes, rounded up, to size a session */
+#define RECORD_MAX_SECONDS       3600U
+#define RECORD_HEADER_MAX        512U    /* bytes, header with the snapshot */
+#define RECORD_SAMPLE_SIZE       14U     /* u16 timestamp, i16 ax ay az gx gy gz, the fifo temperature is left out */
+#define SIZEOF_RECORD_DATA       128
+
+typedef enum {
+    RECORD_SAMPLES = 0x01,  /* u8 count, count samples: control_estimate on them */
+    RECORD_HOLD    = 0x02,  /* f32 deltat: control_hold */
+    RECORD_GAINS   = 0x03,  /* f32 kp, kd, ki: what control_compute gets from here on */
+    RECORD_COMPUTE = 0x04,  /* f32 error, command: control_compute ran and came up with these */
+    RECORD_ACTUATE = 0x05,  /* f32 command, applied: control_actuate got command (autotune or sysid may have replaced */
+                            /* the controller's) and sent applied to the motor */
+    RECORD_STOP    = 0x06,  /* control_stop, once per switch off */
+    RECORD_RESTART = 0x07,  /* control_restart */
+    RECORD_END     = 0xFF,
+} RecordTag;
+
+typedef enum {
+    RECORD_IDLE = 0,
+    RECORD_ERASING,         /* asked for, the storage side is making room for it */
+    RECORD_ARMED,           /* room made, starts with the next pass that has control on */
+    RECORD_RECORDING,
+    RECORD_FLUSHING,        /* the session ended, the storage side is still draining the ring */
+    RECORD_DONE,
+} RecordPhase;
+
+typedef struct {
+    uint8_t control_law;
+    uint8_t estimator;
+    uint8_t fixed_point;
+    uint8_t pitch_mode;
+    float sample_period;
+    float calibration[8];   /* accel and gyro resolution, ax ay az gx gy gz bias */
+    uint8_t blocks;
+    uint16_t block_size[RECORD_HEADER_MAX / 8U];
+    uint8_t snapshot[RECORD_HEADER_MAX]; /* the blocks back to back */
+    uint16_t snapshot_size;
+} RecordHeader;
+
+typedef struct {
+    RecordTag tag;
+    uint8_t count;          /* RECORD_SAMPLES */
+    IMUSample samples[FIFO_MAX_PACKETS];
+    float values[3];        /* the floats of the other events, in the order above */
+} RecordEvent;
+
+/* ble side: record for about seconds of sensor time, 0 ends a session early */
+void record_request(uint32_t seconds);
+/* ble side: status, the phase and how much sensor time went in */
+size_t record_string(char *buffer, size_t size);
+RecordPhase record_phase(void);
+
+/* storage side: bytes a pending request needs room for, 0 if there is none */
+uint32_t record_erase_request(void);
+/* storage side: that much room is ready, the session will stop short of it. the control task arms it */
+void record_prepared(uint32_t capacity);
+/* storage side: copy out up to size bytes of the stream, flushing turns into done once the ring ran dry */
+size_t record_drain(uint8_t *buffer, size_t size);
+
+/* control task, once per pass before the estimate: picks up requests and starts an armed session when active */
+/* with a snapshot of control, so the replay starts from the exact same state. a full ring ends the session */
+/* at the last whole event */
+void record_poll(bool active, const Control *control, const IMU *imu);
+/* control.c, each a no-op unless a session is recording */
+void record_samples(const IMUSample *samples, uint16_t count);
+void record_hold(float deltat);
+void record_compute(float kp, float kd, float ki, float error, float command);
+void record_actuate(float command, float applied);
+void record_stop(void);
+void record_restart(void);
+
+/* replay side: parse the header at data, returns the bytes it took, 0 if it needs more, -1 if it isn't a session */
+int record_decode_header(const uint8_t *data, size_t length, RecordHeader *header);
+/* replay side: false if the build differs from the one that recorded, control is left as control_init made it then */
+bool record_restore(const RecordHeader *header, Control *control, IMU *imu);
+/* replay side: the next event at data, returns the bytes it took, 0 if it needs more, -1 on garbage */
+int record_decode(const uint8_t *data, size_t length, RecordEvent *event);
+
+#endif /* _RECORD_H */
\ No newline at end of file
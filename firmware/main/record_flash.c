@@ -0,0 +1,82 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * record_flash.c - storage side of the session recorder, see record_flash.h
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "globals.h"
+#include "calib.h"
+#include "record.h"
+#include "record_flash.h"
+
+#define SECTOR_SIZE     4096U
+
+static uint8_t page[RECORD_FLASH_PAGE];
+
+/* the flash cache is off while erasing or writing and the control task stalls with it: erasing takes seconds so */
+/* it waits for control to be off, a page write takes about a millisecond which the imu fifo rides out. a friction */
+/* calibration's nvs write can erase a page too, so it is done here under the same rule */
+void record_flash_task(void *arg)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, RECORD_FLASH_LABEL);
+    uint32_t offset = 0U;
+    size_t fill = 0U;
+
+    if (partition == NULL) { ESP_LOGW("record_flash", "No \"%s\" partition, sessions can't be recorded", RECORD_FLASH_LABEL); }
+
+    while (1)
+    {
+        if (!control_active) { calib_poll_store_motor(); }
+        if (partition == NULL) { vTaskDelay(pdMS_TO_TICKS(RECORD_FLASH_POLL_MS)); continue; }
+
+        uint32_t wanted = record_erase_request();
+        if (wanted > 0U && !control_active)
+        {
+            uint32_t size = (wanted + SECTOR_SIZE - 1U) / SECTOR_SIZE * SECTOR_SIZE;
+            if (size > partition->size) { size = partition->size; }
+            esp_err_t err = esp_partition_erase_range(partition, 0U, size);
+            if (err != ESP_OK) { ESP_LOGE("record_flash", "Erase failed: %s", esp_err_to_name(err)); size = 0U; }
+            offset = 0U;
+            fill = 0U;
+            if (size > 0U) { record_prepared(size); }
+        }
+
+        /* whole pages while recording, the rest once the session ended */
+        size_t count = record_drain(&page[fill], sizeof(page) - fill);
+        fill += count;
+        RecordPhase phase = record_phase();
+        if (fill == sizeof(page) || (fill > 0U && (phase == RECORD_FLUSHING || phase == RECORD_DONE)))
+        {
+            esp_err_t err = esp_partition_write(partition, offset, page, fill);
+            if (err != ESP_OK) { ESP_LOGE("record_flash", "Write at %lu failed: %s", (unsigned long)offset, esp_err_to_name(err)); }
+            offset += (uint32_t)fill;
+            fill = 0U;
+        }
+        if (count == 0U) { vTaskDelay(pdMS_TO_TICKS(RECORD_FLASH_POLL_MS)); }
+    }
+}
\ No newline at end of file
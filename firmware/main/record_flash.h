@@ -0,0 +1,42 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * record_flash.h - storage side of the session recorder: drains the ring into the "session" flash partition,
+ * read it back with parttool.py read_partition --partition-name session and give it to host/tools/replay.c
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _RECORD_FLASH_H
+#define _RECORD_FLASH_H
+
+#define RECORD_FLASH_LABEL       "session" /* data partition in partitions.csv */
+#define RECORD_FLASH_PAGE        256U      /* bytes per flash write, about a millisecond with the cache off */
+#define RECORD_FLASH_POLL_MS     20U
+#define RECORD_FLASH_TASK_STACK  3072U
+#define RECORD_FLASH_TASK_PRIORITY 1U      /* next to the ble task, far below control */
+
+/* task: erases room for a requested session while control is off, then writes it out page by page. also stores */
+/* a finished friction calibration, see calib_request_store_motor */
+void record_flash_task(void *arg);
+
+#endif /* _RECORD_FLASH_H */
\ No newline at end of file
@@ -28,8 +28,9 @@
  * SOFTWARE.
  */
 
+#include <stdbool.h>
 #include "driver/rmt.h"
-#include "esp_timer.h"
+#include "hal.h"
 #include "esp_log.h"
 #include "rgb.h"
 
@@ -142,32 +143,46 @@ uint8_t morph_set_sequence(Morph *morph, RGB *rgb_list, uint8_t rgb_list_size, i
     morph->current_color.hex = rgb_list->hex;
     morph->target_color.hex = rgb_list->hex;
     morph->morph_step = morph_step_time_us; /* convert step time to us */
-    morph->last_tick = esp_timer_get_time();
+    morph->last_tick = hal_clock_now_us();
 
     return 0U;
 }
 
+/* one blending step, returns true if the current color changed */
+static bool morph_step(Morph *morph)
+{
+    if (morph->current_color.hex == morph->target_color.hex)
+    {
+        morph->list_index++;
+        if (morph->list_index >= morph->list_size) { morph->list_index = 0U; } /* wrap index back to the start */
+        morph->target_color = *(morph->color_list + morph->list_index); /* get current target color from rgb list */
+        return false;
+    }
+
+    if (morph->current_color.red   > morph->target_color.red)   { morph->current_color.red--; }
+    if (morph->current_color.red   < morph->target_color.red)   { morph->current_color.red++; }
+    if (morph->current_color.green > morph->target_color.green) { morph->current_color.green--; }
+    if (morph->current_color.green < morph->target_color.green) { morph->current_color.green++; }
+    if (morph->current_color.blue  > morph->target_color.blue)  { morph->current_color.blue--; }
+    if (morph->current_color.blue  < morph->target_color.blue)  { morph->current_color.blue++; }
+    return true;
+}
+
 void morph_tick(Morph *morph)
 {
+    int64_t now = hal_clock_now_us();
+    uint16_t steps = 0U;
+    bool changed = false;
 
-    if (esp_timer_get_time() - morph->last_tick >= morph->morph_step)
+    /* catch up on the steps missed since the last call so the blend speed doesn't depend on how often this runs, */
+    /* the led only gets written once */
+    while (now - morph->last_tick >= morph->morph_step && steps < MORPH_MAX_CATCH_UP)
     {
-        if (morph->current_color.hex == morph->target_color.hex)
-        {
-            morph->list_index++;
-            if (morph->list_index >= morph->list_size) { morph->list_index = 0U; } /* wrap index back to the start */
-            morph->target_color = *(morph->color_list + morph->list_index); /* get current target color from rgb list */
-        }
-        else
-        {
-            if (morph->current_color.red   > morph->target_color.red)   { morph->current_color.red--; }
-            if (morph->current_color.red   < morph->target_color.red)   { morph->current_color.red++; }
-            if (morph->current_color.green > morph->target_color.green) { morph->current_color.green--; }
-            if (morph->current_color.green < morph->target_color.green) { morph->current_color.green++; }
-            if (morph->current_color.blue  > morph->target_color.blue)  { morph->current_color.blue--; }
-            if (morph->current_color.blue  < morph->target_color.blue)  { morph->current_color.blue++; }
-            set_led_rgb(morph->current_color);
-        }
-        morph->last_tick = esp_timer_get_time();
+        changed |= morph_step(morph);
+        steps++;
+        if (morph->morph_step <= 0) { morph->last_tick = now; break; }
+        morph->last_tick += morph->morph_step;
     }
+    if (steps >= MORPH_MAX_CATCH_UP) { morph->last_tick = now; } /* way behind, don't try to replay all of it */
+    if (changed) { set_led_rgb(morph->current_color); }
 }
\ No newline at end of file
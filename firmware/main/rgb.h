@@ -43,6 +43,7 @@
 #define T1H_DURATION   (0.600F * 80.0F / 2.0F) /* 0.6 us */
 #define T1L_DURATION   (0.200F * 80.0F / 2.0F) /* 0.2 us */
 #define RESET_DURATION (80.00F * 80.0F / 2.0F) /* Reset signal duration ~ 80 us */
+#define MORPH_MAX_CATCH_UP 64U                 /* blending steps a single morph_tick call may replay */
 
 /* COLORS!!!! >w< literally HTML colors */
 #define HOT_PINK       0xff2e5b
@@ -0,0 +1,170 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * stats.c - run time instrumentation of the control pipeline
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+
+static const char *probe_names[STATS_PROBE_COUNT] = { "imu", "mdu", "rpy", "pid", "mot", "led", "tlm", "pwm" };
+
+static Stats live;                      /* only touched by the control task */
+static Stats published;                 /* copied out under a sequence lock */
+static Stats reader_copy;               /* too big for the ble host task stack */
+static volatile uint32_t sequence = 0U; /* odd while published is being written */
+static volatile bool reset_requested = false;
+
+static void clear(Stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (uint8_t i = 0U; i < STATS_PROBE_COUNT; i++) { stats->probes[i].min = UINT32_MAX; }
+}
+
+static void publish(void)
+{
+    sequence++;
+    __sync_synchronize();
+    memcpy(&published, &live, sizeof(published));
+    __sync_synchronize();
+    sequence++;
+}
+
+void stats_init(void)
+{
+    clear(&live);
+    publish();
+}
+
+void stats_record(StatsProbe probe, uint32_t cycles)
+{
+    StatsHistogram *histogram = &live.probes[probe];
+    uint8_t bucket = (cycles == 0U) ? 0U : (uint8_t)(32U - (uint32_t)__builtin_clz(cycles));
+
+    if (bucket >= STATS_BUCKETS) { bucket = STATS_BUCKETS - 1U; }
+    histogram->count++;
+    histogram->sum += cycles;
+    if (cycles < histogram->min) { histogram->min = cycles; }
+    if (cycles > histogram->max) { histogram->max = cycles; }
+    histogram->buckets[bucket]++;
+}
+
+void stats_saturation(bool saturated)
+{
+    live.saturating = saturated;
+}
+
+void stats_pass(void)
+{
+    int64_t now = hal_clock_now_us();
+
+    if (reset_requested)
+    {
+        reset_requested = false;
+        clear(&live);
+    }
+
+    if (live.passes == 0U) { live.window_start = now; }
+    else
+    {
+        float period = (float)(now - live.last_pass);
+        float delta = period - live.period_mean;
+        live.period_mean += delta / (float)live.passes; /* passes - 1 periods so far, + this one */
+        live.period_m2 += delta * (period - live.period_mean);
+        if ((uint32_t)period > live.period_max) { live.period_max = (uint32_t)period; }
+        if (live.saturating) { live.saturated += now - live.last_pass; }
+    }
+    live.last_pass = now;
+    live.passes++;
+
+    if (live.passes % STATS_PUBLISH_PASSES == 0U) { publish(); }
+}
+
+void stats_request_reset(void)
+{
+    reset_requested = true;
+}
+
+size_t stats_string(char *buffer, size_t size)
+{
+    uint32_t before = 0U;
+    size_t length = 0U;
+    int written = 0;
+
+    /* the control task outranks every reader, so it may publish in the middle of the copy, just try again */
+    do
+    {
+        before = sequence;
+        __sync_synchronize();
+        memcpy(&reader_copy, &published, sizeof(reader_copy));
+        __sync_synchronize();
+    } while ((before & 1U) || before != sequence);
+
+    written = snprintf(buffer, size, "mhz:%lu;", (unsigned long)hal_cycles_per_us());
+    if (written > 0) { length = (size_t)written; }
+
+    for (uint8_t i = 0U; i < STATS_PROBE_COUNT && length < size; i++)
+    {
+        const StatsHistogram *histogram = &reader_copy.probes[i];
+        uint8_t first = STATS_BUCKETS;
+        uint8_t last = 0U;
+
+        if (histogram->count == 0U)
+        {
+            written = snprintf(&buffer[length], size - length, "%s:0;", probe_names[i]);
+            if (written > 0) { length += (size_t)written; }
+            continue;
+        }
+
+        /* only the non-empty span of the histogram */
+        for (uint8_t b = 0U; b < STATS_BUCKETS; b++)
+        {
+            if (histogram->buckets[b] == 0U) { continue; }
+            if (first == STATS_BUCKETS) { first = b; }
+            last = b;
+        }
+        written = snprintf(&buffer[length], size - length, "%s:%lu,%lu,%lu,%lu@%u=", probe_names[i], (unsigned long)histogram->count,
+                           (unsigned long)histogram->min, (unsigned long)(histogram->sum / histogram->count), (unsigned long)histogram->max, first);
+        if (written > 0) { length += (size_t)written; }
+        for (uint8_t b = first; b <= last && length < size; b++)
+        {
+            written = snprintf(&buffer[length], size - length, (b == last) ? "%lu;" : "%lu/", (unsigned long)reader_copy.probes[i].buckets[b]);
+            if (written > 0) { length += (size_t)written; }
+        }
+    }
+
+    if (length < size)
+    {
+        int64_t window = reader_copy.last_pass - reader_copy.window_start;
+        float rate = (window > 0) ? (float)(reader_copy.passes - 1U) * 1000000.0F / (float)window : 0.0F;
+        float jitter = (reader_copy.passes > 2U) ? sqrtf(reader_copy.period_m2 / (float)(reader_copy.passes - 2U)) : 0.0F;
+        float saturation = (window > 0) ? 100.0F * (float)reader_copy.saturated / (float)window : 0.0F;
+        written = snprintf(&buffer[length], size - length, "loop:%.1f,%.1f,%lu,%.1f;", rate, jitter, (unsigned long)reader_copy.period_max, saturation);
+        if (written > 0) { length += (size_t)written; }
+    }
+
+    return (length < size) ? length : size - 1U;
+}
\ No newline at end of file
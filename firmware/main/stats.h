@@ -0,0 +1,92 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * stats.h - lightweight run time instrumentation of the control pipeline. cpu cycle counts per probe
+ * with min/max/mean and log2 histograms, plus loop rate, period jitter and motor saturation time.
+ * the control task records, a snapshot is published every second for readers in other tasks
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hal.h"
+
+#define STATS_ENABLED         1     /* 0 compiles every probe out */
+#define STATS_BUCKETS         32U   /* bucket i counts durations of [2^(i-1), 2^i) cycles */
+#define STATS_PUBLISH_PASSES  200U  /* one snapshot a second at 200 Hz */
+
+typedef enum {
+    STATS_IMU_READ = 0,     /* fifo status, count and burst, without the led work done during the burst */
+    STATS_MADGWICK_UPDATE,  /* per sample */
+    STATS_MADGWICK_RPY,
+    STATS_PID,
+    STATS_MOTOR,
+    STATS_MORPH,
+    STATS_TELEMETRY,        /* the push into the telemetry ring, flags included */
+    STATS_MOTOR_WRITE,      /* set_motor_command or stop_motor alone, the ledc writes of "mot" without the compensation and clamps */
+    STATS_PROBE_COUNT
+} StatsProbe;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;           /* cycles */
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[STATS_BUCKETS];
+} StatsHistogram;
+
+typedef struct {
+    StatsHistogram probes[STATS_PROBE_COUNT];
+    uint32_t passes;
+    int64_t window_start;   /* us, first pass since the last reset */
+    int64_t last_pass;
+    float period_mean;      /* us, welford over the time between passes */
+    float period_m2;
+    uint32_t period_max;    /* us */
+    int64_t saturated;      /* us spent with the motor command clamped */
+    bool saturating;        /* the last command was clamped */
+} Stats;
+
+#if STATS_ENABLED
+#define STATS_BEGIN(name)         uint32_t name = hal_cycle_count()
+#define STATS_END(probe, name)    stats_record((probe), hal_cycle_count() - (name))
+#else
+#define STATS_BEGIN(name)
+#define STATS_END(probe, name)
+#endif
+
+void stats_init(void);
+void stats_record(StatsProbe probe, uint32_t cycles);
+/* once per control pass: loop rate and jitter, a pending reset, the snapshot */
+void stats_pass(void);
+void stats_saturation(bool saturated);
+/* from any task, takes effect on the next pass */
+void stats_request_reset(void);
+/* latest snapshot as text, "mhz:160;imu:n,min,mean,max@first=c/c/c;...;loop:hz,jitter_us,max_us,saturation_pct;" */
+/* only one task may read at a time, returns the length written */
+size_t stats_string(char *buffer, size_t size);
+
+#endif /* _STATS_H */
\ No newline at end of file
@@ -0,0 +1,184 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * sysid.c - system identification excitation and capture
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "sysid.h"
+
+#define PI              (3.14159265358979F)
+#define PRBS_SEED       0x1FFU
+
+typedef struct {
+    SysidSignal signal;
+    float amplitude;
+    float elapsed;          /* seconds of excitation so far */
+    uint16_t prbs;          /* lfsr state, x^9 + x^5 + 1 */
+    uint8_t hold;           /* passes left on the current bit */
+    float level;            /* current prbs output */
+    uint16_t count;         /* records captured */
+} Capture;
+
+static Capture capture;                             /* only touched by the control task while capturing */
+static SysidRecord records[SYSID_CAPTURE_SAMPLES];  /* static, far too big for any stack */
+static volatile SysidPhase phase = SYSID_IDLE;
+static volatile int8_t requested = -1;              /* signal asked for over ble, -1 for none */
+static volatile float requested_amplitude = SYSID_DEFAULT_AMPLITUDE;
+/* read cursor, only touched by the ble host task once the capture is complete */
+static int32_t cursor = -1;                         /* -1 sends the header next */
+static uint32_t read_time = 0U;                     /* timestamps unwrapped to 32 bits, relative to the first record */
+static uint16_t read_last = 0U;
+static const char *signal_names[SYSID_SIGNAL_COUNT] = { "prbs", "chirp" };
+
+static int16_t quantize(float value, float scale)
+{
+    float scaled = roundf(value * scale);
+    if (scaled > 32767.0F) { return 32767; }
+    if (scaled < -32768.0F) { return -32768; }
+    return (int16_t)scaled;
+}
+
+void sysid_request(SysidSignal signal, float amplitude)
+{
+    if (signal >= SYSID_SIGNAL_COUNT) { return; }
+    if (amplitude <= 0.0F) { amplitude = SYSID_DEFAULT_AMPLITUDE; }
+    requested_amplitude = fminf(amplitude, SYSID_MAX_AMPLITUDE);
+    requested = (int8_t)signal;
+}
+
+void sysid_poll(bool active)
+{
+    if (phase == SYSID_CAPTURING && !active)
+    {
+        phase = SYSID_IDLE;
+        ESP_LOGW("sysid", "Capture dropped, control went off");
+    }
+
+    if (requested >= 0 && active && phase != SYSID_CAPTURING)
+    {
+        capture.signal = (SysidSignal)requested;
+        capture.amplitude = requested_amplitude;
+        capture.elapsed = 0.0F;
+        capture.prbs = PRBS_SEED;
+        capture.hold = 0U;
+        capture.level = 0.0F;
+        capture.count = 0U;
+        phase = SYSID_CAPTURING;
+        ESP_LOGI("sysid", "Capture started, %s at %.1f counts", signal_names[capture.signal], capture.amplitude);
+    }
+    requested = -1;
+}
+
+bool sysid_capturing(void)
+{
+    return phase == SYSID_CAPTURING;
+}
+
+float sysid_excitation(float deltat)
+{
+    if (phase != SYSID_CAPTURING) { return 0.0F; }
+
+    float t = capture.elapsed;
+    capture.elapsed += deltat;
+    if (capture.signal == SYSID_PRBS)
+    {
+        if (capture.hold == 0U)
+        {
+            uint16_t bit = ((capture.prbs >> 8) ^ (capture.prbs >> 4)) & 1U;
+            capture.prbs = (uint16_t)(((capture.prbs << 1) | bit) & 0x1FFU);
+            capture.level = (capture.prbs & 1U) ? capture.amplitude : -capture.amplitude;
+            capture.hold = SYSID_PRBS_HOLD;
+        }
+        capture.hold--;
+        return capture.level;
+    }
+
+    /* log chirp, the phase is the integral of f0 (f1 / f0)^(t / T) */
+    if (t > SYSID_CHIRP_DURATION) { return 0.0F; }
+    float ratio = logf(SYSID_CHIRP_END / SYSID_CHIRP_START);
+    float cycles = SYSID_CHIRP_START * SYSID_CHIRP_DURATION / ratio * (expf(ratio * t / SYSID_CHIRP_DURATION) - 1.0F);
+    return capture.amplitude * sinf(2.0F * PI * cycles);
+}
+
+void sysid_record(uint16_t timestamp, float command, float rate, float pitch)
+{
+    if (phase != SYSID_CAPTURING) { return; }
+
+    SysidRecord *record = &records[capture.count];
+    record->timestamp = timestamp;
+    record->command = quantize(command, SYSID_COMMAND_SCALE);
+    record->rate = quantize(rate, SYSID_RATE_SCALE);
+    record->pitch = quantize(pitch, SYSID_PITCH_SCALE);
+    capture.count++;
+    if (capture.count >= SYSID_CAPTURE_SAMPLES)
+    {
+        cursor = -1;
+        phase = SYSID_CAPTURED;
+        ESP_LOGI("sysid", "Capture complete, %u samples", capture.count);
+    }
+}
+
+size_t sysid_read(char *buffer, size_t size)
+{
+    int length = 0;
+
+    if (phase == SYSID_CAPTURING) { length = snprintf(buffer, size, "capturing %u/%u", capture.count, SYSID_CAPTURE_SAMPLES); }
+    else if (phase != SYSID_CAPTURED) { length = snprintf(buffer, size, "idle"); }
+    else if (cursor < 0)
+    {
+        length = snprintf(buffer, size, "# %s %.1f\nt_us,command,rate_dps,pitch_deg\n", signal_names[capture.signal], capture.amplitude);
+        cursor = 0;
+        read_time = 0U;
+        read_last = records[0].timestamp;
+    }
+    else if (cursor >= (int32_t)capture.count)
+    {
+        length = snprintf(buffer, size, "end");
+        cursor = -1; /* the next read starts over */
+    }
+    else
+    {
+        /* as many whole lines as fit */
+        size_t used = 0U;
+        while (cursor < (int32_t)capture.count)
+        {
+            const SysidRecord *record = &records[cursor];
+            uint32_t time = read_time + (uint16_t)(record->timestamp - read_last);
+            int line = snprintf(buffer + used, size - used, "%lu,%.2f,%.2f,%.3f\n", (unsigned long)time,
+                                record->command / SYSID_COMMAND_SCALE, record->rate / SYSID_RATE_SCALE, record->pitch / SYSID_PITCH_SCALE);
+            if (line < 0 || (size_t)line >= size - used) { buffer[used] = '\0'; break; }
+            used += (size_t)line;
+            read_time = time;
+            read_last = record->timestamp;
+            cursor++;
+        }
+        return used;
+    }
+
+    if (length < 0) { return 0U; }
+    return ((size_t)length < size) ? (size_t)length : size - 1U;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * sysid.h - system identification: adds a prbs or log chirp to the balance controller's command and captures
+ * command, gyro rate and pitch at the full imu rate into ram, then hands the capture out over ble for
+ * host/tools/sysid_fit.c
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SYSID_H
+#define _SYSID_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SYSID_CAPTURE_SAMPLES    4096U   /* ~4 s at 1 kHz, 8 bytes each */
+#define SYSID_DEFAULT_AMPLITUDE  (30.0F) /* counts, when the request leaves it out */
+#define SYSID_MAX_AMPLITUDE      (100.0F) /* the controller still needs room to keep it up */
+#define SYSID_PRBS_HOLD          2U      /* passes per prbs bit, 10 ms at 200 Hz puts the band edge near 40 Hz */
+#define SYSID_CHIRP_START        (0.5F)  /* Hz */
+#define SYSID_CHIRP_END          (40.0F) /* Hz */
+#define SYSID_CHIRP_DURATION     (4.0F)  /* seconds, about the length of the capture */
+#define SYSID_COMMAND_SCALE      (16.0F) /* stored fixed point, counts * 16 */
+#define SYSID_RATE_SCALE         (100.0F) /* dps * 100, clips at +-327 dps which a balancing robot never sees */
+#define SYSID_PITCH_SCALE        (1000.0F) /* degrees * 1000, balancing moves hundredths so 0.01 would drown the fit in quantization */
+#define SIZEOF_SYSID_DATA        512
+#define SYSID_MIN_READ           64U     /* smallest chunk that still holds the header or a whole line, an att mtu of 65 */
+
+typedef enum {
+    SYSID_PRBS = 0,         /* 9 bit maximal length sequence, +-amplitude */
+    SYSID_CHIRP,            /* sine sweeping from start to end frequency on a log scale */
+    SYSID_SIGNAL_COUNT
+} SysidSignal;
+
+typedef enum {
+    SYSID_IDLE = 0,
+    SYSID_CAPTURING,
+    SYSID_CAPTURED,         /* the capture is complete, ble reads hand it out */
+} SysidPhase;
+
+typedef struct {
+    uint16_t timestamp;     /* sensor clock of the sample, us */
+    int16_t command;        /* what the motor got while the sample was taken, SYSID_COMMAND_SCALE */
+    int16_t rate;           /* pitch rate, SYSID_RATE_SCALE */
+    int16_t pitch;          /* pitch - set point, SYSID_PITCH_SCALE */
+} SysidRecord;
+
+/* ble side: ask for a capture, picked up on the next pass while control is on */
+void sysid_request(SysidSignal signal, float amplitude);
+/* ble side: one chunk of the capture as csv lines per call, the status while there is none. every call moves on to */
+/* the next chunk, so size has to keep it within a single att read response */
+size_t sysid_read(char *buffer, size_t size);
+
+/* control task, once per pass: starts a requested capture when active, drops it when not */
+void sysid_poll(bool active);
+bool sysid_capturing(void);
+/* per pass: the excitation to add to the controller's command, counts */
+float sysid_excitation(float deltat);
+/* per imu sample, the capture ends itself when the buffer is full */
+void sysid_record(uint16_t timestamp, float command, float rate, float pitch);
+
+#endif /* _SYSID_H */
\ No newline at end of file
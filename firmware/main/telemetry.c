@@ -0,0 +1,157 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * telemetry.c - live telemetry ring, see telemetry.h
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "telemetry.h"
+
+#define MASK            (TELEMETRY_RING_SIZE - 1U)
+
+/* head is only written by the producer and tail only by the consumer. the producer never looks at tail: when it */
+/* laps the consumer it just overwrites the oldest slot, and the consumer finds out from head and skips past it */
+static TelemetrySample ring[TELEMETRY_RING_SIZE];
+static atomic_uint_fast32_t head = 0U;
+static uint32_t tail = 0U;                      /* consumer */
+static volatile bool enabled = false;
+static volatile uint32_t decimation = TELEMETRY_DEFAULT_DECIMATION;
+static uint32_t skipped = 0U;                   /* producer */
+static volatile uint32_t pushed = 0U;           /* producer */
+static volatile uint32_t decimated = 0U;        /* producer */
+static volatile uint32_t dropped = 0U;          /* consumer */
+static volatile uint32_t sent = 0U;             /* consumer */
+
+_Static_assert((TELEMETRY_RING_SIZE & MASK) == 0U, "TELEMETRY_RING_SIZE has to be a power of two");
+
+static int16_t quantize(float value, float scale)
+{
+    float scaled = roundf(value * scale);
+    if (scaled > 32767.0F) { return 32767; }
+    if (scaled < -32768.0F) { return -32768; }
+    return (int16_t)scaled;
+}
+
+static uint8_t *put(uint8_t *out, const void *value, size_t size)
+{
+    memcpy(out, value, size);
+    return out + size;
+}
+
+void telemetry_enable(bool on)
+{
+    enabled = on;
+}
+
+void telemetry_set_decimation(uint32_t passes)
+{
+    if (passes < 1U) { passes = 1U; }
+    decimation = (passes < TELEMETRY_MAX_DECIMATION) ? passes : TELEMETRY_MAX_DECIMATION;
+}
+
+void telemetry_counters(TelemetryCounters *counters)
+{
+    counters->pushed = pushed;
+    counters->decimated = decimated;
+    counters->dropped = dropped;
+    counters->sent = sent;
+}
+
+size_t telemetry_string(char *buffer, size_t size)
+{
+    int length = snprintf(buffer, size, "%s 1/%lu, pushed %lu, decimated %lu, dropped %lu, sent %lu", enabled ? "on" : "off",
+                          (unsigned long)decimation, (unsigned long)pushed, (unsigned long)decimated, (unsigned long)dropped, (unsigned long)sent);
+    if (length < 0) { return 0U; }
+    return ((size_t)length < size) ? (size_t)length : size - 1U;
+}
+
+void telemetry_push(uint32_t time_us, float pitch, float rate, float command, float applied, uint8_t flags)
+{
+    if (!enabled) { return; }
+    if (++skipped < decimation) { decimated++; return; }
+    skipped = 0U;
+
+    /* plain stores into the slot, then publish it */
+    uint32_t at = (uint32_t)atomic_load_explicit(&head, memory_order_relaxed);
+    TelemetrySample *slot = &ring[at & MASK];
+    slot->time_us = time_us;
+    slot->pitch = pitch;
+    slot->rate = rate;
+    slot->command = command;
+    slot->applied = applied;
+    slot->flags = flags;
+    atomic_store_explicit(&head, at + 1U, memory_order_release);
+    pushed++;
+}
+
+size_t telemetry_pack(uint8_t *buffer, size_t size)
+{
+    TelemetrySample copies[TELEMETRY_MAX_RECORDS];
+
+    if (size < TELEMETRY_HEADER_SIZE + TELEMETRY_RECORD_SIZE) { return 0U; }
+    size_t room = (size - TELEMETRY_HEADER_SIZE) / TELEMETRY_RECORD_SIZE;
+    if (room > TELEMETRY_MAX_RECORDS) { room = TELEMETRY_MAX_RECORDS; }
+
+    /* the slot of index head is the one the producer may be writing right now, it aliases head - size */
+    uint32_t end = (uint32_t)atomic_load_explicit(&head, memory_order_acquire);
+    uint32_t first = tail;
+    if (end - first > TELEMETRY_RING_SIZE - 1U) { first = end - (TELEMETRY_RING_SIZE - 1U); }
+    uint32_t count = end - first;
+    if (count > room) { count = (uint32_t)room; }
+    for (uint32_t i = 0U; i < count; i++) { copies[i] = ring[(first + i) & MASK]; }
+
+    /* anything the producer lapped while we were copying is torn, drop it like the rest of the oldest */
+    atomic_thread_fence(memory_order_acquire);
+    uint32_t now = (uint32_t)atomic_load_explicit(&head, memory_order_relaxed);
+    uint32_t skip = 0U;
+    if (now - first > TELEMETRY_RING_SIZE - 1U) { skip = now - first - (TELEMETRY_RING_SIZE - 1U); }
+    if (skip > count) { skip = count; }
+    dropped += (first - tail) + skip;
+    tail = first + count;
+    first += skip;
+    count -= skip;
+    if (count == 0U) { return 0U; }
+
+    uint8_t *out = buffer;
+    uint16_t sequence = (uint16_t)first;
+    uint16_t lost = (uint16_t)dropped;
+    out = put(out, &sequence, sizeof(sequence));
+    out = put(out, &lost, sizeof(lost));
+    *out++ = (uint8_t)count;
+    *out++ = (uint8_t)TELEMETRY_RECORD_SIZE;
+    for (uint32_t i = skip; i < skip + count; i++)
+    {
+        const TelemetrySample *sample = &copies[i];
+        int16_t values[4] = { quantize(sample->pitch, TELEMETRY_PITCH_SCALE), quantize(sample->rate, TELEMETRY_RATE_SCALE),
+                              quantize(sample->command, TELEMETRY_DUTY_SCALE), quantize(sample->applied, TELEMETRY_DUTY_SCALE) };
+        out = put(out, &sample->time_us, sizeof(uint32_t));
+        out = put(out, values, sizeof(values));
+        *out++ = sample->flags;
+    }
+    sent += count;
+    return (size_t)(out - buffer);
+}
\ No newline at end of file
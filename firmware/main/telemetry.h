@@ -0,0 +1,87 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * telemetry.h - live telemetry: the control task pushes one record per pass (decimated) into a wait-free single
+ * producer, single consumer ring, the nimble host task packs what's there into notifications. a full ring drops the
+ * oldest records, never blocks or allocates on the control side
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TELEMETRY_RING_SIZE          64U    /* records, a power of two. 1.3 s at the default decimation */
+#define TELEMETRY_DEFAULT_DECIMATION 4U     /* every 4th pass, 50 Hz at 200 Hz */
+#define TELEMETRY_MAX_DECIMATION     200U
+#define TELEMETRY_PERIOD_MS          20U    /* between notifications */
+#define TELEMETRY_MAX_RECORDS        19U    /* per notification, fills a 256 byte mtu */
+#define TELEMETRY_HEADER_SIZE        6U     /* u16 sequence of the first record, u16 dropped so far, u8 count, u8 record size */
+#define TELEMETRY_RECORD_SIZE        13U    /* u32 time us, i16 pitch, rate, command, applied, u8 flags */
+#define TELEMETRY_PITCH_SCALE        (100.0F) /* degrees * 100 */
+#define TELEMETRY_RATE_SCALE         (100.0F) /* dps * 100 */
+#define TELEMETRY_DUTY_SCALE         (16.0F)  /* counts * 16, like sysid */
+#define SIZEOF_TELEMETRY_DATA        128
+
+#define TELEMETRY_FLAG_ACTIVE        (1U << 0U) /* control on */
+#define TELEMETRY_FLAG_SATURATED     (1U << 1U) /* command at the duty limit */
+#define TELEMETRY_FLAG_HOLD          (1U << 2U) /* no samples, the executive held the estimate */
+#define TELEMETRY_FLAG_STOP          (1U << 3U) /* the executive stopped the motor */
+#define TELEMETRY_FLAG_AUTOTUNE      (1U << 4U)
+#define TELEMETRY_FLAG_SYSID         (1U << 5U)
+#define TELEMETRY_FLAG_RECORDING     (1U << 6U)
+#define TELEMETRY_FLAG_FRICTION      (1U << 7U) /* friction calibration driving the motor */
+
+/* what the producer stores, as is: converting to the wire format is the consumer's job */
+typedef struct {
+    uint32_t time_us;       /* hal clock at the start of the pass */
+    float pitch;            /* degrees, what the controller saw */
+    float rate;             /* dps */
+    float command;          /* controller output, counts */
+    float applied;          /* what the motor got, counts */
+    uint8_t flags;          /* TELEMETRY_FLAG_* */
+} TelemetrySample;
+
+typedef struct {
+    uint32_t pushed;        /* records that went into the ring */
+    uint32_t decimated;     /* passes skipped by the decimation */
+    uint32_t dropped;       /* records overwritten before the consumer got to them */
+    uint32_t sent;          /* records packed into notifications */
+} TelemetryCounters;
+
+/* ble side: on while someone is subscribed, the producer returns right away while off */
+void telemetry_enable(bool enabled);
+/* ble side: keep one pass out of this many, 1 for all of them */
+void telemetry_set_decimation(uint32_t passes);
+/* ble side: the counters and the decimation as text */
+size_t telemetry_string(char *buffer, size_t size);
+void telemetry_counters(TelemetryCounters *counters);
+
+/* control task, once per pass */
+void telemetry_push(uint32_t time_us, float pitch, float rate, float command, float applied, uint8_t flags);
+/* consumer: header and as many records as fit in size, 0 if there are none */
+size_t telemetry_pack(uint8_t *buffer, size_t size);
+
+#endif /* _TELEMETRY_H */
\ No newline at end of file
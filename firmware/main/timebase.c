@@ -0,0 +1,88 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * timebase.c - integration time base built from the imu's own timestamp counter. turns the raw
+ * 16-bit fifo timestamps into deltat values with rollover handling, first-sample and outlier guards,
+ * and keeps jitter statistics of the sample period
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include "timebase.h"
+
+void timebase_init(Timebase *timebase, float nominal_period, float tick_us)
+{
+    timebase->nominal = nominal_period;
+    timebase->tick = tick_us / 1000000.0F;
+    timebase->last_stamp = 0U;
+    timebase->started = false;
+    timebase_reset_stats(timebase);
+}
+
+float timebase_update(Timebase *timebase, uint16_t stamp)
+{
+    /* the first sample has nothing to be measured against, integrate it over one nominal period */
+    if (!timebase->started)
+    {
+        timebase->started = true;
+        timebase->last_stamp = stamp;
+        return timebase->nominal;
+    }
+
+    /* unsigned 16-bit subtraction takes care of the counter rolling over (every ~65 ms at 1 us resolution) */
+    uint16_t ticks = (uint16_t)(stamp - timebase->last_stamp);
+    timebase->last_stamp = stamp;
+    float deltat = (float)ticks * timebase->tick;
+
+    /* a gap (lost packets, fifo restart) or a repeated stamp must not be integrated as is */
+    if (deltat < TIMEBASE_MIN_RATIO * timebase->nominal || deltat > TIMEBASE_MAX_RATIO * timebase->nominal)
+    {
+        timebase->outliers++;
+        return timebase->nominal;
+    }
+
+    /* welford running mean/variance of the period error */
+    float error = deltat - timebase->nominal;
+    float delta = error - timebase->jitter_mean;
+    timebase->samples++;
+    timebase->jitter_mean += delta / (float)timebase->samples;
+    timebase->jitter_m2 += delta * (error - timebase->jitter_mean);
+    if (fabsf(error) > timebase->jitter_max) { timebase->jitter_max = fabsf(error); }
+
+    return deltat;
+}
+
+float timebase_jitter(const Timebase *timebase)
+{
+    if (timebase->samples < 2U) { return 0.0F; }
+    return sqrtf(timebase->jitter_m2 / (float)(timebase->samples - 1U));
+}
+
+void timebase_reset_stats(Timebase *timebase)
+{
+    timebase->samples = 0U;
+    timebase->outliers = 0U;
+    timebase->jitter_mean = 0.0F;
+    timebase->jitter_m2 = 0.0F;
+    timebase->jitter_max = 0.0F;
+}
\ No newline at end of file
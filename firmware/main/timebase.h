@@ -0,0 +1,58 @@
+/*
+ * This file is part of the jirachi repository, https://github.com/gluonsandquarks/jirachi
+ * timebase.h - integration time base built from the imu's own timestamp counter. turns the raw
+ * 16-bit fifo timestamps into deltat values with rollover handling, first-sample and outlier guards,
+ * and keeps jitter statistics of the sample period
+ * 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2025 gluons.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TIMEBASE_H
+#define _TIMEBASE_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMEBASE_TICK_US            (1.0F)  /* TMST_RES = 0 -> 1 us per timestamp count */
+#define TIMEBASE_MIN_RATIO          (0.5F)  /* deltat outside [min, max] * nominal period is an outlier */
+#define TIMEBASE_MAX_RATIO          (1.5F)
+
+typedef struct {
+    float nominal;         /* expected sample period, in seconds */
+    float tick;            /* seconds per timestamp count */
+    uint16_t last_stamp;   /* last raw timestamp seen */
+    bool started;          /* false until the first sample arrived */
+    uint32_t samples;      /* deltas accepted into the statistics */
+    uint32_t outliers;     /* deltas rejected and replaced by the nominal period */
+    float jitter_mean;     /* running mean of (deltat - nominal), seconds */
+    float jitter_m2;       /* running sum of squared deviations (welford) */
+    float jitter_max;      /* largest |deltat - nominal| seen, seconds */
+} Timebase;
+
+void timebase_init(Timebase *timebase, float nominal_period, float tick_us);
+/* feed the raw timestamp of the next sample, returns the deltat in seconds to integrate it with */
+float timebase_update(Timebase *timebase, uint16_t stamp);
+/* standard deviation of the sample period, in seconds */
+float timebase_jitter(const Timebase *timebase);
+void timebase_reset_stats(Timebase *timebase);
+
+#endif /* _TIMEBASE_H */
\ No newline at end of file